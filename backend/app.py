@@ -20,8 +20,9 @@ from flask_socketio import SocketIO
 sys.path.insert(0, os.path.dirname(__file__))
 
 from serial_reader import reader
-from eeg_pipeline import process_window, extract_features, FS
-from ml_model import ensure_model, predict
+from udp_ingest import ingest
+from eeg_pipeline import IncrementalPipeline, extract_features, FS
+from ml_model import ensure_model, predict, model_version
 
 # ---------------------------------------------------------------------------
 # App setup
@@ -72,6 +73,8 @@ def health():
         "serial_connected": reader.connected,
         "mock_mode": reader.mock_mode,
         "auth_status": auth_state["status"],
+        "model_version": model_version(),
+        "device_model_version": reader.device_model_version,
     })
 
 
@@ -143,6 +146,31 @@ def serial_connect():
     return jsonify({"ok": True, "connected": reader.connected})
 
 
+@app.route("/api/serial/stats")
+def serial_stats():
+    """Loss, gap and latency counters of the serial stream."""
+    return jsonify(reader.link_stats())
+
+
+@app.route("/api/serial/perf")
+def serial_perf():
+    """Latest ESP32 PERF telemetry (send "PERF <seconds>" to enable)."""
+    return jsonify({"perf": reader.device_perf()})
+
+
+@app.route("/api/serial/auth")
+def serial_auth():
+    """Latest on-device authentication session (ESP32 AUTH / button tests)."""
+    return jsonify({"auth": reader.device_auth()})
+
+
+@app.route("/api/udp/devices")
+def udp_devices():
+    """Headsets seen by the UDP ingest (LINK UDP), with loss counters."""
+    return jsonify({"devices": ingest.devices(),
+                    "bad_datagrams": ingest.bad_datagrams})
+
+
 # ---------------------------------------------------------------------------
 # WebSocket push loop
 # ---------------------------------------------------------------------------
@@ -163,25 +191,46 @@ def _stop_push_loop():
 
 def _push_loop():
     """
-    Every ~200 ms, grab the latest window, run the pipeline,
-    and push updates to the frontend over WebSocket.
+    Every ~200 ms, feed the samples that arrived since the last pass to
+    the incremental pipeline; each completed Welch segment (every
+    ~0.5 s) gives a new window to classify, pushed to the frontend over
+    WebSocket.
     """
     global _push_running
-    chunks_needed = 6  # ~6 chunks × 200ms ≈ 3-5 seconds total
+    chunks_needed = 6  # 1.5 s to the first window, then ~6 × 0.5 s ≈ 4.5 s total
+    pipeline = IncrementalPipeline()
+    position = None
 
     while _push_running and auth_state["status"] == "scanning":
         time.sleep(0.2)
 
-        window = reader.get_window()
-        if window is None or len(window) < 250:
-            # Not enough data yet — send waveform only
-            waveform = reader.get_latest(80)
-            socketio.emit("waveform_update", {"waveform": waveform})
-            continue
-
-        # Process
-        result = process_window(window)
-        features = np.array(result["features"])
+        device_features = reader.get_features()
+        if device_features is not None:
+            # ESP32 in FEATURES mode already reduced the window on-device
+            features = device_features
+            result = {"band_powers": {
+                "theta": round(float(features[0]), 4),
+                "alpha": round(float(features[1]), 4),
+                "beta":  round(float(features[2]), 4),
+            }}
+        else:
+            samples, position, contiguous = reader.read_since(position)
+            if not contiguous:
+                # First pass, or we fell HISTORY_SIZE behind: start over on the newest window
+                pipeline.reset()
+                samples = samples[-pipeline.window:]
+            segments = pipeline.push(samples, prefiltered=reader.prefiltered)
+            if (not segments or not pipeline.ready()
+                    or not reader.window_clean(pipeline.span)):
+                # No new window yet, or the device flagged an artifact
+                # in it — send waveform only
+                waveform = reader.get_latest(80)
+                socketio.emit("waveform_update", {"waveform": waveform})
+                continue
+
+            # Process: only the new samples were filtered and transformed
+            result = pipeline.result()
+            features = np.array(result["features"])
         pred = predict(features)
 
         auth_state["chunks_processed"] += 1
@@ -233,6 +282,10 @@ def main():
     reader.connect()
     reader.start()
 
+    # Network headsets (firmware built with WIFI_ENABLED, LINK UDP)
+    if os.environ.get("CORTEXKEY_UDP", "0") == "1":
+        ingest.start()
+
     print("\n" + "=" * 56)
     print("  CortexKey Neural Authentication System")
     print("  Backend running on http://localhost:5001")
@@ -7,11 +7,21 @@ Processes raw EEG data through:
   3. Feature extraction (PSD, band powers, ratios)
 
 Output: 6-dimensional feature vector for ML classification.
+
+process_window() handles one window on its own; IncrementalPipeline
+keeps the filter state and per-segment spectra between hops of a live
+stream, so each new window only costs its new samples. The two filter
+differently (zero-phase filtfilt vs the causal chain), so a model is
+trained on stream_features(), the live chain, not extract_features().
 """
 
+import collections
+
 import numpy as np
 from scipy import signal as sig
 
+from sample_ring import SampleRing
+
 
 # ---------------------------------------------------------------------------
 # Filter design (computed once at import time)
@@ -24,6 +34,15 @@ _notch_b, _notch_a = sig.iirnotch(50.0, 30.0, FS)
 # 5-30 Hz bandpass (Butterworth 4th order)
 _bp_b, _bp_a = sig.butter(4, [5.0, 30.0], btype="band", fs=FS)
 
+# The same chain as causal sections, for streaming with carried state
+# (the firmware's FILTER ON chain is causal too)
+_stream_sos = np.vstack([sig.tf2sos(_notch_b, _notch_a),
+                         sig.butter(4, [5.0, 30.0], btype="band", fs=FS, output="sos")])
+
+# Welch segmentation (scipy's default overlap: half a segment)
+WELCH_NPERSEG = 256
+WELCH_STEP = WELCH_NPERSEG // 2
+
 
 def apply_notch(data: np.ndarray) -> np.ndarray:
     """Remove 50 Hz powerline interference."""
@@ -35,6 +54,18 @@ def apply_bandpass(data: np.ndarray) -> np.ndarray:
     return sig.filtfilt(_bp_b, _bp_a, data)
 
 
+def stream_filter(data: np.ndarray) -> np.ndarray:
+    """
+    Notch + bandpass as the live chain runs them: causal, from steady
+    state at the first sample (IncrementalPipeline.push(), FILTER ON).
+    """
+    data = np.asarray(data, dtype=np.float64)
+    if len(data) == 0:
+        return data
+    filtered, _ = sig.sosfilt(_stream_sos, data, zi=sig.sosfilt_zi(_stream_sos) * data[0])
+    return filtered
+
+
 # ---------------------------------------------------------------------------
 # Feature extraction
 # ---------------------------------------------------------------------------
@@ -48,22 +79,18 @@ def compute_band_power(psd: np.ndarray, freqs: np.ndarray,
     return float(np.trapz(psd[idx], freqs[idx]))
 
 
-def extract_features(raw_window: np.ndarray, fs: int = FS) -> np.ndarray:
-    """
-    Full processing pipeline for one 2-second window (500 samples).
+def welch_psd(data: np.ndarray, fs: int = FS):
+    """(freqs, psd) of a filtered window, Welch with WELCH_NPERSEG segments."""
+    nperseg = min(WELCH_NPERSEG, len(data))
+    return sig.welch(data, fs=fs, nperseg=nperseg)
 
-    Returns a 6-element feature vector:
+
+def features_from_psd(psd: np.ndarray, freqs: np.ndarray) -> np.ndarray:
+    """
+    The 6-element feature vector of one PSD:
         [theta_power, alpha_power, beta_power,
          alpha_theta_ratio, alpha_beta_ratio, total_power]
     """
-    # --- pre-processing ---------------------------------------------------
-    data = apply_notch(raw_window)
-    data = apply_bandpass(data)
-
-    # --- PSD via Welch's method -------------------------------------------
-    nperseg = min(256, len(data))
-    freqs, psd = sig.welch(data, fs=fs, nperseg=nperseg)
-
     # --- band powers ------------------------------------------------------
     theta = compute_band_power(psd, freqs, 4.0, 8.0)
     alpha = compute_band_power(psd, freqs, 8.0, 13.0)
@@ -78,33 +105,176 @@ def extract_features(raw_window: np.ndarray, fs: int = FS) -> np.ndarray:
                      alpha_theta, alpha_beta, total], dtype=np.float64)
 
 
-def process_window(raw_window: np.ndarray, fs: int = FS):
-    """
-    Convenience wrapper that returns both the filtered signal
-    (for the oscilloscope) and the feature vector (for the ML model).
+def _prefilter(raw_window: np.ndarray, prefiltered: bool) -> np.ndarray:
+    if prefiltered:
+        return np.asarray(raw_window, dtype=np.float64)
+    return apply_bandpass(apply_notch(raw_window))
+
+
+def extract_features(raw_window: np.ndarray, fs: int = FS,
+                     prefiltered: bool = False) -> np.ndarray:
     """
-    filtered = apply_bandpass(apply_notch(raw_window))
+    Full processing pipeline for one 2-second window (500 samples).
+    Pass prefiltered=True when the ESP32 already applied the notch +
+    bandpass chain (FILTER ON) to skip re-filtering the window.
 
-    # Band powers for the bar chart
-    nperseg = min(256, len(filtered))
-    freqs, psd = sig.welch(filtered, fs=fs, nperseg=nperseg)
-    theta = compute_band_power(psd, freqs, 4.0, 8.0)
-    alpha = compute_band_power(psd, freqs, 8.0, 13.0)
-    beta  = compute_band_power(psd, freqs, 13.0, 30.0)
+    Returns the 6-element feature vector of features_from_psd().
+    """
+    freqs, psd = welch_psd(_prefilter(raw_window, prefiltered), fs)
+    return features_from_psd(psd, freqs)
 
-    features = extract_features(raw_window, fs)
 
+def _result(filtered, features) -> dict:
     return {
         "filtered": filtered.tolist(),
         "features": features.tolist(),
-        "band_powers": {
-            "theta": round(float(theta), 4),
-            "alpha": round(float(alpha), 4),
-            "beta":  round(float(beta), 4),
+        "band_powers": {                   # for the bar chart
+            "theta": round(float(features[0]), 4),
+            "alpha": round(float(features[1]), 4),
+            "beta":  round(float(features[2]), 4),
         },
     }
 
 
+def process_window(raw_window: np.ndarray, fs: int = FS,
+                   prefiltered: bool = False):
+    """
+    Convenience wrapper that returns both the filtered signal
+    (for the oscilloscope) and the feature vector (for the ML model).
+    Filters and runs Welch once for both.
+    """
+    filtered = _prefilter(raw_window, prefiltered)
+    freqs, psd = welch_psd(filtered, fs)
+    return _result(filtered, features_from_psd(psd, freqs))
+
+
+# ---------------------------------------------------------------------------
+# Incremental pipeline (live streams)
+# ---------------------------------------------------------------------------
+
+class IncrementalPipeline:
+    """
+    Streaming form of process_window() for a sliding window.
+
+    Samples pass once through the causal notch + bandpass chain (state
+    carried between pushes) into a SampleRing. Welch segments sit on a
+    fixed grid, WELCH_STEP samples apart; each one is windowed and
+    transformed once, when its last sample arrives, and its periodogram
+    is kept. The features are the mean of the newest SEGMENTS
+    periodograms, i.e. welch_psd() of the WELCH_NPERSEG + WELCH_STEP
+    samples they cover.
+
+    Those samples went through the chain once (|H|, with its phase),
+    where process_window() runs filtfilt (|H|^2, zero phase), so the two
+    do not give the same numbers - most visibly theta, on the 5 Hz
+    skirt, and alpha/theta. Models are trained through this class
+    (stream_features()) so they see what is served.
+
+    So a new feature vector costs the filter on the new samples plus one
+    FFT per WELCH_STEP samples, instead of re-filtering and transforming
+    the whole window on every hop.
+
+    Usage:
+        pipeline = IncrementalPipeline()
+        if pipeline.push(new_samples):     # a new segment completed
+            features = pipeline.features()
+    """
+
+    SEGMENTS = 2    # Welch segments per window, as welch_psd() finds in 500 samples
+
+    def __init__(self, fs: int = FS, window: int = 2 * FS):
+        self.fs = fs
+        self.window = window
+        self._hann = sig.get_window("hann", WELCH_NPERSEG)
+        self._scale = 1.0 / (fs * np.sum(self._hann ** 2))      # scaling="density"
+        self._freqs = np.fft.rfftfreq(WELCH_NPERSEG, 1.0 / fs)
+        self._ring = SampleRing(capacity=max(window, WELCH_NPERSEG + WELCH_STEP))
+        self._psds = collections.deque(maxlen=self.SEGMENTS)
+        self._prefiltered = False
+        self.reset()
+
+    def reset(self):
+        """Drop filter state and segments (a gap or a change of source)."""
+        self._ring.clear()
+        self._psds.clear()
+        self._zi = None
+        self._next_segment = WELCH_NPERSEG       # stream position of the next segment end
+
+    def push(self, values, prefiltered: bool = False) -> int:
+        """
+        Add raw samples (or, with prefiltered, samples the ESP32 already
+        filtered). Returns the number of segments completed by them.
+        """
+        values = np.asarray(values, dtype=np.float64)
+        if prefiltered != self._prefiltered:
+            self._prefiltered = prefiltered
+            self.reset()
+        if len(values) == 0:
+            return 0
+        if not prefiltered:
+            if self._zi is None:
+                # Start in steady state at the first sample, not from 0 uV
+                self._zi = sig.sosfilt_zi(_stream_sos) * values[0]
+            values, self._zi = sig.sosfilt(_stream_sos, values, zi=self._zi)
+
+        # In chunks that keep every new segment inside the ring's history
+        chunk = self._ring.capacity - WELCH_NPERSEG
+        done = 0
+        for pos in range(0, len(values), chunk):
+            self._ring.extend(values[pos:pos + chunk])
+            done += self._add_segments()
+        return done
+
+    def _add_segments(self) -> int:
+        written = self._ring.written
+        if written < self._next_segment:
+            return 0
+        count = (written - self._next_segment) // WELCH_STEP + 1
+        last = self._next_segment + (count - 1) * WELCH_STEP
+        segments = self._ring.windows(WELCH_NPERSEG, WELCH_STEP, count=count,
+                                      lag=written - last)
+        segments = segments - segments.mean(axis=1, keepdims=True)    # detrend="constant"
+        spectrum = np.fft.rfft(segments * self._hann, axis=1)
+        psd = (spectrum.real ** 2 + spectrum.imag ** 2) * self._scale
+        psd[:, 1:-1] *= 2                        # one-sided (DC and Nyquist once)
+        self._psds.extend(psd)
+        self._next_segment = last + WELCH_STEP
+        return count
+
+    @property
+    def span(self) -> int:
+        """Samples from the start of the oldest segment in features() to the newest."""
+        covered = WELCH_NPERSEG + (self.SEGMENTS - 1) * WELCH_STEP
+        return self._ring.written - (self._next_segment - WELCH_STEP) + covered
+
+    def ready(self) -> bool:
+        return len(self._psds) == self.SEGMENTS
+
+    def features(self):
+        """Feature vector of the newest segments (features_from_psd()), or None."""
+        if not self.ready():
+            return None
+        return features_from_psd(np.mean(self._psds, axis=0), self._freqs)
+
+    def result(self):
+        """process_window()-style dict: the newest `window` filtered samples and features."""
+        features = self.features()
+        if features is None:
+            return None
+        return _result(self._ring.latest(self.window), features)
+
+
+def stream_features(raw: np.ndarray, prefiltered: bool = False):
+    """
+    Feature vector at the end of a recording, through IncrementalPipeline:
+    the features a live stream would serve there (None if it is shorter
+    than WELCH_NPERSEG + WELCH_STEP samples). For training.
+    """
+    pipeline = IncrementalPipeline()
+    pipeline.push(raw, prefiltered=prefiltered)
+    return pipeline.features()
+
+
 # ---------------------------------------------------------------------------
 # Synthetic data generators (mirror the ESP32 mock modes)
 # ---------------------------------------------------------------------------
@@ -9,6 +9,7 @@ call `train_model.py` first (or use `ensure_model()` which auto-trains).
 """
 
 import os
+import hashlib
 import joblib
 import numpy as np
 
@@ -41,6 +42,18 @@ def ensure_model():
     _load()
 
 
+def model_version() -> str:
+    """
+    First 8 hex digits of SHA-256 over svm_model.pkl + scaler.pkl, the
+    MODEL_VERSION tools/export_model.py compiles into the firmware.
+    """
+    digest = hashlib.sha256()
+    for path in (MODEL_PATH, SCALER_PATH):
+        with open(path, "rb") as f:
+            digest.update(f.read())
+    return digest.hexdigest()[:8]
+
+
 def predict(features: np.ndarray) -> dict:
     """
     Classify a single 6D feature vector.
@@ -0,0 +1,111 @@
+"""
+CortexKey - Recorded sessions
+
+Reads the session log the ESP32 keeps of every button test and AUTH
+session (src/recorder.h), as saved by SerialReader.dump_recording(): per
+session a SESSION record, then int24 sample frames of every enabled
+channel. The device logs them whatever the live link does, so they are
+gap-free, and the record carries the test's ground truth (VALID button =
+authenticated, INVALID = impostor) - training data for train_model.py.
+
+Usage:
+    sessions = load_recording("dump.bin")
+    X, y = training_set(sessions)     # feature vectors + labels, 2 s windows
+
+    python recordings.py dump.bin     # list the sessions in a dump
+"""
+
+import sys
+
+import numpy as np
+
+from eeg_pipeline import stream_features, stream_filter
+from serial_reader import FrameDecoder, FRAME_FLAG_ARTIFACT, FS, WINDOW_SIZE
+
+
+def load_recording(path: str) -> list:
+    """
+    Sessions of a DUMP file, oldest first, as dicts: the SESSION record
+    fields (decode_session()) plus "samples" (n, channels) in microvolts,
+    "artifact" (n,) bool from FRAME_FLAG_ARTIFACT, "time_us" (device
+    time of the first sample, or None) and "complete" (no frame missing).
+    Frames whose session record the ring already overwrote are dropped.
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    decoder = FrameDecoder()
+    sessions = []
+    current = None
+    blocks = []
+    for item in decoder.feed(data):
+        if item[0] == "session":
+            current = dict(item[2], time_us=None, complete=True, _next_seq=1)
+            blocks = []
+            sessions.append((current, blocks))
+        elif item[0] == "frame" and current is not None:
+            header, samples = item[1], item[2]
+            if header["seq"] != current["_next_seq"] & 0xFFFF:
+                current["complete"] = False
+            current["_next_seq"] = header["seq"] + 1
+            if current["time_us"] is None:
+                current["time_us"] = header["time_us"]
+            blocks.append((samples, bool(header["flags"] & FRAME_FLAG_ARTIFACT)))
+    if decoder.crc_errors:
+        for session, _ in sessions:
+            session["complete"] = False     # cannot tell which one lost the frame
+
+    out = []
+    for session, blocks in sessions:
+        del session["_next_seq"]
+        if blocks:
+            session["samples"] = np.concatenate([b for b, _ in blocks])
+            session["artifact"] = np.concatenate(
+                [np.full(len(b), flagged) for b, flagged in blocks])
+        else:
+            session["samples"] = np.empty((0, 1))
+            session["artifact"] = np.empty(0, dtype=bool)
+        out.append(session)
+    return out
+
+
+def session_windows(session: dict, length: int = WINDOW_SIZE, hop: int = WINDOW_SIZE):
+    """
+    Channel-0 windows of a session at FS (faster rates averaged down like
+    SerialReader._decimate()), hop samples apart; windows holding an
+    artifact-flagged sample are skipped. A raw session is run through
+    the live chain (stream_filter()) as a whole first, so every window
+    is filtered as it would have been on the device or in app.py.
+    """
+    values = session["samples"][:, 0]
+    artifact = session["artifact"]
+    k = session["rate"] // FS
+    if k > 1 and session["rate"] % FS == 0:
+        n = len(values) - len(values) % k
+        values = values[:n].reshape(-1, k).mean(axis=1)
+        artifact = artifact[:n].reshape(-1, k).any(axis=1)
+    if not session["filtered"]:
+        values = stream_filter(values)
+    for start in range(0, len(values) - length + 1, hop):
+        if not artifact[start:start + length].any():
+            yield values[start:start + length]
+
+
+def training_set(sessions: list):
+    """Feature vectors of every clean window and the session labels (1 = authenticated)."""
+    X, y = [], []
+    for session in sessions:
+        for window in session_windows(session):
+            X.append(stream_features(window, prefiltered=True))
+            y.append(int(session["label"]))
+    return X, y
+
+
+if __name__ == "__main__":
+    for path in sys.argv[1:]:
+        for s in load_recording(path):
+            seconds = len(s["samples"]) / s["rate"] if s["rate"] else 0
+            print(f"[recordings] {path} #{s['session']}: "
+                  f"{'VALID' if s['label'] else 'INVALID'}, {s['rate']} Hz, "
+                  f"{s['samples'].shape[1]} ch, {seconds:.1f} s, "
+                  f"{int(s['artifact'].sum())} flagged samples"
+                  f"{'' if s['complete'] else ', INCOMPLETE'}")
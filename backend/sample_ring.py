@@ -0,0 +1,155 @@
+"""
+CortexKey - Contiguous sample ring
+
+A preallocated float64 buffer that the frame decoder writes into
+directly and the pipeline reads without copying:
+
+    storage  [ ........ history ........ | ..... free ..... ]
+                                         ^ end (next write)
+
+Samples are appended linearly; when a write would run past the end,
+the newest `capacity` samples are moved back to the start (one copy
+per `storage - capacity` samples, so O(1) per sample). The history is
+therefore always one contiguous slice, and latest() / windows() return
+numpy views of it - overlapping windows are a strided view, not a
+stack of copies.
+
+A view stays intact for at least `storage - 2 * capacity` further
+samples (twice the history at the default storage); copy it to keep it
+longer. Writers and readers may be different threads: only the write
+index is shared, and it is updated under the ring's lock after the data
+is in place.
+
+Usage:
+    ring = SampleRing(capacity=1000)
+    slot = ring.reserve(n)          # writable view of n free samples
+    np.multiply(raw, 0.1, out=slot)
+    ring.commit(n)
+    window = ring.latest(500)       # read-only view, newest sample last
+    segs = ring.windows(256, 128)   # (k, 256) view, windows 128 apart
+"""
+
+import threading
+
+import numpy as np
+from numpy.lib.stride_tricks import as_strided
+
+
+class SampleRing:
+    """Append-only sample history with zero-copy window views."""
+
+    def __init__(self, capacity: int, storage: int = None):
+        """
+        capacity: samples readable at once (the history).
+        storage: buffer size, default 4 * capacity.
+        """
+        storage = storage or 4 * capacity
+        if storage < 3 * capacity:
+            raise ValueError("storage must be at least 3 * capacity")
+        self.capacity = capacity
+        self._data = np.zeros(storage, dtype=np.float64)
+        self._end = 0            # next write position in _data
+        self._written = 0        # samples committed since clear()
+        self._lock = threading.Lock()
+
+    # ------------------------------------------------------------------
+    # Writing
+    # ------------------------------------------------------------------
+
+    def reserve(self, n: int) -> np.ndarray:
+        """
+        Writable view of the next n samples (at most capacity). Fill it,
+        then commit(n); until then readers do not see it.
+        """
+        if n > self.capacity:
+            raise ValueError(f"reserve({n}) exceeds the capacity")
+        if self._end + n > len(self._data):
+            keep = min(self._end, self.capacity)
+            self._data[:keep] = self._data[self._end - keep:self._end]
+            with self._lock:
+                self._end = keep
+        return self._data[self._end:self._end + n]
+
+    def commit(self, n: int):
+        """Publish n samples written into the last reserve() view."""
+        with self._lock:
+            self._end += n
+            self._written += n
+
+    def extend(self, values):
+        """Append a block of samples (any length; only the newest capacity are kept)."""
+        values = np.asarray(values, dtype=np.float64)
+        if len(values) > self.capacity:
+            values = values[-self.capacity:]
+        n = len(values)
+        if n:
+            self.reserve(n)[:] = values
+            self.commit(n)
+
+    def append(self, value: float):
+        self.reserve(1)[0] = value
+        self.commit(1)
+
+    def clear(self):
+        with self._lock:
+            self._end = 0
+            self._written = 0
+
+    # ------------------------------------------------------------------
+    # Reading
+    # ------------------------------------------------------------------
+
+    def __len__(self) -> int:
+        return min(self._written, self.capacity)
+
+    @property
+    def written(self) -> int:
+        """Samples committed since clear(): a monotonic stream position."""
+        return self._written
+
+    def latest(self, n: int = None) -> np.ndarray:
+        """Read-only view of the newest n samples (all of the history by default)."""
+        with self._lock:
+            end = self._end
+            avail = min(self._written, self.capacity)
+        n = avail if n is None else min(n, avail)
+        view = self._data[end - n:end]
+        view.flags.writeable = False
+        return view
+
+    def since(self, position: int):
+        """
+        Samples committed after stream position `position` (a previous
+        `written`). Returns (view, new_position, contiguous); contiguous
+        is False when some of them already left the history, or when
+        position is None (first call).
+        """
+        with self._lock:
+            end = self._end
+            written = self._written
+            avail = min(written, self.capacity)
+        if position is None or position > written:
+            n, contiguous = avail, False
+        else:
+            n = written - position
+            contiguous = n <= avail
+            n = min(n, avail)
+        view = self._data[end - n:end]
+        view.flags.writeable = False
+        return view, written, contiguous
+
+    def windows(self, length: int, hop: int, count: int = None, lag: int = 0) -> np.ndarray:
+        """
+        Overlapping windows of the history as one strided, read-only view
+        of shape (k, length): windows hop samples apart, the last one
+        ending lag samples before the newest. k is count, or as many as fit.
+        """
+        history = self.latest()
+        history = history[:len(history) - lag]
+        fit = (len(history) - length) // hop + 1 if len(history) >= length else 0
+        k = fit if count is None else min(count, fit)
+        start = len(history) - length - (k - 1) * hop if k else len(history)
+        base = history[start:]
+        step = base.strides[0]
+        return as_strided(base, shape=(k, length), strides=(hop * step, step),
+                          writeable=False)
@@ -1,8 +1,12 @@
 """
 CortexKey - Serial Reader
 
-Connects to the ESP32 over a serial port, reads the CSV stream,
-and buffers 2-second windows (500 samples @ 250 Hz).
+Connects to the ESP32 over a serial port, reads the sample stream
+(ASCII "DATA,timestamp,value" lines or binary sample frames),
+and buffers 2-second windows (500 samples @ 250 Hz). Faster device rates
+(RATE 500/1000/2000) are averaged back down to 250 Hz on arrival.
+Samples land in a SampleRing (sample_ring.py): binary frames at 250 Hz
+are decoded straight into it, and windows are views, not copies.
 
 Also exposes a *mock serial* mode that generates data in software
 so the backend can run without any hardware attached.
@@ -16,7 +20,9 @@ When the BioAmp EXG Pill arrives:
 
 import threading
 import time
-import collections
+import struct
+from collections import deque
+
 import numpy as np
 
 try:
@@ -27,13 +33,66 @@ except ImportError:
     HAS_SERIAL = False
 
 from eeg_pipeline import generate_auth_user, generate_impostor
+from sample_ring import SampleRing
 
 # ---------------------------------------------------------------------------
 # Constants
 # ---------------------------------------------------------------------------
 FS = 250
 WINDOW_SIZE = 500          # 2 seconds
-BAUD = 115200
+HISTORY_SIZE = 4 * WINDOW_SIZE   # samples kept for get_latest() / read_since()
+BAUD = 115200              # ESP32 boot rate
+LINK_BAUD = 921600         # negotiated with BAUD after connect; BAUD keeps the boot rate
+BAUD_CONFIRM_S = 1.0       # device reverts an unconfirmed switch after this (BAUD_CONFIRM_MS)
+WAKE_IDLE_S = 1.0          # idle device may be in light sleep (POWER_SLEEP_AFTER_MS) by now
+WAKE_GUARD_S = 0.01        # UART wake-up eats the first byte; let the clock settle
+STREAM_FORMAT = "binary"   # "binary" | "ascii" — requested from the ESP32 on connect
+SYNC_ROUNDS = 8            # SYNC exchanges on connect; the device anchors on the fastest
+SYNC_INTERVAL_S = 10.0     # then one per interval while reading, for the drift fit
+DUMP_BAUD = 2000000        # dump_recording() pulls the device's session log at this rate
+LATENCY_HISTORY = 4096     # frame latencies kept for percentiles (frame_latencies())
+
+# Binary sample frames (layout documented in src/protocol.h)
+FRAME_SYNC = b"\xa5\x5a"
+FRAME_HEADER = struct.Struct("<2sBBHHBB")   # sync, type, flags, seq, dt_us, count, channels
+FRAME_CRC_SIZE = 2
+FRAME_MAX_PAYLOAD = 240
+FRAME_TYPE_SAMPLES = 0x01
+FRAME_TYPE_FEATURES = 0x02     # FEATURES mode: uint32 index + float32 vector
+FRAME_TYPE_COMPRESSED = 0x03   # COMPRESSED mode: delta + Rice coded samples
+FRAME_TYPE_STATS = 0x04        # stream health record (LinkStats, uint32 fields)
+FRAME_TYPE_PERF = 0x05         # PERF telemetry (PerfReport, uint32 fields)
+FRAME_TYPE_CONFIG = 0x06       # CONFIG record (DeviceConfig, uint32 fields), both ways
+FRAME_TYPE_SESSION = 0x07      # recorder log: start of a session (SessionRecord), DUMP only
+FRAME_FLAG_INT24 = 0x01
+FRAME_FLAG_FILTERED = 0x02  # device already applied notch + bandpass
+FRAME_FLAG_DELTA2 = 0x04    # compressed frame uses the second-order predictor
+FRAME_FLAG_ARTIFACT = 0x08  # frame (or feature window) holds artifact-flagged samples
+FRAME_FLAG_TIMESTAMP = 0x10 # uint64 time_us of the first sample follows the header
+FRAME_FLAG_HOST_TIME = 0x20 # time_us is on the host clock (SYNC), not device uptime
+FRAME_TIME = struct.Struct("<Q")
+RICE_ESCAPE = 16
+STATS_FIELDS = ("index", "sent", "overruns", "tx_drops", "backlog_peak", "time_us")
+PERF_BUCKETS = 16
+PERF_FIELDS = (
+    "loop_min_us", "loop_avg_us", "loop_p99_us", "loop_max_us",
+    "acq_min_us", "acq_avg_us", "acq_p99_us", "acq_max_us",
+    "jitter_avg_us", "jitter_p99_us", "jitter_max_us",
+    "tx_bytes_per_s", "sample_ring_peak", "tx_block_peak",
+    "free_heap", "min_free_heap", "idle0_permille", "idle1_permille",
+)
+CONFIG_VERSION = 1         # src/config_store.h; the device rejects any other layout
+CONFIG_GAINS = 8           # EEG_MAX_CHANNELS: per-channel GAIN words at the end
+CONFIG_FIELDS = (
+    "version", "rate", "oversample", "decim_filter", "channel_mask", "format",
+    "compress_order", "block_samples", "feature_hop", "filter", "notch_hz",
+    "artifact", "mock", "baud", "autostart", "quiet_boot",
+)
+SESSION_FIELDS = (
+    "session", "label", "rate", "channel_mask", "filtered", "synced",
+    "host_offset_lo", "host_offset_hi",
+)
+_MAX_TEXT_BUFFER = 4096    # drop runaway text without a newline
 
 # Keywords that identify an ESP32 / CH340 / CP210x serial port
 _ESP32_PORT_HINTS = [
@@ -42,6 +101,295 @@ _ESP32_PORT_HINTS = [
 ]
 
 
+def host_time_us() -> int:
+    """This host's clock in microseconds: the timeline SYNC maps the device onto."""
+    return time.time_ns() // 1000
+
+
+def decode_rice_residuals(raw: bytes, count: int, channels: int, flags: int) -> list:
+    """
+    Decode a FRAME_TYPE_COMPRESSED payload (layout in src/protocol.h) into
+    count * channels quantized integers, interleaved by sample set.
+    Raises ValueError on a truncated bitstream.
+    """
+    width = 3 if flags & FRAME_FLAG_INT24 else 2
+    ks = raw[1:1 + channels]
+    pos = 1 + channels
+    prev1 = []
+    for _ in range(channels):
+        v = int.from_bytes(raw[pos:pos + width], "little", signed=True)
+        prev1.append(v)
+        pos += width
+    prev2 = list(prev1)
+    out = list(prev1)
+
+    bits = int.from_bytes(raw[pos:], "big")
+    nbits = (len(raw) - pos) * 8
+    bitpos = 0
+
+    def read(n):
+        nonlocal bitpos
+        if bitpos + n > nbits:
+            raise ValueError("truncated compressed frame")
+        bitpos += n
+        return (bits >> (nbits - bitpos)) & ((1 << n) - 1)
+
+    order2 = bool(flags & FRAME_FLAG_DELTA2)
+    for n in range(1, count):
+        for ch in range(channels):
+            q = 0
+            while q < RICE_ESCAPE and read(1):
+                q += 1
+            if q == RICE_ESCAPE:
+                u = read(32)
+            else:
+                u = (q << ks[ch]) | read(ks[ch])
+            residual = (u >> 1) ^ -(u & 1)
+            pred = 2 * prev1[ch] - prev2[ch] if order2 and n > 1 else prev1[ch]
+            x = pred + residual
+            prev2[ch], prev1[ch] = prev1[ch], x
+            out.append(x)
+    return out
+
+
+def parse_stats_line(line: str):
+    """Fields of a "STATS:index,sent,..." line as a dict, or None if malformed."""
+    try:
+        values = [int(v) for v in line[len("STATS:"):].split(",")]
+    except ValueError:
+        return None
+    if len(values) != len(STATS_FIELDS):
+        return None
+    return dict(zip(STATS_FIELDS, values))
+
+
+def decode_perf(values) -> dict:
+    """PerfReport uint32 words (src/protocol.h) as a dict; jitter_hist is a list."""
+    perf = dict(zip(PERF_FIELDS, values))
+    perf["jitter_hist"] = list(values[len(PERF_FIELDS):len(PERF_FIELDS) + PERF_BUCKETS])
+    return perf
+
+
+def decode_config(values) -> dict:
+    """DeviceConfig uint32 words (src/protocol.h) as a dict; gain is a list."""
+    config = dict(zip(CONFIG_FIELDS, values))
+    config["gain"] = list(values[len(CONFIG_FIELDS):len(CONFIG_FIELDS) + CONFIG_GAINS])
+    return config
+
+
+def decode_session(values) -> dict:
+    """SessionRecord uint32 words as a dict; host_offset_us joins the int64 halves."""
+    record = dict(zip(SESSION_FIELDS, values))
+    offset = record.pop("host_offset_lo") | record.pop("host_offset_hi") << 32
+    record["host_offset_us"] = offset - (1 << 64) if offset >> 63 else offset
+    return record
+
+
+def parse_perf_line(line: str) -> dict:
+    """
+    "PERF:Loop=1/2/3/4,...,Idle0=97.1%" as a dict: integers, lists of
+    integers for slash-separated values, percentages as floats.
+    """
+    out = {}
+    for field in line[len("PERF:"):].split(","):
+        key, _, value = field.partition("=")
+        try:
+            if "/" in value:
+                out[key] = [int(v) for v in value.split("/")]
+            elif value.endswith("%"):
+                out[key] = float(value[:-1])
+            else:
+                out[key] = int(value)
+        except ValueError:
+            out[key] = value
+    return out
+
+
+def parse_auth_line(line: str) -> dict:
+    """
+    "AUTH:Result=ACCEPT,Test=VALID,Mean=0.997,..." or "AUTH:Window=2,P=..."
+    from an on-device session as a dict: integers, floats, else strings.
+    """
+    return parse_fields(line[len("AUTH:"):])
+
+
+def parse_sync_line(line: str) -> dict:
+    """
+    "SYNC:T1=,T2=,T3=[,Offset=,Rtt=,Drift=,Exchanges=]" reply to a SYNC
+    request as a dict (parse_fields()).
+    """
+    return parse_fields(line[len("SYNC:"):])
+
+
+def parse_fields(text: str) -> dict:
+    """"Key=value,..." as a dict: integers, floats, else strings."""
+    out = {}
+    for field in text.split(","):
+        key, _, value = field.partition("=")
+        for kind in (int, float):
+            try:
+                out[key] = kind(value)
+                break
+            except ValueError:
+                pass
+        else:
+            out[key] = value
+    return out
+
+
+class StreamMonitor:
+    """
+    Gap detector and loss / latency accounting for one device stream.
+
+    Feed it every frame header (on_frame), every ASCII sample timestamp
+    (on_line_sample), every STATS record (on_stats) and every line that
+    failed to parse (on_malformed). It separates:
+      - lost_frames: gaps in the frame seq (link or host drops)
+      - gap_samples: samples missing between consecutive frames / lines,
+        from dt_us or the timestamps (device or link, seen immediately)
+      - overruns / tx_drops: what the device itself dropped (from STATS)
+      - link_lost: samples the device sent that never arrived (from STATS;
+        includes frames the device dropped in tx_drops)
+    Latency is the arrival time of STATS records against the device
+    clock, above the fastest record seen, so it reads 0 on an idle link and
+    grows with buffering anywhere between the sampler and this process.
+    Frames stamped on the host clock (FRAME_FLAG_HOST_TIME, after SYNC)
+    also give frame_latency_ms: the age of their last sample on arrival
+    (the newest LATENCY_HISTORY of them in frame_latencies), and
+    newest_sample_us: that sample's host time.
+    """
+
+    def __init__(self, rate: int = FS):
+        self.rate = rate
+        self.reset()
+
+    def reset(self):
+        self.frames = 0
+        self.lost_frames = 0
+        self.gaps = 0
+        self.gap_samples = 0
+        self.malformed = 0
+        self.received = 0
+        self.restarts = 0
+        self.link_lost = 0
+        self.device = {}
+        self.latency_ms = 0.0
+        self.latency_max_ms = 0.0
+        self.backlog_ms = 0.0
+        self.frame_latency_ms = None
+        self.frame_latencies = deque(maxlen=LATENCY_HISTORY)
+        self.newest_sample_us = None
+        self.resync()
+
+    def resync(self):
+        """Forget continuity state (new stream or reconnect); totals stay."""
+        self._next_seq = None
+        self._last_count = None        # samples in the previous sample frame
+        self._last_ts = None           # previous ASCII timestamp (ms)
+        self._samples_seen = False     # FEATURES streams send no samples to count
+        self._base = None              # (sent, received) at the first STATS
+        self._lost_before = self.link_lost
+        self._offset_min = None
+        self._last_time_us = None
+        self._time_wraps = 0
+
+    def _restart(self):
+        """START (or a format switch) on the device."""
+        self.resync()
+        self.restarts += 1
+
+    def on_frame(self, kind: str, header: dict, arrival: float = None):
+        """kind is the FrameDecoder item type ("frame", "features", "stats", ...)."""
+        self.frames += 1
+        if header.get("host_time") and header["time_us"] is not None:
+            last_us = header["time_us"]
+            if kind == "frame":
+                last_us += (header["count"] - 1) * 1e6 / self.rate
+            now = arrival if arrival is not None else time.time()
+            self.frame_latency_ms = (now * 1e6 - last_us) / 1000.0
+            self.frame_latencies.append(self.frame_latency_ms)
+            if kind == "frame":
+                self.newest_sample_us = last_us
+        seq = header["seq"]
+        if kind in ("frame", "features") and header["dt_us"] == 0:
+            self._restart()            # first frame after START
+        elif self._next_seq is not None:
+            gap = (seq - self._next_seq) & 0xFFFF
+            if gap >= 0x8000:
+                self._restart()        # seq went back: stream restarted
+            elif gap:
+                self.lost_frames += gap
+                self._last_count = None
+        self._next_seq = (seq + 1) & 0xFFFF
+
+        if kind != "frame":
+            return
+        if self._last_count is not None and header["dt_us"] < 0xFFFF:
+            missing = round(header["dt_us"] * self.rate / 1e6) - self._last_count
+            if missing > 0:
+                self.gaps += 1
+                self.gap_samples += missing
+        self._last_count = header["count"]
+        self._samples_seen = True
+        self.received += header["count"]
+
+    def on_line_sample(self, timestamp_ms: int):
+        """One ASCII DATA line (timestamp = sample index x period)."""
+        last, self._last_ts = self._last_ts, timestamp_ms
+        if last is not None and timestamp_ms < last:
+            self._restart()
+        elif last is not None:
+            missing = round((timestamp_ms - last) * self.rate / 1000.0) - 1
+            if missing > 0 and self.rate <= 1000:   # ms timestamps resolve a gap
+                self.gaps += 1
+                self.gap_samples += missing
+        self._samples_seen = True
+        self.received += 1
+
+    def on_stats(self, stats: dict, arrival: float = None):
+        self.device = stats
+        if self._samples_seen:
+            if self._base is None or stats["sent"] < self._base[0]:
+                self._base = (stats["sent"], self.received)
+            sent = stats["sent"] - self._base[0]
+            lost = max(0, sent - (self.received - self._base[1]))
+            self.link_lost = self._lost_before + lost
+
+        if self._last_time_us is not None and stats["time_us"] < self._last_time_us:
+            self._time_wraps += 1
+        self._last_time_us = stats["time_us"]
+        device_us = stats["time_us"] + (self._time_wraps << 32)
+        offset = (arrival if arrival is not None else time.time()) * 1e6 - device_us
+        if self._offset_min is None or offset < self._offset_min:
+            self._offset_min = offset
+        self.latency_ms = (offset - self._offset_min) / 1000.0
+        self.latency_max_ms = max(self.latency_max_ms, self.latency_ms)
+        self.backlog_ms = (stats["time_us"] - stats["index"] * 1e6 / self.rate) / 1000.0
+
+    def on_malformed(self):
+        self.malformed += 1
+
+    def snapshot(self) -> dict:
+        return {
+            "frames": self.frames,
+            "lost_frames": self.lost_frames,
+            "gaps": self.gaps,
+            "gap_samples": self.gap_samples,
+            "received": self.received,
+            "link_lost": self.link_lost,
+            "overruns": self.device.get("overruns", 0),
+            "tx_drops": self.device.get("tx_drops", 0),
+            "backlog_peak": self.device.get("backlog_peak", 0),
+            "backlog_ms": round(self.backlog_ms, 2),
+            "latency_ms": round(self.latency_ms, 2),
+            "latency_max_ms": round(self.latency_max_ms, 2),
+            "frame_latency_ms": (None if self.frame_latency_ms is None
+                                 else round(self.frame_latency_ms, 2)),
+            "malformed": self.malformed,
+            "restarts": self.restarts,
+        }
+
+
 def _find_esp32_port():
     """
     Scan available serial ports and return the first one that looks like
@@ -58,6 +406,201 @@ def _find_esp32_port():
     return None
 
 
+def _make_crc16_table():
+    table = []
+    for i in range(256):
+        crc = i << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+        table.append(crc & 0xFFFF)
+    return table
+
+
+_CRC16_TABLE = _make_crc16_table()
+
+
+def crc16(data, crc: int = 0xFFFF) -> int:
+    """CRC-16/CCITT-FALSE, matching crc16() in the firmware."""
+    for b in data:
+        crc = ((crc << 8) & 0xFFFF) ^ _CRC16_TABLE[((crc >> 8) ^ b) & 0xFF]
+    return crc
+
+
+def encode_config_frame(config: dict) -> bytes:
+    """
+    FRAME_TYPE_CONFIG frame for a decode_config() dict, as the device
+    expects it at the start of a command line (CONFIG frames in
+    src/protocol.h).
+    """
+    values = [int(config[name]) for name in CONFIG_FIELDS] + [int(g) for g in config["gain"]]
+    if len(values) != len(CONFIG_FIELDS) + CONFIG_GAINS:
+        raise ValueError(f"config needs {CONFIG_GAINS} gains")
+    body = FRAME_HEADER.pack(FRAME_SYNC, FRAME_TYPE_CONFIG, 0, 0, 0, 1, len(values))[2:]
+    body += struct.pack(f"<{len(values)}I", *values)
+    return FRAME_SYNC + body + struct.pack("<H", crc16(body))
+
+
+class FrameDecoder:
+    """
+    Incremental decoder for the ESP32 byte stream.
+
+    The stream mixes text lines ("STATUS:...", "DATA,ts,value") with
+    binary sample frames. feed() accepts arbitrary chunks and returns the
+    complete items found so far, as ("text", str),
+    ("frame", header_dict, samples) where samples is a float64 array of
+    shape (count, channels) in microvolts, or
+    ("features", header_dict, vector) for FEATURES mode, with the window
+    end sample index in header_dict["index"], ("stats", header_dict,
+    fields) for stream health records (dict keyed by STATS_FIELDS),
+    ("perf", header_dict, report) for PERF telemetry (decode_perf()) or
+    ("config", header_dict, config) for the device configuration
+    (decode_config()) and ("session", header_dict, record) for the
+    session records of a DUMP (decode_session()).
+    Compressed sample frames are expanded and reported as plain
+    ("frame", ...) items.
+
+    With a sink (a SampleRing) set, channel 0 of every sample frame is
+    scaled straight into the ring instead of a new array; the item then
+    carries a (count, 1) view of those ring slots, header["stored"] is
+    True and header["position"] is the ring's `written` after them.
+
+    Every header has "time_us": the frame's FRAME_FLAG_TIMESTAMP stamp in
+    microseconds (first sample; feature frames: window end) or None, and
+    "host_time": whether that stamp is on this host's clock (SYNC).
+    """
+
+    def __init__(self, sink: SampleRing = None):
+        self._buf = bytearray()
+        self.frames = 0
+        self.crc_errors = 0
+        self.sink = sink
+
+    def feed(self, data: bytes) -> list:
+        self._buf += data
+        out = []
+        buf = self._buf
+        while buf:
+            start = buf.find(FRAME_SYNC)
+            if start < 0:
+                # Text only: emit complete lines, keep the tail (which may
+                # end in the first sync byte of a frame still arriving).
+                end = buf.rfind(b"\n")
+                if end >= 0:
+                    self._emit_text(buf[:end + 1], out)
+                    del buf[:end + 1]
+                if len(buf) > _MAX_TEXT_BUFFER:
+                    del buf[:-1]
+                break
+            if start > 0:
+                self._emit_text(buf[:start], out)
+                del buf[:start]
+
+            if len(buf) < FRAME_HEADER.size:
+                break
+            _, ftype, flags, seq, dt_us, count, channels = FRAME_HEADER.unpack_from(buf)
+            body_at = FRAME_HEADER.size     # payload offset
+            if flags & FRAME_FLAG_TIMESTAMP:
+                body_at += FRAME_TIME.size
+            if ftype == FRAME_TYPE_FEATURES:
+                width = 4
+                payload = 4 + count * channels * width
+            elif ftype in (FRAME_TYPE_STATS, FRAME_TYPE_PERF, FRAME_TYPE_CONFIG,
+                           FRAME_TYPE_SESSION):
+                width = 4
+                payload = count * channels * width
+            elif ftype == FRAME_TYPE_COMPRESSED:
+                if len(buf) <= body_at:
+                    break
+                width = 3 if flags & FRAME_FLAG_INT24 else 2
+                payload = buf[body_at]
+            else:
+                width = 3 if flags & FRAME_FLAG_INT24 else 2
+                payload = count * channels * width
+            if (ftype not in (FRAME_TYPE_SAMPLES, FRAME_TYPE_FEATURES,
+                              FRAME_TYPE_COMPRESSED, FRAME_TYPE_STATS, FRAME_TYPE_PERF,
+                              FRAME_TYPE_CONFIG, FRAME_TYPE_SESSION)
+                    or channels == 0 or payload > FRAME_MAX_PAYLOAD):
+                del buf[:1]        # false sync — resynchronise
+                continue
+            total = body_at + payload + FRAME_CRC_SIZE
+            if len(buf) < total:
+                break
+
+            body = bytes(buf[2:total - FRAME_CRC_SIZE])
+            (crc,) = struct.unpack_from("<H", buf, total - FRAME_CRC_SIZE)
+            if crc16(body) != crc:
+                self.crc_errors += 1
+                del buf[:1]
+                continue
+
+            raw = body[body_at - 2:]
+            header = {"seq": seq, "dt_us": dt_us, "flags": flags,
+                      "count": count, "channels": channels,
+                      "time_us": None, "host_time": bool(flags & FRAME_FLAG_HOST_TIME)}
+            if flags & FRAME_FLAG_TIMESTAMP:
+                (header["time_us"],) = FRAME_TIME.unpack_from(body, FRAME_HEADER.size - 2)
+            if ftype == FRAME_TYPE_FEATURES:
+                (header["index"],) = struct.unpack_from("<I", raw)
+                vector = np.frombuffer(raw, dtype="<f4", offset=4).astype(np.float64)
+                out.append(("features", header, vector))
+            elif ftype == FRAME_TYPE_STATS:
+                values = struct.unpack_from(f"<{count * channels}I", raw)
+                out.append(("stats", header, dict(zip(STATS_FIELDS, values))))
+            elif ftype == FRAME_TYPE_PERF:
+                values = struct.unpack_from(f"<{count * channels}I", raw)
+                out.append(("perf", header, decode_perf(values)))
+            elif ftype == FRAME_TYPE_CONFIG:
+                values = struct.unpack_from(f"<{count * channels}I", raw)
+                out.append(("config", header, decode_config(values)))
+            elif ftype == FRAME_TYPE_SESSION:
+                values = struct.unpack_from(f"<{count * channels}I", raw)
+                out.append(("session", header, decode_session(values)))
+            elif ftype == FRAME_TYPE_COMPRESSED:
+                try:
+                    ints = decode_rice_residuals(raw, count, channels, flags)
+                except ValueError:
+                    self.crc_errors += 1
+                    del buf[:total]
+                    continue
+                ints = np.array(ints, dtype=np.int32).reshape(count, channels)
+                out.append(("frame", header, self._scale_samples(ints, width, header)))
+            else:
+                ints = self._decode_ints(raw, width).reshape(count, channels)
+                out.append(("frame", header, self._scale_samples(ints, width, header)))
+            self.frames += 1
+            del buf[:total]
+        return out
+
+    @staticmethod
+    def _emit_text(chunk, out):
+        for line in bytes(chunk).split(b"\n"):
+            line = line.decode("utf-8", errors="replace").strip()
+            if line:
+                out.append(("text", line))
+
+    @staticmethod
+    def _decode_ints(raw: bytes, width: int) -> np.ndarray:
+        """Quantized samples of a plain frame payload (int16 is a view of raw)."""
+        if width == 2:
+            return np.frombuffer(raw, dtype="<i2")
+        b = np.frombuffer(raw, dtype=np.uint8).reshape(-1, 3).astype(np.int32)
+        v = b[:, 0] | (b[:, 1] << 8) | (b[:, 2] << 16)
+        return np.where(v & 0x800000, v - 0x1000000, v)
+
+    def _scale_samples(self, ints: np.ndarray, width: int, header: dict) -> np.ndarray:
+        """Microvolts of a (count, channels) block, into the sink when there is one."""
+        scale = 0.001 if width == 3 else 0.1
+        if self.sink is None:
+            return ints * scale
+        count = len(ints)
+        slot = self.sink.reserve(count)
+        np.multiply(ints[:, 0], scale, out=slot)
+        self.sink.commit(count)
+        header["stored"] = True
+        header["position"] = self.sink.written
+        return slot.reshape(count, 1)
+
+
 class SerialReader:
     """
     Reads EEG samples from the ESP32 serial port (or generates mock data).
@@ -65,7 +608,7 @@ class SerialReader:
     """
 
     def __init__(self):
-        self._buffer = collections.deque(maxlen=WINDOW_SIZE)
+        self._ring = SampleRing(HISTORY_SIZE)   # channel 0 at FS
         self._lock = threading.Lock()
         self._thread = None
         self._running = False
@@ -79,6 +622,24 @@ class SerialReader:
         self._signal_min = -5.0
         self._signal_max = 5.0
         self._gain_samples = 0
+        self._decoder = FrameDecoder(self._ring)
+        self._prefiltered = False     # latest frames carried FRAME_FLAG_FILTERED
+        self._features = None         # latest on-device feature vector (FEATURES mode)
+        self._artifact_mark = 0       # ring position after the last FRAME_FLAG_ARTIFACT frame
+        self._artifact_frames = 0     # frames flagged by the device's artifact detector
+        self._device_rate = FS        # ESP32 sample rate (from "STATUS:Rate" / "Rate=")
+        self._decim_carry = np.empty(0)
+        self._monitor = StreamMonitor()
+        self._perf = None             # latest PERF telemetry (frame or PERF: line)
+        self._last_tx = 0.0           # time.time() of the last command written
+        self._auth = None             # latest on-device session (AUTH: lines)
+        self._tx_lock = threading.Lock()  # commands vs the read thread's SYNC requests
+        self._sync_t4 = None          # arrival of the last SYNC reply, sent with the next request
+        self._sync_last = 0.0         # time.time() of the last SYNC request
+        self._chunk_us = 0            # host_time_us() when the chunk being decoded arrived
+        self._clock = None            # device's fit from the last SYNC reply that had one
+        self._config = None           # latest CONFIG frame (stored settings of the device)
+        self.device_model_version = None   # MODEL_VERSION from a STATUS reply
 
     # ------------------------------------------------------------------
     # Public API
@@ -92,11 +653,104 @@ class SerialReader:
     def mock_mode(self) -> str:
         return "hardware" if self._hardware_mode else self._mock_mode
 
+    @property
+    def prefiltered(self) -> bool:
+        """True when the ESP32 is streaming samples it already filtered."""
+        return self._prefiltered and not self._use_mock
+
+    @property
+    def device_rate(self) -> int:
+        """Sample rate the ESP32 reports; the window is always kept at FS."""
+        return self._device_rate
+
     @property
     def hardware_mode(self) -> bool:
         """True when reading from real BioAmp EXG Pill sensor."""
         return self._hardware_mode
 
+    def link_stats(self) -> dict:
+        """Loss, gap and latency counters of the hardware stream (StreamMonitor)."""
+        stats = self._monitor.snapshot()
+        stats["crc_errors"] = self._decoder.crc_errors
+        stats["artifact_frames"] = self._artifact_frames
+        stats["clock"] = self._clock
+        return stats
+
+    def reset_link_stats(self):
+        """Zero the link_stats() counters, e.g. between benchmark streams."""
+        self._monitor.reset()
+        self._decoder.crc_errors = 0
+        self._artifact_frames = 0
+
+    def frame_latencies(self) -> list:
+        """
+        Arrival latency (ms) of recent host-stamped frames, oldest first:
+        the newest of StreamMonitor's LATENCY_HISTORY, for percentiles.
+        """
+        return list(self._monitor.frame_latencies)
+
+    def newest_sample_us(self):
+        """
+        Host time (host_time_us()) of the newest sample that came in a
+        host-stamped frame, or None: how old the latest window is.
+        """
+        return self._monitor.newest_sample_us
+
+    def device_clock(self):
+        """
+        The device's host clock fit after SYNC: {"offset_us": host - device,
+        "rtt_us", "drift_ppm", "exchanges"}, or None before the first
+        completed exchange.
+        """
+        return self._clock
+
+    def device_config(self):
+        """
+        The device's configuration from its last CONFIG frame (read_config()
+        or write_config()) as a decode_config() dict, or None.
+        """
+        return self._config
+
+    def read_config(self):
+        """Ask for the device configuration; the reply updates device_config()."""
+        self.send_command("CONFIG")
+
+    def write_config(self, **changes) -> bool:
+        """
+        Send device_config() with *changes* applied (e.g. rate=500,
+        autostart=1, gain=[...]) as a CONFIG frame. The idle device
+        applies and stores it, then echoes the frame; a baud change takes
+        effect from its next boot. Returns False before a CONFIG frame
+        arrived to start from.
+        """
+        if self._config is None:
+            return False
+        unknown = set(changes) - set(CONFIG_FIELDS) - {"gain"}
+        if unknown:
+            raise ValueError(f"unknown config fields: {sorted(unknown)}")
+        frame = encode_config_frame(dict(self._config, **changes))
+        if self._serial and self._serial.is_open:
+            try:
+                with self._tx_lock:
+                    # The device reads a frame only at the start of a line
+                    self._serial.write(b"\n" + frame)
+                    self._last_tx = time.time()
+            except Exception:
+                return False
+        return True
+
+    def device_perf(self):
+        """Latest PERF telemetry from the ESP32 (enable with PERF <seconds>), or None."""
+        return self._perf
+
+    def device_auth(self):
+        """
+        Latest on-device session (AUTH command or a button test with
+        AUTH ON): {"window": last AUTH:Window fields, "result": the
+        AUTH:Result fields once decided}, or None.
+        """
+        return self._auth
+
     def list_ports(self):
         """Return available serial ports with descriptions."""
         if not HAS_SERIAL:
@@ -119,15 +773,17 @@ class SerialReader:
 
         if target_port and HAS_SERIAL:
             try:
-                self._serial = serial.Serial(target_port, BAUD, timeout=1)
+                self._serial = self._open_port(target_port)
                 self._use_mock = False
                 self._hardware_mode = True
                 self._port = target_port
                 self._connected = True
-                print(f"[serial] Connected to ESP32 on {target_port}")
-                # Wait for ESP32 startup banner
-                time.sleep(0.5)
-                self._flush_startup()
+                print(f"[serial] Connected to ESP32 on {target_port} "
+                      f"at {self._serial.baudrate} baud")
+                self.negotiate_baud(LINK_BAUD)
+                self.sync_clock()
+                self.set_stream_format(STREAM_FORMAT)
+                self.read_config()
                 return
             except Exception as e:
                 print(f"[serial] Cannot open {target_port}: {e}  → falling back to mock")
@@ -139,20 +795,46 @@ class SerialReader:
         self._connected = True
         print("[serial] Using software mock data (no hardware detected)")
 
-    def _flush_startup(self):
-        """Drain any ESP32 startup banner lines (CMD:... lines)."""
+    def _open_port(self, port: str):
+        """
+        Open *port* at the device's boot rate. That is BAUD unless a stored
+        configuration changed it, so when the startup lines do not arrive
+        (the device booted earlier, or at another rate) each candidate
+        rate is probed with a STATUS request.
+        """
+        link = serial.Serial(port, BAUD, timeout=1)
+        self._serial = link
+        time.sleep(0.5)                 # Wait for ESP32 startup banner
+        if self._flush_startup():
+            return link
+        for baud in (BAUD, LINK_BAUD):
+            link.baudrate = baud
+            link.reset_input_buffer()
+            link.write(b"\nSTATUS\n")
+            if self._wait_prefix("STATUS:Mode="):
+                return link
+        link.baudrate = BAUD
+        return link
+
+    def _flush_startup(self) -> bool:
+        """
+        Drain any ESP32 startup banner lines (CMD:... lines). Returns True
+        once the ready line arrived; a quiet boot sends only that line,
+        without the CMD: prefix.
+        """
         if not self._serial:
-            return
+            return False
         deadline = time.time() + 2.0
         while time.time() < deadline:
             try:
                 line = self._serial.readline().decode("utf-8", errors="replace").strip()
                 if line:
                     print(f"[serial] ESP32 → {line}")
-                if line == "CMD:CORTEXKEY_READY":
-                    break
+                if line.endswith("CORTEXKEY_READY"):
+                    return True
             except Exception:
                 break
+        return False
 
     def start(self):
         """Begin reading (in a background thread)."""
@@ -183,40 +865,268 @@ class SerialReader:
         Also relays the command to the ESP32 if connected over serial.
         """
         self._mock_mode = mode
-        if self._serial and self._serial.is_open:
-            cmd = "MOCK_AUTH\n" if mode == "auth" else "MOCK_IMP\n"
+        self.send_command("MOCK_AUTH" if mode == "auth" else "MOCK_IMP")
+
+    def negotiate_baud(self, baud: int) -> bool:
+        """
+        BAUD handshake: request *baud*, wait for "ACK:BAUD <baud>", switch
+        the local port and confirm at the new rate. Any failure leaves
+        both ends at the current rate (the ESP32 reverts on its own when
+        no confirm arrives). Only call while the read thread is stopped.
+        """
+        if not self._serial or baud == self._serial.baudrate:
+            return False
+        if self._thread and self._thread.is_alive():
+            return False
+        old = self._serial.baudrate
+        self._serial.reset_input_buffer()
+        self.send_command(f"BAUD {baud}")
+        if not self._wait_line(f"ACK:BAUD {baud}"):
+            print(f"[serial] BAUD {baud} not supported — staying at {old}")
+            return False
+
+        self._serial.baudrate = baud
+        time.sleep(0.05)
+        self._serial.reset_input_buffer()
+        self.send_command("BAUD CONFIRM")
+        if self._wait_line(f"STATUS:Baud {baud}"):
+            print(f"[serial] Link at {baud} baud")
+            return True
+
+        print(f"[serial] No confirm at {baud} — back to {old}")
+        self._serial.baudrate = old
+        time.sleep(BAUD_CONFIRM_S + 0.2)
+        self._serial.reset_input_buffer()
+        return False
+
+    def sync_clock(self, rounds: int = SYNC_ROUNDS) -> bool:
+        """
+        Burst of SYNC exchanges so frames carry host time from the first
+        START. The read thread then keeps one going every SYNC_INTERVAL_S
+        for the drift fit. Only call while the read thread is stopped (like
+        negotiate_baud). Returns True once the device reports a fit.
+        """
+        if not self._serial:
+            return False
+        if self._thread and self._thread.is_alive():
+            return False
+        self._serial.reset_input_buffer()
+        self._sync_t4 = None
+        for _ in range(rounds + 1):       # the last request completes the last exchange
+            self._send_sync()
+            deadline = time.time() + 1.0
+            while time.time() < deadline:
+                try:
+                    raw = self._serial.readline()
+                except Exception:
+                    return False
+                self._chunk_us = host_time_us()
+                line = raw.decode("utf-8", errors="replace").strip()
+                line = line[line.find("SYNC:"):] if "SYNC:" in line else line
+                if line.startswith("SYNC:") or line.startswith("ERROR:"):
+                    break
+            else:
+                line = ""
+            if not line.startswith("SYNC:"):
+                print("[serial] No SYNC reply — frames keep device time")
+                return False
+            self._on_sync_reply(line)
+        if self._clock is None:
+            return False
+        print(f"[serial] Clock synced: offset {self._clock['offset_us']} us, "
+              f"rtt {self._clock['rtt_us']} us")
+        return True
+
+    def dump_recording(self, path: str, baud: int = DUMP_BAUD) -> dict:
+        """
+        Download the device's session log (DUMP, see src/recorder.h) into
+        *path* as raw frames, for recordings.load_recording() and
+        train_model.py --recordings. The link is raised to *baud* for the
+        burst and returned to LINK_BAUD after. Only call while the read
+        thread is stopped (like negotiate_baud). Returns {"bytes",
+        "sessions", "path"}, or None if the device has no log to send.
+        """
+        if not self._serial:
+            return None
+        if self._thread and self._thread.is_alive():
+            return None
+        self.negotiate_baud(baud)
+        self._serial.reset_input_buffer()
+        self.send_command("DUMP")
+        deadline = time.time() + 2.0
+        reply = ""
+        while time.time() < deadline:
+            line = self._serial.readline().decode("utf-8", errors="replace").strip()
+            if "STATUS:Dump," in line or line.startswith("ERROR:"):
+                reply = line[line.find("STATUS:"):] if "STATUS:" in line else line
+                break
+        if not reply.startswith("STATUS:Dump,"):
+            print(f"[serial] DUMP failed: {reply or 'no reply'}")
+            return None
+        fields = parse_fields(reply[len("STATUS:Dump,"):])
+        size = fields.get("Bytes", 0)
+        data = bytearray()
+        # Twice the wire time, and no less than a few seconds
+        deadline = time.time() + 2.0 + 2 * size * 10 / self._serial.baudrate
+        while len(data) < size and time.time() < deadline:
+            data += self._serial.read(min(size - len(data), 65536))
+        done = self._wait_prefix("STATUS:Dump done")
+        if len(data) < size or not done:
+            print(f"[serial] DUMP cut short: {len(data)} of {size} bytes")
+        with open(path, "wb") as f:
+            f.write(data)
+        print(f"[serial] Dumped {len(data)} bytes, {fields.get('Sessions')} sessions → {path}")
+        self.negotiate_baud(LINK_BAUD)
+        return {"bytes": len(data), "sessions": fields.get("Sessions"), "path": path}
+
+    def _send_sync(self):
+        """
+        One SYNC request: t1 is when its last byte leaves the host (the
+        device stamps t2 once it has the whole line), plus the t4 of the
+        previous reply so the device can complete that exchange.
+        """
+        if not (self._serial and self._serial.is_open):
+            return
+        tail = f" {self._sync_t4}" if self._sync_t4 is not None else ""
+        self._sync_t4 = None
+        self._sync_last = time.time()
+        try:
+            with self._tx_lock:
+                self._wake()
+                now = host_time_us()
+                length = len("SYNC ") + len(str(now)) + len(tail) + 1
+                t1 = now + self._wire_us(length)
+                self._serial.write(f"SYNC {t1}{tail}\n".encode())
+                self._last_tx = time.time()
+        except Exception:
+            pass
+
+    def _on_sync_reply(self, line: str):
+        """
+        "SYNC:..." reply that reached the host at self._chunk_us. Its t4 is
+        when the first byte left the device (the device stamps t3 just
+        before writing it), for the next request.
+        """
+        fields = parse_sync_line(line)
+        if not isinstance(fields.get("T3"), int):
+            return
+        self._sync_t4 = self._chunk_us - self._wire_us(len(line) + 2)
+        if "Offset" in fields:
+            self._clock = {"offset_us": fields.get("Offset"), "rtt_us": fields.get("Rtt"),
+                           "drift_ppm": fields.get("Drift"),
+                           "exchanges": fields.get("Exchanges")}
+
+    def _wire_us(self, nbytes: int) -> int:
+        """Time nbytes take on the UART (8N1: 10 bits per byte)."""
+        return nbytes * 10 * 1_000_000 // self._serial.baudrate
+
+    def _wait_prefix(self, prefix: str, timeout: float = 1.0) -> bool:
+        """Read lines until one holding *prefix* (True) or timeout."""
+        deadline = time.time() + timeout
+        while time.time() < deadline:
             try:
-                self._serial.write(cmd.encode())
+                line = self._serial.readline().decode("utf-8", errors="replace")
             except Exception:
-                pass
+                return False
+            if prefix in line:
+                return True
+        return False
+
+    def _wait_line(self, expected: str, timeout: float = 1.0) -> bool:
+        """Read lines until *expected* (True) or an ERROR: line / timeout."""
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            try:
+                line = self._serial.readline().decode("utf-8", errors="replace").strip()
+            except Exception:
+                return False
+            if line == expected:
+                return True
+            if line.startswith("ERROR:"):
+                return False
+        return False
+
+    def set_stream_format(self, fmt: str):
+        """
+        Ask the ESP32 for 'binary' frames or 'ascii' DATA lines.
+        The decoder accepts both, so older firmware that ignores the
+        command keeps working.
+        """
+        self.send_command("BINARY" if fmt == "binary" else "ASCII")
+
+    def set_rate(self, hz: int):
+        """
+        Ask the ESP32 to sample at *hz* (250/500/1000/2000, idle only).
+        The rate takes effect when the device confirms with STATUS:Rate.
+        """
+        self.send_command(f"RATE {int(hz)}")
 
     def send_command(self, cmd: str):
-        """Send an arbitrary command to the ESP32."""
+        """
+        Send an arbitrary command to the ESP32. After WAKE_IDLE_S of
+        silence the device may be in light sleep, and the byte that wakes
+        it is lost, so a bare newline goes first (an empty line is ignored).
+        """
         if self._serial and self._serial.is_open:
             try:
-                self._serial.write((cmd.strip() + "\n").encode())
+                with self._tx_lock:
+                    self._wake()
+                    self._serial.write((cmd.strip() + "\n").encode())
+                    self._last_tx = time.time()
             except Exception:
                 pass
 
+    def _wake(self):
+        """Newline ahead of a command to an idle (maybe light-sleeping) device."""
+        if time.time() - self._last_tx > WAKE_IDLE_S:
+            self._serial.write(b"\n")
+            self._serial.flush()
+            time.sleep(WAKE_GUARD_S)
+
     def get_window(self):
-        """Return the latest 2-second window (500 samples), or None."""
+        """
+        Return the latest 2-second window (500 samples), or None until it
+        is full and holds no frame the device flagged as an artifact.
+        The window is a read-only view into the ring, not a copy; it stays
+        valid for HISTORY_SIZE more samples.
+        """
+        if len(self._ring) < WINDOW_SIZE or not self.window_clean():
+            return None
+        return self._ring.latest(WINDOW_SIZE)
+
+    def window_clean(self, samples: int = WINDOW_SIZE) -> bool:
+        """True when none of the newest samples came in a FRAME_FLAG_ARTIFACT frame."""
+        return self._artifact_mark <= self._ring.written - samples
+
+    def read_since(self, position=None):
+        """
+        Samples that arrived after stream position `position` (None on the
+        first call) as a read-only ring view, for incremental consumers
+        (eeg_pipeline.IncrementalPipeline). Returns (samples, position,
+        contiguous); pass position back next time. contiguous is False
+        when samples were missed in between (first call, or a reader
+        more than HISTORY_SIZE samples behind).
+        """
+        return self._ring.since(position)
+
+    def get_features(self):
+        """
+        Pop the newest feature vector computed on the ESP32 (FEATURES
+        mode), or None if none arrived since the last call.
+        """
         with self._lock:
-            if len(self._buffer) < WINDOW_SIZE:
-                return None
-            return np.array(list(self._buffer), dtype=np.float64)
+            features, self._features = self._features, None
+        return features
 
     def get_latest(self, n: int = 80) -> list:
         """Return the last *n* samples as a plain list (for the oscilloscope)."""
-        with self._lock:
-            items = list(self._buffer)
-            return items[-n:] if len(items) >= n else items
+        return self._ring.latest(n).tolist()
 
     def get_signal_stats(self) -> dict:
         """Return live signal statistics — useful for electrode contact check."""
-        with self._lock:
-            if not self._buffer:
-                return {"min": 0, "max": 0, "rms": 0, "samples": 0}
-            data = np.array(list(self._buffer))
+        data = self._ring.latest(WINDOW_SIZE)
+        if not len(data):
+            return {"min": 0, "max": 0, "rms": 0, "samples": 0}
         return {
             "min": round(float(data.min()), 3),
             "max": round(float(data.max()), 3),
@@ -237,15 +1147,20 @@ class SerialReader:
 
     def _serial_loop(self):
         """
-        Read CSV lines from the ESP32.
-        Format: timestamp_ms,raw_adc,millivolts\\n
+        Read the ESP32 byte stream and decode it incrementally.
+        Accepts binary sample frames and ASCII lines
+        ("DATA,timestamp,ch0[,ch1...]" or legacy "timestamp,raw_adc,millivolts").
+        Only channel 0 feeds the authentication window.
         Handles disconnects and tries to reconnect automatically.
         """
         consecutive_errors = 0
         while self._running:
             try:
-                raw_line = self._serial.readline()
-                if not raw_line:
+                if time.time() - self._sync_last >= SYNC_INTERVAL_S:
+                    self._send_sync()
+                chunk = self._serial.read(self._serial.in_waiting or 1)
+                self._chunk_us = host_time_us()
+                if not chunk:
                     consecutive_errors += 1
                     if consecutive_errors > 50:
                         print("[serial] Too many empty reads — reconnecting…")
@@ -253,28 +1168,157 @@ class SerialReader:
                     continue
                 consecutive_errors = 0
 
-                line = raw_line.decode("utf-8", errors="replace").strip()
-                if not line or line.startswith("CMD:"):
-                    continue
-
-                parts = line.split(",")
-                if len(parts) >= 3:
-                    mv = float(parts[2])
-                    # Adaptive gain: keep track of the real signal range
-                    self._update_gain(mv)
-                    with self._lock:
-                        self._buffer.append(mv)
+                for item in self._decoder.feed(chunk):
+                    if item[0] == "config":
+                        self._config = item[2]      # seq 0, outside the stream
+                        continue
+                    if item[0] == "session":
+                        continue                    # only in a DUMP
+                    if item[0] != "text":
+                        self._monitor.on_frame(item[0], item[1], self._chunk_us / 1e6)
+                    if item[0] == "frame":
+                        flags = item[1]["flags"]
+                        self._prefiltered = bool(flags & FRAME_FLAG_FILTERED)
+                        self._push_samples(item[2][:, 0], bool(flags & FRAME_FLAG_ARTIFACT),
+                                           item[1].get("position"))
+                    elif item[0] == "features":
+                        if item[1]["flags"] & FRAME_FLAG_ARTIFACT:
+                            self._artifact_frames += 1   # window not worth classifying
+                            continue
+                        with self._lock:
+                            self._features = item[2]
+                    elif item[0] == "stats":
+                        self._monitor.on_stats(item[2])
+                    elif item[0] == "perf":
+                        self._perf = item[2]
+                    else:
+                        self._handle_text(item[1])
 
             except serial.SerialException:
                 print("[serial] Disconnected — retrying in 2s…")
                 time.sleep(2)
                 self._reconnect()
-            except (ValueError, UnicodeDecodeError):
-                pass  # malformed line — skip it
             except Exception as e:
                 print(f"[serial] Unexpected error: {e}")
                 time.sleep(0.01)
 
+    def _handle_text(self, line: str):
+        """Parse one ASCII line; non-sample lines are ignored."""
+        if line.startswith("STATUS:"):
+            self._parse_rate(line)
+            self._parse_model_version(line)
+            return
+        if line.startswith("STATS:"):
+            stats = parse_stats_line(line)
+            if stats is None:
+                self._monitor.on_malformed()
+            else:
+                self._monitor.on_stats(stats)
+            return
+        if line.startswith("PERF:"):
+            self._perf = parse_perf_line(line)
+            return
+        if line.startswith("SYNC:"):
+            self._on_sync_reply(line)
+            return
+        if line.startswith("AUTH:"):
+            fields = parse_auth_line(line)
+            if "Window" in fields:
+                if self._auth is None or self._auth.get("result") is not None:
+                    self._auth = {"window": None, "result": None}   # new session
+                self._auth["window"] = fields
+            else:
+                self._auth = dict(self._auth or {"window": None}, result=fields)
+                print(f"[serial] Device auth {fields.get('Result')}")
+            return
+        if line.startswith("CMD:"):
+            return
+        parts = line.split(",")
+        if len(parts) >= 3:
+            try:
+                mv = float(parts[2])
+                ts = int(parts[1] if parts[0] == "DATA" else parts[0])
+            except ValueError:
+                self._monitor.on_malformed()
+                return  # malformed line — skip it
+            self._monitor.on_line_sample(ts)
+            self._prefiltered = False
+            if self._device_rate != FS:
+                self._push_samples(np.array([mv]))
+                return
+            self._update_gain(mv)
+            self._ring.append(mv)           # ASCII lines are never artifact-flagged
+
+    def _parse_rate(self, line: str):
+        """Pick the device rate out of "STATUS:Rate N Hz" or a STATUS reply."""
+        text = None
+        if line.startswith("STATUS:Rate "):
+            text = line[len("STATUS:Rate "):].split()[0]
+        elif ",Rate=" in line:
+            text = line.split(",Rate=", 1)[1].split(",")[0]
+        if text is None:
+            return
+        try:
+            rate = int(text)
+        except ValueError:
+            return
+        if rate > 0 and rate != self._device_rate:
+            self._device_rate = rate
+            self._monitor.rate = rate
+            self._decim_carry = np.empty(0)
+            # Frames at FS go straight into the ring; faster ones are decimated first
+            self._decoder.sink = self._ring if rate == FS else None
+            print(f"[serial] Device rate {rate} Hz")
+
+    def _parse_model_version(self, line: str):
+        """Note the firmware's Model= and warn when it is not our SVM."""
+        if ",Model=" not in line:
+            return
+        version = line.split(",Model=", 1)[1].split(",")[0]
+        if version == self.device_model_version:
+            return
+        self.device_model_version = version
+        from ml_model import model_version
+        try:
+            ours = model_version()
+        except OSError:
+            return
+        if version != ours:
+            print(f"[serial] Device model {version} != backend model {ours}: "
+                  "run train_model.py (or tools/export_model.py) and reflash")
+
+    def _decimate(self, values: np.ndarray) -> np.ndarray:
+        """
+        Bring samples at an integer multiple of FS down to FS by averaging
+        each group of rate / FS samples (carried over between frames).
+        """
+        k = self._device_rate // FS
+        if k <= 1 or self._device_rate % FS:
+            return values
+        if self._decim_carry.size:
+            values = np.concatenate((self._decim_carry, values))
+        n = len(values) - len(values) % k
+        self._decim_carry = values[n:]
+        return values[:n].reshape(-1, k).mean(axis=1)
+
+    def _push_samples(self, values: np.ndarray, artifact: bool = False,
+                      position: int = None):
+        """
+        Append a block of decoded samples to the ring, unless the decoder
+        already wrote them there (position: ring position after them).
+        artifact: the frame carried FRAME_FLAG_ARTIFACT, so get_window()
+        holds off until it has left the window.
+        """
+        if position is None:
+            values = self._decimate(values)
+            self._ring.extend(values)
+            position = self._ring.written
+        if artifact:
+            self._artifact_frames += 1
+            self._artifact_mark = position
+        if len(values):
+            self._update_gain_block(values)
+
     def _reconnect(self):
         """Try to re-open the serial port after a disconnect."""
         if self._serial:
@@ -284,9 +1328,14 @@ class SerialReader:
                 pass
         time.sleep(1)
         try:
-            self._serial = serial.Serial(self._port, BAUD, timeout=1)
-            time.sleep(0.5)
-            self._flush_startup()
+            self._serial = self._open_port(self._port)   # device reset: boot rate
+            self._decoder = FrameDecoder(self._decoder.sink)
+            self._monitor.resync()
+            self._sync_t4 = None        # New device clock: the loop syncs again right away
+            self._sync_last = 0.0
+            self._clock = None
+            self.negotiate_baud(LINK_BAUD)
+            self.set_stream_format(STREAM_FORMAT)
             print(f"[serial] Reconnected to {self._port}")
         except Exception as e:
             print(f"[serial] Reconnect failed: {e} — falling back to mock")
@@ -301,6 +1350,16 @@ class SerialReader:
         if value > self._signal_max:
             self._signal_max = value
 
+    def _update_gain_block(self, values: np.ndarray):
+        """Block form of _update_gain() for decoded binary frames."""
+        self._gain_samples += len(values)
+        lo = float(values.min())
+        hi = float(values.max())
+        if lo < self._signal_min:
+            self._signal_min = lo
+        if hi > self._signal_max:
+            self._signal_max = hi
+
     def _mock_loop(self):
         """Generate synthetic data at 250 Hz."""
         sample_interval = 1.0 / FS
@@ -317,8 +1376,7 @@ class SerialReader:
             else:
                 sample = 1.5 * np.random.randn()
 
-            with self._lock:
-                self._buffer.append(float(sample))
+            self._ring.append(float(sample))
 
             idx += 1
             time.sleep(sample_interval)
@@ -2,14 +2,23 @@
 CortexKey - Model Training Script
 
 Generates synthetic EEG data (authenticated vs impostor),
-extracts features, trains an SVM classifier, and saves to disk.
+extracts features through the live filter chain (stream_features(), so
+training and serving agree), trains an SVM classifier, and saves to disk.
+Run as a script, it also re-exports the firmware's copy
+(src/model_generated.h) from the saved files with tools/export_model.py;
+train_and_save() alone (ml_model.ensure_model()'s auto-train) does not.
+Sessions recorded on the device (SerialReader.dump_recording()) can be
+added as real, labelled data.
 
 Run once before starting the backend:
     python train_model.py
+    python train_model.py --recordings dump.bin [more.bin ...]
+    python train_model.py --no-export     # leave src/model_generated.h alone
 """
 
 import os
 import sys
+import argparse
 import numpy as np
 from sklearn.svm import SVC
 from sklearn.preprocessing import StandardScaler
@@ -19,26 +28,39 @@ import joblib
 # Ensure we can import sibling modules when run as a script
 sys.path.insert(0, os.path.dirname(__file__))
 
-from eeg_pipeline import extract_features, generate_auth_user, generate_impostor
+from eeg_pipeline import stream_features, generate_auth_user, generate_impostor
 
+TOOLS_DIR   = os.path.join(os.path.dirname(__file__), "..", "tools")
 MODEL_DIR   = os.path.join(os.path.dirname(__file__), "models")
 MODEL_PATH  = os.path.join(MODEL_DIR, "svm_model.pkl")
 SCALER_PATH = os.path.join(MODEL_DIR, "scaler.pkl")
 
+# Per synthetic example: 2 s for the causal chain to settle, then the 2 s window
+TRAIN_SECONDS = 4.0
 
-def train_and_save(n_samples: int = 300):
-    """Generate data, train SVM, save model + scaler."""
+
+def train_and_save(n_samples: int = 300, recordings=()):
+    """Generate data (plus the windows of any recorded dumps), train SVM, save model + scaler."""
 
     print(f"[train] Generating {n_samples} authenticated samples …")
-    X_auth = [extract_features(generate_auth_user()) for _ in range(n_samples)]
+    X_auth = [stream_features(generate_auth_user(TRAIN_SECONDS)) for _ in range(n_samples)]
     y_auth = [1] * n_samples
 
     print(f"[train] Generating {n_samples} impostor samples …")
-    X_imp = [extract_features(generate_impostor()) for _ in range(n_samples)]
+    X_imp = [stream_features(generate_impostor(TRAIN_SECONDS)) for _ in range(n_samples)]
     y_imp = [0] * n_samples
 
-    X = np.array(X_auth + X_imp)
-    y = np.array(y_auth + y_imp)
+    X_rec, y_rec = [], []
+    if recordings:
+        from recordings import load_recording, training_set
+        for path in recordings:
+            Xp, yp = training_set(load_recording(path))
+            print(f"[train] {path}: {sum(yp)} authenticated + {len(yp) - sum(yp)} impostor windows")
+            X_rec += Xp
+            y_rec += yp
+
+    X = np.array(X_auth + X_imp + X_rec)
+    y = np.array(y_auth + y_imp + y_rec)
 
     # Scale
     scaler = StandardScaler()
@@ -58,9 +80,32 @@ def train_and_save(n_samples: int = 300):
     joblib.dump(scaler, SCALER_PATH)
     print(f"[train] Model saved to {MODEL_PATH}")
     print(f"[train] Scaler saved to {SCALER_PATH}")
-
     return model, scaler
 
 
+def export_firmware_model() -> bool:
+    """
+    Regenerate src/model_generated.h so the firmware runs this model too.
+    A failure (no tools/ or src/, read-only tree) is reported, not raised:
+    the trained model is saved either way.
+    """
+    sys.path.insert(0, TOOLS_DIR)
+    try:
+        from export_model import export, model_version
+        print(f"[train] Firmware model {model_version()} written to {export()}")
+        return True
+    except Exception as e:
+        print(f"[train] Firmware model not exported: {e}")
+        return False
+
+
 if __name__ == "__main__":
-    train_and_save()
+    parser = argparse.ArgumentParser(description="Train the CortexKey SVM")
+    parser.add_argument("--recordings", nargs="+", default=(), metavar="DUMP",
+                        help="device session logs (DUMP) to train on as well")
+    parser.add_argument("--no-export", action="store_true",
+                        help="do not rewrite src/model_generated.h")
+    args = parser.parse_args()
+    train_and_save(recordings=args.recordings)
+    if not args.no_export:
+        export_firmware_model()
@@ -0,0 +1,358 @@
+"""
+CortexKey - UDP ingest
+
+Receives the sample stream of any number of ESP32 nodes in LINK UDP mode
+on one socket. Each datagram carries a 12-byte header (magic "CK",
+version, device ID, datagram sequence number; layout in
+src/transport.h) followed by one TX block of ordinary frames, so the
+same FrameDecoder as the serial path decodes the payload.
+
+One thread serves every headset: each wake-up drains all queued
+datagrams, decodes them per device and appends to the per-device
+windows under a single lock acquisition, so cost scales with datagrams
+per second rather than with the number of devices.
+
+Nothing on UDP says STATUS:Rate, so each device's rate is read off the
+spacing of its sample frames (DeviceStream.note_frame()); faster
+streams are averaged down to FS like SerialReader._decimate(), so every
+window is 2 s whatever the device samples at.
+
+Headsets synced over their serial command link (SYNC, see
+SerialReader.sync_clock()) stamp every frame with host time, so
+get_aligned() can cut windows of several headsets that end at the same
+instant by shifting whole samples - no resampling.
+
+Usage:
+    from udp_ingest import ingest
+    ingest.start()                  # UDP_PORT, multicast UDP_GROUP
+    ingest.devices()                # {device_id: stats}
+    ingest.get_window(device_id)    # latest clean 2 s of channel 0, or None
+    ingest.get_aligned([a, b])      # {device_id: window}, common end time
+"""
+
+import collections
+import select
+import socket
+import struct
+import threading
+import time
+
+import numpy as np
+
+from sample_ring import SampleRing
+from serial_reader import (FrameDecoder, StreamMonitor, FRAME_FLAG_FILTERED,
+                           FRAME_FLAG_ARTIFACT, FS, WINDOW_SIZE, HISTORY_SIZE)
+
+# ---------------------------------------------------------------------------
+# Constants (match src/config.h / src/transport.h)
+# ---------------------------------------------------------------------------
+UDP_GROUP = "239.255.0.42"
+UDP_PORT = 5005
+UDP_MAGIC = b"CK"
+UDP_VERSION = 1
+UDP_HEADER = struct.Struct("<2sBBII")   # magic, version, reserved, device, seq
+MAX_DATAGRAM = 2048
+BATCH_MAX = 256            # datagrams handled per wake-up
+RECV_BUFFER = 4 << 20      # kernel socket buffer: absorbs bursts from many nodes
+DEVICE_RATES = (250, 500, 1000, 2000)   # what RATE accepts (src/filter_coeffs.h)
+RATE_TOLERANCE = 0.1       # frame spacing within 10 % of a rate counts as that rate
+
+
+class DeviceStream:
+    """Per-headset state: decoder, window buffer and loss accounting."""
+
+    def __init__(self, device_id: int, address):
+        self.device_id = device_id
+        self.address = address
+        self.buffer = SampleRing(HISTORY_SIZE)    # channel 0 at FS
+        self.decoder = FrameDecoder(self.buffer)  # writes it directly while rate == FS
+        self.monitor = StreamMonitor()
+        self.rate = FS
+        self._decim_carry = np.empty(0)
+        self._last_frame = None           # (time_us, host_time, count) of the previous sample frame
+        self._rate_candidate = None
+        self.next_seq = None
+        self.datagrams = 0
+        self.lost = 0
+        self.reordered = 0
+        self.samples = 0
+        self.prefiltered = False
+        self.features = None
+        self.artifact_mark = 0            # buffer position after the last FRAME_FLAG_ARTIFACT frame
+        self.artifact_frames = 0
+        self.time_end_us = None           # host time of the newest sample (FRAME_FLAG_HOST_TIME)
+        self.time_position = 0            # buffer position just after that sample
+        self.last_seen = 0.0
+
+    def track_seq(self, seq: int):
+        """Count datagrams missing between the previous and this seq."""
+        if self.next_seq is not None:
+            gap = (seq - self.next_seq) & 0xFFFFFFFF
+            if gap >= 0x80000000:
+                self.reordered += 1     # late duplicate or reordering
+                return
+            self.lost += gap
+        self.next_seq = (seq + 1) & 0xFFFFFFFF
+
+    def note_frame(self, header: dict) -> bool:
+        """
+        Learn the device rate from a sample frame: the previous frame's
+        count over the time between their first samples (time_us stamps,
+        else dt_us), snapped to DEVICE_RATES. A new rate is taken once two
+        frames in a row agree (a lost frame halves one estimate). True
+        when the rate changed; the buffer then starts over.
+        """
+        last, self._last_frame = self._last_frame, (header["time_us"], header["host_time"],
+                                                    header["count"])
+        if last is None or header["dt_us"] == 0:
+            return False                  # first frame (after START)
+        if header["time_us"] is not None and last[0] is not None and header["host_time"] == last[1]:
+            spacing_us = header["time_us"] - last[0]
+        elif header["dt_us"] < 0xFFFF:
+            spacing_us = header["dt_us"]
+        else:
+            return False
+        if spacing_us <= 0:
+            return False
+        estimate = last[2] * 1e6 / spacing_us
+        rate = min(DEVICE_RATES, key=lambda r: abs(r - estimate))
+        if abs(rate - estimate) > rate * RATE_TOLERANCE:
+            rate = None
+        candidate, self._rate_candidate = self._rate_candidate, rate
+        if rate is None or rate != candidate or rate == self.rate:
+            return False
+        self.rate = rate
+        self.monitor.rate = rate
+        self._decim_carry = np.empty(0)
+        self.decoder.sink = self.buffer if rate == FS else None
+        self.buffer.clear()
+        self.artifact_mark = 0
+        self.time_end_us = None
+        self.time_position = 0
+        return True
+
+    def push_samples(self, values: np.ndarray) -> int:
+        """
+        Append channel-0 samples at the device rate to the buffer, averaged
+        down to FS as in SerialReader._decimate(). Returns how many raw
+        samples are held back for the next frame's first group.
+        """
+        k = self.rate // FS
+        if k > 1:
+            if self._decim_carry.size:
+                values = np.concatenate((self._decim_carry, values))
+            n = len(values) - len(values) % k
+            self._decim_carry = values[n:]
+            values = values[:n].reshape(-1, k).mean(axis=1)
+        self.buffer.extend(values)
+        return self._decim_carry.size
+
+    def stats(self) -> dict:
+        return {
+            "stream": self.monitor.snapshot(),
+            "address": self.address[0],
+            "rate": self.rate,
+            "datagrams": self.datagrams,
+            "lost": self.lost,
+            "reordered": self.reordered,
+            "samples": self.samples,
+            "crc_errors": self.decoder.crc_errors,
+            "prefiltered": self.prefiltered,
+            "artifact_frames": self.artifact_frames,
+            "host_time": self.time_end_us is not None,
+            "age_s": round(time.time() - self.last_seen, 2),
+        }
+
+
+class UdpIngest:
+    """Batched multi-device UDP receiver."""
+
+    def __init__(self, port: int = UDP_PORT, group: str = UDP_GROUP):
+        self._port = port
+        self._group = group
+        self._sock = None
+        self._thread = None
+        self._running = False
+        self._lock = threading.Lock()
+        self._devices = {}
+        self.bad_datagrams = 0
+
+    # ------------------------------------------------------------------
+    # Public API
+    # ------------------------------------------------------------------
+
+    def start(self):
+        """Bind, join the multicast group and start the receive thread."""
+        if self._thread and self._thread.is_alive():
+            return
+        self._sock = self._open_socket()
+        self._running = True
+        self._thread = threading.Thread(target=self._recv_loop, daemon=True)
+        self._thread.start()
+        print(f"[udp] Listening on {self._group}:{self._port}")
+
+    def stop(self):
+        self._running = False
+        if self._thread:
+            self._thread.join(timeout=2)
+        if self._sock:
+            self._sock.close()
+            self._sock = None
+
+    def devices(self) -> dict:
+        """Stats per device ID (hex string)."""
+        with self._lock:
+            return {f"{d:08X}": s.stats() for d, s in self._devices.items()}
+
+    def get_window(self, device_id: int):
+        """
+        Latest 2-second window of channel 0 for a device (at FS, whatever
+        its rate), or None while it is filling or holds a frame flagged as
+        an artifact. A read-only view into the device's ring (see
+        SerialReader.get_window()).
+        """
+        with self._lock:
+            stream = self._devices.get(device_id)
+            if (stream is None or len(stream.buffer) < WINDOW_SIZE
+                    or stream.artifact_mark > stream.buffer.written - WINDOW_SIZE):
+                return None
+            return stream.buffer.latest(WINDOW_SIZE)
+
+    def get_aligned(self, device_ids, length: int = WINDOW_SIZE):
+        """
+        Windows of channel 0 from several devices that all end at the same
+        host instant: {device_id: read-only view}, or None unless every
+        device streams host-time stamped frames and holds length clean
+        samples up to that instant. The instant is the oldest of the
+        devices' newest samples, and each window is that device's ring
+        shifted by whole samples, so the windows line up to within half a
+        sample period plus the sync error.
+        """
+        with self._lock:
+            streams = [self._devices.get(d) for d in device_ids]
+            if any(s is None or s.time_end_us is None for s in streams):
+                return None
+            end_us = min(s.time_end_us for s in streams)
+            out = {}
+            period_us = 1e6 / FS                # every buffer is at FS
+            for device, stream in zip(device_ids, streams):
+                lag = (stream.buffer.written - stream.time_position
+                       + int(round((stream.time_end_us - end_us) / period_us)))
+                first = stream.buffer.written - lag - length
+                if len(stream.buffer) < lag + length or stream.artifact_mark > first:
+                    return None
+                out[device] = stream.buffer.windows(length, 1, count=1, lag=lag)[0]
+            return out
+
+    def get_features(self, device_id: int):
+        """Pop the newest on-device feature vector for a device, or None."""
+        with self._lock:
+            stream = self._devices.get(device_id)
+            if stream is None:
+                return None
+            features, stream.features = stream.features, None
+        return features
+
+    # ------------------------------------------------------------------
+    # Internal
+    # ------------------------------------------------------------------
+
+    def _open_socket(self):
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        try:
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, RECV_BUFFER)
+        except OSError:
+            pass
+        sock.bind(("", self._port))
+        if self._group:
+            mreq = struct.pack("4s4s", socket.inet_aton(self._group),
+                               socket.inet_aton("0.0.0.0"))
+            sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+        sock.setblocking(False)
+        return sock
+
+    def _recv_loop(self):
+        buf = bytearray(MAX_DATAGRAM)
+        view = memoryview(buf)
+        while self._running:
+            ready, _, _ = select.select([self._sock], [], [], 0.5)
+            if not ready:
+                continue
+
+            # Drain everything queued, then decode outside the lock
+            batch = []
+            for _ in range(BATCH_MAX):
+                try:
+                    n, addr = self._sock.recvfrom_into(buf)
+                except BlockingIOError:
+                    break
+                except OSError:
+                    break
+                batch.append((bytes(view[:n]), addr))
+            if batch:
+                self._handle_batch(batch)
+
+    def _handle_batch(self, batch):
+        now = time.time()      # arrival time of the whole batch (STATS latency)
+        decoded = collections.defaultdict(list)   # device -> [items]
+        for datagram, addr in batch:
+            if len(datagram) < UDP_HEADER.size:
+                self.bad_datagrams += 1
+                continue
+            magic, version, _, device, seq = UDP_HEADER.unpack_from(datagram)
+            if magic != UDP_MAGIC or version != UDP_VERSION:
+                self.bad_datagrams += 1
+                continue
+
+            stream = self._devices.get(device)
+            if stream is None:
+                with self._lock:
+                    stream = self._devices.setdefault(device, DeviceStream(device, addr))
+                print(f"[udp] New device {device:08X} at {addr[0]}")
+            stream.track_seq(seq)
+            stream.datagrams += 1
+            stream.last_seen = now
+            decoded[device].extend(stream.decoder.feed(datagram[UDP_HEADER.size:]))
+
+        with self._lock:
+            for device, items in decoded.items():
+                stream = self._devices[device]
+                for item in items:
+                    if item[0] != "text":
+                        stream.monitor.on_frame(item[0], item[1], now)
+                    if item[0] == "stats":
+                        stream.monitor.on_stats(item[2], now)
+                    elif item[0] == "frame":
+                        header = item[1]
+                        if stream.note_frame(header):
+                            print(f"[udp] Device {device:08X} rate {stream.rate} Hz")
+                        held = 0
+                        if not header.get("stored"):
+                            held = stream.push_samples(item[2][:, 0])
+                        elif stream.rate != FS:
+                            continue        # decoded into the buffer before the rate changed
+                        position = stream.buffer.written
+                        flags = header["flags"]
+                        stream.prefiltered = bool(flags & FRAME_FLAG_FILTERED)
+                        if flags & FRAME_FLAG_ARTIFACT:
+                            stream.artifact_frames += 1
+                            stream.artifact_mark = position
+                        stream.samples += header["count"]
+                        if header["host_time"]:
+                            # Newest buffer sample: the mean of the group ending `held` raw samples back
+                            if header["count"] > held:
+                                newest = header["count"] - 1 - held - (stream.rate // FS - 1) / 2
+                                stream.time_end_us = header["time_us"] + newest * 1e6 / stream.rate
+                                stream.time_position = position
+                        else:
+                            stream.time_end_us = None
+                    elif item[0] == "features":
+                        if item[1]["flags"] & FRAME_FLAG_ARTIFACT:
+                            stream.artifact_frames += 1
+                        else:
+                            stream.features = item[2]
+
+
+# Singleton
+ingest = UdpIngest()
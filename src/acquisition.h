@@ -0,0 +1,170 @@
+/*
+ * CortexKey firmware - acquisition sources and stages
+ *
+ * The building blocks of the acquisition task's Pipeline (pipeline.h)
+ * and the chain this build runs:
+ *
+ *   AcquisitionPipeline = Pipeline<EegSource, ArtifactStage, FilterStage>
+ *
+ * EegSource is MockSource or AdcSource, picked by USE_MOCK_DATA at build
+ * time (env:esp32dev-sensor builds the ADC one). Artifact tests come
+ * before the filter: their thresholds are on the raw signal, which the
+ * bandpass would smooth over.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "adc_scan.h"
+#include "artifact.h"
+#include "config.h"
+#include "dsp_filter.h"
+#include "mock_eeg.h"
+#include "pipeline.h"
+#include "sampler.h"
+
+// ============================================================
+// SOURCES
+// ============================================================
+
+/** Which synthetic signal MockSource generates (set by the comms task). */
+enum MockSignal : uint8_t {
+  MOCK_SIGNAL_AUTH,
+  MOCK_SIGNAL_IMPOSTOR,
+  MOCK_SIGNAL_MODEL_AUTH,       // The SVM's training signals, for on-device sessions
+  MOCK_SIGNAL_MODEL_IMPOSTOR
+};
+
+/**
+ * Synthetic EEG on every enabled channel, one MockEeg each. Already
+ * clean, so one value per output sample rather than per oversampling tick.
+ */
+class MockSource {
+public:
+  static const char *name() { return "MOCK"; }
+
+  void begin(uint32_t rate) {
+    for (uint8_t ch = 0; ch < EEG_MAX_CHANNELS; ch++) {
+      gen[ch].begin(rate, random(1, 0x7FFFFFFF));
+    }
+  }
+
+  void setSignal(MockSignal s) { signal = s; }
+
+  void reset() {
+    tick = 0;
+    for (uint8_t ch = 0; ch < EEG_MAX_CHANNELS; ch++) {
+      gen[ch].reset();
+    }
+  }
+
+  inline uint8_t read(float *values) {
+    if (++tick < samplerOversampling()) {
+      return 0;
+    }
+    tick = 0;
+    uint8_t channels = adcChannelCount();
+    switch (signal) {
+      case MOCK_SIGNAL_AUTH:
+        for (uint8_t ch = 0; ch < channels; ch++) values[ch] = gen[ch].nextAuth();
+        break;
+      case MOCK_SIGNAL_IMPOSTOR:
+        for (uint8_t ch = 0; ch < channels; ch++) values[ch] = gen[ch].nextImpostor();
+        break;
+      case MOCK_SIGNAL_MODEL_AUTH:
+        for (uint8_t ch = 0; ch < channels; ch++) values[ch] = gen[ch].nextModelAuth();
+        break;
+      default:
+        for (uint8_t ch = 0; ch < channels; ch++) values[ch] = gen[ch].nextModelImpostor();
+        break;
+    }
+    return channels;
+  }
+
+private:
+  MockEeg gen[EEG_MAX_CHANNELS];
+  uint8_t tick = 0;                     // Oversampling ticks since the last sample
+  volatile MockSignal signal = MOCK_SIGNAL_AUTH;
+};
+
+/**
+ * The real sensor: every enabled ADC1 channel scanned in the tick
+ * (calibrated 12-bit ADC, decimated, per-channel amplifier gain).
+ */
+class AdcSource {
+public:
+  static const char *name() { return "ADC"; }
+  void begin(uint32_t) {}
+  void setSignal(MockSignal) {}         // Nothing to choose
+  void reset() { adcScanReset(); }
+  inline uint8_t read(float *values) { return adcScan(values); }
+};
+
+// ============================================================
+// STAGES
+// ============================================================
+
+/** Artifact detector per channel; ORs its flags into the sample's artifact. */
+class ArtifactStage {
+public:
+  void reset() {}
+
+  void configure(uint32_t rate) {
+    for (uint8_t ch = 0; ch < EEG_MAX_CHANNELS; ch++) {
+      detector[ch].configure(rate);
+    }
+  }
+
+  inline void process(float *values, uint8_t channels, uint8_t &artifact) {
+    if (!enabled) {
+      return;
+    }
+    for (uint8_t ch = 0; ch < channels; ch++) {
+      artifact |= detector[ch].push(values[ch]);
+    }
+  }
+
+  volatile bool enabled = true;
+
+private:
+  ArtifactDetector detector[EEG_MAX_CHANNELS];
+};
+
+/** The on-device notch + bandpass chain (FILTER), one per channel. */
+class FilterStage {
+public:
+  void reset() {}
+
+  void configure(uint32_t rate) {
+    for (uint8_t ch = 0; ch < EEG_MAX_CHANNELS; ch++) {
+      chain[ch].configure(rate, notchHz);
+    }
+  }
+
+  inline void process(float *values, uint8_t channels, uint8_t &) {
+    if (!enabled) {
+      return;
+    }
+    for (uint8_t ch = 0; ch < channels; ch++) {
+      values[ch] = chain[ch].process(values[ch]);
+    }
+  }
+
+  volatile bool enabled = false;
+  volatile uint8_t notchHz = 50;
+
+private:
+  EegFilterChain chain[EEG_MAX_CHANNELS];
+};
+
+// ============================================================
+// THIS BUILD
+// ============================================================
+
+#if USE_MOCK_DATA
+typedef MockSource EegSource;
+#else
+typedef AdcSource EegSource;
+#endif
+
+typedef Pipeline<EegSource, ArtifactStage, FilterStage> AcquisitionPipeline;
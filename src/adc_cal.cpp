@@ -0,0 +1,154 @@
+/*
+ * CortexKey firmware - ADC1 calibration
+ */
+#include "adc_cal.h"
+
+#include <Preferences.h>
+#include <esp_adc_cal.h>
+
+// ============================================================
+// STATE
+// ============================================================
+
+/** What the cached table was built from; compared field by field on boot. */
+struct AdcCalKey {
+  uint32_t version;
+  uint32_t source;
+  uint32_t vref;
+  uint32_t coeffA;
+  uint32_t coeffB;
+};
+
+static uint16_t lut[ADC_CAL_LUT_SIZE];
+static AdcCalSource calSource = ADC_CAL_NOMINAL;
+static bool loadedFromNvs = false;
+static esp_adc_cal_characteristics_t chars;
+
+// ============================================================
+// TABLE BUILD
+// ============================================================
+
+/**
+ * Linear part of the characterization in microvolts: IDF's
+ * (coeff_a * raw >> 16) + coeff_b, with coeff_a in Q16 mV per code and
+ * coeff_b in whole mV, but without rounding the product to millivolts.
+ */
+static int32_t linearUv(int32_t raw) {
+  return (int32_t)(((uint64_t)chars.coeff_a * raw * 1000 + 32768) >> 16) +
+         (int32_t)chars.coeff_b * 1000;
+}
+
+/**
+ * IDF's full model (including the 11 dB curve correction) minus the
+ * linear part. Coarse: the IDF result is whole millivolts.
+ */
+static int32_t residualUv(int32_t raw) {
+  if (raw < 0) raw = 0;
+  if (raw >= ADC_CAL_LUT_SIZE) raw = ADC_CAL_LUT_SIZE - 1;
+  return (int32_t)esp_adc_cal_raw_to_voltage(raw, &chars) * 1000 - linearUv(raw);
+}
+
+/**
+ * Exact linear part plus a running mean of the residual: keeps the curve
+ * correction but not the 1 mV staircase (about 1.25 codes per step).
+ */
+static void buildTable() {
+  const int32_t half = ADC_CAL_SMOOTH / 2;
+  int32_t sum = 0;
+  for (int32_t r = -half; r <= half; r++) {
+    sum += residualUv(r);
+  }
+
+  for (int32_t raw = 0; raw < ADC_CAL_LUT_SIZE; raw++) {
+    int32_t uv = linearUv(raw) + sum / ADC_CAL_SMOOTH;
+    int32_t units = (uv + ADC_CAL_LUT_UV / 2) / ADC_CAL_LUT_UV;
+    lut[raw] = (uint16_t)constrain(units, 0, 0xFFFF);
+    sum += residualUv(raw + half + 1) - residualUv(raw - half);
+  }
+}
+
+static AdcCalKey currentKey() {
+  AdcCalKey key = {ADC_CAL_VERSION, (uint32_t)calSource, chars.vref, chars.coeff_a, chars.coeff_b};
+  return key;
+}
+
+static bool loadTable() {
+  Preferences prefs;
+  if (!prefs.begin(ADC_CAL_NVS_NAMESPACE, true)) {
+    return false;
+  }
+  AdcCalKey stored;
+  AdcCalKey key = currentKey();
+  bool ok = prefs.getBytes("key", &stored, sizeof(stored)) == sizeof(stored) &&
+            memcmp(&stored, &key, sizeof(key)) == 0 &&
+            prefs.getBytes("lut", lut, sizeof(lut)) == sizeof(lut);
+  prefs.end();
+  return ok;
+}
+
+static void storeTable() {
+  Preferences prefs;
+  if (!prefs.begin(ADC_CAL_NVS_NAMESPACE, false)) {
+    return;
+  }
+  AdcCalKey key = currentKey();
+  // Table first: a reset in between leaves a key that no longer matches
+  prefs.remove("key");
+  if (prefs.putBytes("lut", lut, sizeof(lut)) == sizeof(lut)) {
+    prefs.putBytes("key", &key, sizeof(key));
+  }
+  prefs.end();
+}
+
+static void characterize() {
+  esp_adc_cal_value_t type = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+                                                      ADC_CAL_DEFAULT_VREF, &chars);
+  switch (type) {
+    case ESP_ADC_CAL_VAL_EFUSE_TP: calSource = ADC_CAL_EFUSE_TP; break;
+    case ESP_ADC_CAL_VAL_EFUSE_VREF: calSource = ADC_CAL_EFUSE_VREF; break;
+    default: calSource = ADC_CAL_DEFAULT; break;
+  }
+}
+
+// ============================================================
+// PUBLIC API
+// ============================================================
+
+AdcCalSource adcCalBegin() {
+  characterize();
+  loadedFromNvs = loadTable();
+  if (!loadedFromNvs) {
+    buildTable();
+    storeTable();
+  }
+  return calSource;
+}
+
+AdcCalSource adcCalRebuild() {
+  characterize();
+  buildTable();
+  storeTable();
+  loadedFromNvs = false;
+  return calSource;
+}
+
+AdcCalSource adcCalSource() {
+  return calSource;
+}
+
+const char *adcCalSourceName() {
+  switch (calSource) {
+    case ADC_CAL_DEFAULT: return "DEFAULT_VREF";
+    case ADC_CAL_EFUSE_VREF: return "EFUSE_VREF";
+    case ADC_CAL_EFUSE_TP: return "EFUSE_TP";
+    default: return "NOMINAL";
+  }
+}
+
+bool adcCalFromNvs() {
+  return loadedFromNvs;
+}
+
+const uint16_t *adcCalTable() {
+  return lut;
+}
@@ -0,0 +1,48 @@
+/*
+ * CortexKey firmware - ADC1 calibration
+ *
+ * The ESP32 ADC is neither linear nor referenced to a known voltage: each
+ * chip's Vref (or two-point trim) is burned into eFuse. At boot the eFuse
+ * characterization is turned into a 4096-entry raw -> pin voltage table,
+ * so the acquisition path converts with one lookup instead of the nominal
+ * 3.3 V / 4095 scale.
+ *
+ * The table is cached in NVS together with the characterization it was
+ * built from; if the eFuse data (or ADC_CAL_VERSION) changes it is rebuilt.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define ADC_CAL_LUT_SIZE      4096      // One entry per 12-bit code
+#define ADC_CAL_LUT_UV        100       // Microvolts per table unit (0.1 mV, ~1/8 LSB)
+#define ADC_CAL_MIDSCALE      16500     // BioAmp output bias (VCC / 2) in table units
+#define ADC_CAL_DEFAULT_VREF  1100      // mV, used when the chip has no eFuse calibration
+#define ADC_CAL_SMOOTH        33        // Codes averaged to remove IDF's 1 mV output steps
+#define ADC_CAL_VERSION       2         // Bump when the table layout or build changes
+#define ADC_CAL_NVS_NAMESPACE "adccal"
+
+enum AdcCalSource {
+  ADC_CAL_NOMINAL,      // No characterization: 3.3 V / 4095 (not used after begin)
+  ADC_CAL_DEFAULT,      // ADC_CAL_DEFAULT_VREF, chip not calibrated
+  ADC_CAL_EFUSE_VREF,   // Per-chip Vref from eFuse
+  ADC_CAL_EFUSE_TP      // Per-chip two-point trim from eFuse
+};
+
+/**
+ * Characterize ADC1 (11 dB, 12-bit) and load the matching table from NVS,
+ * or build and store it. Call once before sampling.
+ */
+AdcCalSource adcCalBegin();
+
+/** Drop the cached table and rebuild it from eFuse. */
+AdcCalSource adcCalRebuild();
+
+AdcCalSource adcCalSource();
+const char *adcCalSourceName();
+
+/** True when the table came from NVS rather than being rebuilt this boot. */
+bool adcCalFromNvs();
+
+/** Pin voltage in ADC_CAL_LUT_UV units, indexed by raw 12-bit code. */
+const uint16_t *adcCalTable();
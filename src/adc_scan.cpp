@@ -0,0 +1,158 @@
+/*
+ * CortexKey firmware - multi-channel ADC1 scan
+ */
+#include "adc_scan.h"
+
+#include <driver/adc.h>
+
+#include "adc_cal.h"
+#include "decimator.h"
+
+// ============================================================
+// CHANNEL TABLE
+// ============================================================
+
+// Channel 0 is the original EEG_PIN; the rest are the remaining ADC1 pins.
+static ChannelConfig channels[EEG_MAX_CHANNELS] = {
+  {34, ADC1_CHANNEL_6, EEG_DEFAULT_GAIN},
+  {35, ADC1_CHANNEL_7, EEG_DEFAULT_GAIN},
+  {32, ADC1_CHANNEL_4, EEG_DEFAULT_GAIN},
+  {33, ADC1_CHANNEL_5, EEG_DEFAULT_GAIN},
+  {36, ADC1_CHANNEL_0, EEG_DEFAULT_GAIN},
+  {39, ADC1_CHANNEL_3, EEG_DEFAULT_GAIN},
+  {37, ADC1_CHANNEL_1, EEG_DEFAULT_GAIN},
+  {38, ADC1_CHANNEL_2, EEG_DEFAULT_GAIN},
+};
+
+static uint8_t enabledMask = EEG_DEFAULT_CHANNEL_MASK;
+static uint8_t enabledCount = 0;
+static uint8_t enabledList[EEG_MAX_CHANNELS];      // adc1_channel_t per enabled slot
+static float scale[EEG_MAX_CHANNELS];              // Electrode uV per Q8 calibration table unit
+static const uint16_t *calTable = nullptr;         // adcCalTable(), set by adcScanBegin()
+static Decimator decimator;                        // Acquisition task only while sampling
+
+/** Conversion for scan slot `slot` from table channel `ch`. */
+static void setSlotScale(uint8_t slot, uint8_t ch) {
+  // Calibrated pin voltage, referred to the electrode
+  scale[slot] = (float)ADC_CAL_LUT_UV / (channels[ch].gain * (1 << DECIM_FRAC_BITS));
+}
+
+/**
+ * Calibration table at a Q8 raw code: linear interpolation between the
+ * two neighbouring entries, so decimated samples keep their extra bits.
+ * Result in Q8 table units.
+ */
+static inline int32_t calLookupQ8(int32_t code) {
+  const int32_t maxCode = (ADC_CAL_LUT_SIZE - 1) << DECIM_FRAC_BITS;
+  if (code < 0) code = 0;
+  if (code > maxCode) code = maxCode;
+  int32_t i = code >> DECIM_FRAC_BITS;
+  int32_t frac = code & ((1 << DECIM_FRAC_BITS) - 1);
+  int32_t lo = calTable[i];
+  int32_t hi = calTable[i < ADC_CAL_LUT_SIZE - 1 ? i + 1 : i];
+  return (lo << DECIM_FRAC_BITS) + (hi - lo) * frac;
+}
+
+/** Rebuild the packed enabled-channel arrays used by adcScan(). */
+static void rebuildScanList() {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < EEG_MAX_CHANNELS; i++) {
+    if (!(enabledMask & (1 << i))) {
+      continue;
+    }
+    enabledList[n] = channels[i].adcChannel;
+    setSlotScale(n, i);
+    n++;
+  }
+  enabledCount = n;
+}
+
+// ============================================================
+// PUBLIC API
+// ============================================================
+
+void adcScanBegin() {
+  adc1_config_width(ADC_WIDTH_BIT_12);
+  for (uint8_t i = 0; i < EEG_MAX_CHANNELS; i++) {
+    pinMode(channels[i].pin, INPUT);
+    adc1_config_channel_atten((adc1_channel_t)channels[i].adcChannel, ADC_ATTEN_DB_11);  // 0-3.3V
+  }
+  adcCalBegin();
+  calTable = adcCalTable();
+  rebuildScanList();
+}
+
+const ChannelConfig &adcChannelConfig(uint8_t i) {
+  return channels[i < EEG_MAX_CHANNELS ? i : 0];
+}
+
+bool adcSetGain(uint8_t i, float gain) {
+  if (i >= EEG_MAX_CHANNELS || !(gain > 0.0f)) {
+    return false;
+  }
+  channels[i].gain = gain;
+  // Safe while sampling: only this channel's scale/offset change
+  uint8_t slot = 0;
+  for (uint8_t c = 0; c < i; c++) {
+    if (enabledMask & (1 << c)) slot++;
+  }
+  if (enabledMask & (1 << i)) {
+    setSlotScale(slot, i);
+  }
+  return true;
+}
+
+bool adcSetChannelMask(uint8_t mask) {
+  if (mask == 0 || ((uint32_t)mask >> EEG_MAX_CHANNELS)) {
+    return false;
+  }
+  enabledMask = mask;
+  rebuildScanList();
+  return true;
+}
+
+uint8_t adcChannelMask() {
+  return enabledMask;
+}
+
+uint8_t adcChannelCount() {
+  return enabledCount;
+}
+
+uint8_t adcScanRaw(uint16_t *raw) {
+  for (uint8_t i = 0; i < enabledCount; i++) {
+    raw[i] = adc1_get_raw((adc1_channel_t)enabledList[i]);
+  }
+  return enabledCount;
+}
+
+bool adcSetOversampling(uint8_t osr, DecimFilter filter) {
+  return decimator.configure(osr, filter);
+}
+
+uint8_t adcOversampling() {
+  return decimator.osr();
+}
+
+DecimFilter adcDecimFilter() {
+  return decimator.filter();
+}
+
+void adcScanReset() {
+  decimator.reset();
+}
+
+uint8_t adcScan(float *values) {
+  uint16_t raw[EEG_MAX_CHANNELS] = {};
+  int32_t code[EEG_MAX_CHANNELS];
+  uint8_t n = adcScanRaw(raw);
+  if (!decimator.push(raw, n, code)) {
+    return 0;
+  }
+  for (uint8_t i = 0; i < n; i++) {
+    // Integer lookup and centring; the only float op is the gain scale
+    int32_t centred = calLookupQ8(code[i]) - (ADC_CAL_MIDSCALE << DECIM_FRAC_BITS);
+    values[i] = centred * scale[i];
+  }
+  return n;
+}
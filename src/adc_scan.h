@@ -0,0 +1,62 @@
+/*
+ * CortexKey firmware - multi-channel ADC1 scan
+ *
+ * Channel table for up to EEG_MAX_CHANNELS BioAmp inputs on ADC1 (the
+ * only ADC usable alongside Wi-Fi). One call to adcScan() converts every
+ * enabled channel back to back inside a single sampler tick, so all
+ * channels of a sample set are taken within a few tens of microseconds
+ * of each other.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "decimator.h"
+
+struct ChannelConfig {
+  uint8_t pin;
+  uint8_t adcChannel;     // adc1_channel_t
+  float gain;             // Front-end amplifier gain (BioAmp EXG Pill: 1000)
+};
+
+/**
+ * Configure ADC1 width/attenuation for every table entry and load the
+ * calibration table (adc_cal.h). Call from setup().
+ */
+void adcScanBegin();
+
+/** Table entry for channel i (0 .. EEG_MAX_CHANNELS-1). */
+const ChannelConfig &adcChannelConfig(uint8_t i);
+
+/** Set the amplifier gain used to convert channel i to microvolts. */
+bool adcSetGain(uint8_t i, float gain);
+
+/**
+ * Enable mask (bit i = channel i). Returns false for an empty mask or
+ * bits beyond EEG_MAX_CHANNELS. Must not change while sampling.
+ */
+bool adcSetChannelMask(uint8_t mask);
+uint8_t adcChannelMask();
+uint8_t adcChannelCount();
+
+/**
+ * Decimation applied by adcScan(): osr conversions per output sample
+ * (must match samplerSetOversampling()). Only while stopped.
+ */
+bool adcSetOversampling(uint8_t osr, DecimFilter filter);
+uint8_t adcOversampling();
+DecimFilter adcDecimFilter();
+
+/** Clear the decimator (start of a stream, acquisition task). */
+void adcScanReset();
+
+/**
+ * Convert every enabled channel, lowest first, and decimate. When an
+ * output sample is ready writes values (microvolts, through the
+ * calibration table) and returns adcChannelCount(); otherwise returns 0.
+ */
+uint8_t adcScan(float *values);
+
+/** Raw 12-bit conversion of enabled channels, lowest first. */
+uint8_t adcScanRaw(uint16_t *raw);
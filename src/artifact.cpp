@@ -0,0 +1,68 @@
+/*
+ * CortexKey firmware - streaming artifact detector
+ */
+#include "artifact.h"
+
+#include "config.h"
+
+void ArtifactDetector::configure(uint32_t rate) {
+  dcAlpha = 1.0f - expf(-1.0f / (rate * (float)ARTIFACT_BASELINE_SEC));
+  float rc = 1.0f / (2.0f * PI * ARTIFACT_HIGHBAND_HZ);
+  hpAlpha = rc / (rc + 1.0f / rate);
+  energyAlpha = 1.0f - expf(-1000.0f / (rate * (float)ARTIFACT_HIGHBAND_MS));
+  stepSpan = constrain(rate / 250, 1, ARTIFACT_STEP_MAX);
+  holdSamples = rate * ARTIFACT_HOLD_MS / 1000;
+  reset();
+}
+
+void ArtifactDetector::reset() {
+  primed = false;
+  hp = 0.0f;
+  energy = 0.0f;
+  historyPos = 0;
+  hold = 0;
+  held = 0;
+}
+
+uint8_t ArtifactDetector::push(float uV) {
+  if (!primed) {
+    // Start from the first sample, not from 0 uV
+    dc = uV;
+    prev = uV;
+    for (uint8_t i = 0; i < stepSpan; i++) {
+      history[i] = uV;
+    }
+    primed = true;
+  }
+
+  uint8_t flags = 0;
+  dc += dcAlpha * (uV - dc);
+  if (fabsf(uV - dc) > ARTIFACT_AMPLITUDE_UV) {
+    flags |= ARTIFACT_AMPLITUDE;
+  }
+
+  // history[historyPos] is the sample stepSpan samples back
+  float old = history[historyPos];
+  history[historyPos] = uV;
+  if (++historyPos >= stepSpan) historyPos = 0;
+  if (fabsf(uV - old) > ARTIFACT_STEP_UV) {
+    flags |= ARTIFACT_STEP;
+  }
+
+  hp = hpAlpha * (hp + uV - prev);
+  prev = uV;
+  energy += energyAlpha * (hp * hp - energy);
+  if (energy > (float)ARTIFACT_HIGHBAND_UV * ARTIFACT_HIGHBAND_UV) {
+    flags |= ARTIFACT_HIGHBAND;
+  }
+
+  if (flags) {
+    held |= flags;
+    hold = holdSamples;
+  } else if (hold) {
+    hold--;
+  } else {
+    held = 0;
+  }
+  return (flags || hold) ? held : 0;
+}
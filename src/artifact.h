@@ -0,0 +1,87 @@
+/*
+ * CortexKey firmware - streaming artifact detector
+ *
+ * Flags raw samples that would spoil a 2 s classification window, with
+ * three cheap per-sample tests (thresholds in config.h):
+ *
+ *   ARTIFACT_AMPLITUDE  |x - baseline| above ARTIFACT_AMPLITUDE_UV: eye
+ *                       blinks, electrode pops, saturation. The baseline
+ *                       is a slow DC tracker, so the sensor offset is ignored.
+ *   ARTIFACT_STEP       change over 4 ms (one sample at 250 Hz) above
+ *                       ARTIFACT_STEP_UV: movement spikes.
+ *   ARTIFACT_HIGHBAND   RMS above ARTIFACT_HIGHBAND_HZ over the last
+ *                       ARTIFACT_HIGHBAND_MS above ARTIFACT_HIGHBAND_UV:
+ *                       muscle (EMG) bursts.
+ *
+ * A hit keeps the channel flagged for ARTIFACT_HOLD_MS so the tail of
+ * the event is covered too. Runs on raw samples, ahead of FILTER.
+ * Consumers that score windows skip any window holding a flagged
+ * sample (ArtifactWindow).
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define ARTIFACT_AMPLITUDE   0x01
+#define ARTIFACT_STEP        0x02
+#define ARTIFACT_HIGHBAND    0x04
+
+#define ARTIFACT_STEP_MAX    8        // Step span in samples (2000 Hz / 250 Hz)
+
+class ArtifactDetector {
+public:
+  /** Derive the time constants for a sample rate and reset. */
+  void configure(uint32_t rate);
+
+  /** Forget the signal history (start of a stream). */
+  void reset();
+
+  /** Test one raw sample; returns the ARTIFACT_* bits that are set (0 = clean). */
+  uint8_t push(float uV);
+
+private:
+  float dcAlpha = 0.0f;       // Baseline tracker
+  float hpAlpha = 0.0f;       // One-pole high-pass at ARTIFACT_HIGHBAND_HZ
+  float energyAlpha = 0.0f;   // Mean-square smoothing over ARTIFACT_HIGHBAND_MS
+  uint8_t stepSpan = 1;
+  uint32_t holdSamples = 0;
+
+  bool primed = false;
+  float dc = 0.0f;
+  float hp = 0.0f;
+  float prev = 0.0f;
+  float energy = 0.0f;
+  float history[ARTIFACT_STEP_MAX];
+  uint8_t historyPos = 0;
+  uint32_t hold = 0;
+  uint8_t held = 0;
+};
+
+/**
+ * Whether the sliding window ending at the latest sample holds a flagged
+ * sample: FEATURES frames and AuthSession windows.
+ */
+class ArtifactWindow {
+public:
+  /** Window length in samples; starts clean. */
+  void begin(uint16_t samples) {
+    length = samples;
+    dirty = 0;
+  }
+
+  /** Add one sample's flag. Returns true if the window ending here is clean. */
+  bool push(bool artifact) {
+    if (artifact) {
+      dirty = length;
+    }
+    if (dirty == 0) {
+      return true;
+    }
+    dirty--;
+    return false;
+  }
+
+private:
+  uint16_t length = 0;
+  uint16_t dirty = 0;         // Windows ending in the next this many samples are contaminated
+};
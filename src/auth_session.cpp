@@ -0,0 +1,101 @@
+/*
+ * CortexKey firmware - on-device authentication session
+ */
+#include "auth_session.h"
+
+#include "config.h"
+#include "model_generated.h"
+
+static_assert(MODEL_FEATURES == FEATURE_COUNT,
+              "model_generated.h does not match band_power.h - re-run tools/export_model.py");
+
+float authClassify(const float *features) {
+  return AUTH_MODEL.probability(features);
+}
+
+const char *authModelVersion() {
+  return MODEL_VERSION;
+}
+
+const char *authDecisionName(AuthDecision d) {
+  switch (d) {
+    case AUTH_ACCEPT: return "ACCEPT";
+    case AUTH_REJECT: return "REJECT";
+    default: return "PENDING";
+  }
+}
+
+bool AuthSession::begin(uint32_t rate, uint8_t notchHz, bool prefiltered) {
+  if (rate < MODEL_SAMPLE_RATE || rate % MODEL_SAMPLE_RATE != 0 ||
+      !bandPower.configure(MODEL_SAMPLE_RATE, MODEL_SAMPLE_RATE * AUTH_HOP_MS / 1000)) {
+    return false;
+  }
+  ownFilter = !prefiltered;
+  if (ownFilter && !filter.configure(rate, notchHz)) {
+    return false;
+  }
+  filter.reset();
+  decimation = rate / MODEL_SAMPLE_RATE;
+  decimCount = 0;
+  decimSum = 0.0f;
+  decimArtifact = false;
+  artifactWindow.begin(bandPower.windowSamples());
+  pushed = 0;
+  windowCount = 0;
+  skippedCount = 0;
+  sumP = 0.0f;
+  lastP = 0.0f;
+  result = AUTH_PENDING;
+  decidedEarly = false;
+  return true;
+}
+
+bool AuthSession::push(float value, bool artifact) {
+  pushed++;
+  if (ownFilter) {
+    value = filter.process(value);
+  }
+  if (decimation > 1) {
+    // Mean of each group, like SerialReader._decimate()
+    decimSum += value;
+    decimArtifact |= artifact;
+    if (++decimCount < decimation) {
+      return false;
+    }
+    value = decimSum / decimation;
+    artifact = decimArtifact;
+    decimCount = 0;
+    decimSum = 0.0f;
+    decimArtifact = false;
+  }
+  bool clean = artifactWindow.push(artifact);
+  if (!bandPower.push(value) || result != AUTH_PENDING) {
+    return false;
+  }
+  if (!clean) {
+    skippedCount++;
+    return false;
+  }
+
+  lastP = authClassify(bandPower.features());
+  sumP += lastP;
+  windowCount++;
+
+  if (windowCount >= AUTH_MIN_WINDOWS) {
+    float mean = meanProbability();
+    if (mean >= AUTH_ACCEPT_P) {
+      result = AUTH_ACCEPT;
+    } else if (mean <= AUTH_REJECT_P) {
+      result = AUTH_REJECT;
+    }
+    decidedEarly = result != AUTH_PENDING;
+  }
+  return true;
+}
+
+AuthDecision AuthSession::finish() {
+  if (result == AUTH_PENDING) {
+    result = windowCount && meanProbability() >= 0.5f ? AUTH_ACCEPT : AUTH_REJECT;
+  }
+  return result;
+}
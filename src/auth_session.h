@@ -0,0 +1,87 @@
+/*
+ * CortexKey firmware - on-device authentication session
+ *
+ * Classifies the EEG stream on the device instead of shipping every
+ * sample to the host: the notch + bandpass chain (unless the acquisition
+ * task already filters), averaging down to the model's rate as the
+ * backend does, the band-power extractor over a sliding 2 s window, then
+ * the backend's SVM from model_generated.h on each window.
+ *
+ * The session keeps the mean P(authenticated) of its windows and decides
+ * as soon as that passes AUTH_ACCEPT_P or AUTH_REJECT_P after
+ * AUTH_MIN_WINDOWS windows - usually the first two, 2.2 s in, instead of
+ * a fixed AUTO_STOP_SEC. finish() forces a decision at timeout.
+ * Windows that cover an artifact-flagged sample (artifact.h) are skipped,
+ * not scored, so a blink cannot push the mean either way.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "artifact.h"
+#include "band_power.h"
+#include "dsp_filter.h"
+
+enum AuthDecision {
+  AUTH_PENDING,
+  AUTH_ACCEPT,
+  AUTH_REJECT
+};
+
+/** P(authenticated) of one FEATURE_COUNT vector: scaler, SVM, Platt (svm.h). */
+float authClassify(const float *features);
+
+/** MODEL_VERSION of the compiled-in model (hash of the backend pickles). */
+const char *authModelVersion();
+
+const char *authDecisionName(AuthDecision d);
+
+class AuthSession {
+public:
+  /**
+   * Start a session on a stream at rate. prefiltered: samples already
+   * went through FILTER (acquisition task); otherwise the session runs
+   * its own chain with the given notch. Returns false unless rate is a
+   * multiple of MODEL_SAMPLE_RATE with a filter design.
+   */
+  bool begin(uint32_t rate, uint8_t notchHz, bool prefiltered);
+
+  /**
+   * Add one channel-0 sample; artifact: the detector flagged it. Returns
+   * true when a window was classified (lastProbability()); decision()
+   * may have changed.
+   */
+  bool push(float value, bool artifact = false);
+
+  /** Decide on the windows so far (timeout): mean P >= 0.5 accepts. */
+  AuthDecision finish();
+
+  AuthDecision decision() const { return result; }
+  bool early() const { return decidedEarly; }
+  float lastProbability() const { return lastP; }
+  float meanProbability() const { return windowCount ? sumP / windowCount : 0.0f; }
+  uint16_t windows() const { return windowCount; }
+
+  /** Complete windows not scored because they covered an artifact. */
+  uint16_t skipped() const { return skippedCount; }
+
+  /** Samples pushed since begin(). */
+  uint32_t samples() const { return pushed; }
+
+private:
+  EegFilterChain filter;
+  BandPowerExtractor bandPower;
+  bool ownFilter = false;
+  uint8_t decimation = 1;     // Stream samples per model sample
+  uint8_t decimCount = 0;
+  float decimSum = 0.0f;
+  bool decimArtifact = false;
+  ArtifactWindow artifactWindow;
+  uint32_t pushed = 0;
+  uint16_t windowCount = 0;
+  uint16_t skippedCount = 0;
+  float sumP = 0.0f;
+  float lastP = 0.0f;
+  AuthDecision result = AUTH_PENDING;
+  bool decidedEarly = false;
+};
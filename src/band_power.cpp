@@ -0,0 +1,175 @@
+/*
+ * CortexKey firmware - streaming band-power feature extractor
+ */
+#include "band_power.h"
+
+/** Bins of a binHz grid (1 .. NPERSEG/2 - 1) with lo <= f <= hi, as integrate() picks them. */
+uint8_t BandPowerExtractor::bandBins(float binHz, float lo, float hi) {
+  uint8_t n = 0;
+  for (uint16_t k = 1; k < FEATURE_NPERSEG / 2; k++) {
+    float f = k * binHz;
+    if (f >= lo && f <= hi) {
+      n++;
+    }
+  }
+  return n;
+}
+
+bool BandPowerExtractor::supports(uint32_t rate) {
+  uint32_t analysis = rate > FEATURE_ANALYSIS_RATE ? FEATURE_ANALYSIS_RATE : rate;
+  if (rate == 0 || rate % analysis != 0 || rate / analysis > 255 ||
+      analysis * FEATURE_WINDOW_SEC < FEATURE_NPERSEG) {
+    return false;
+  }
+  float binHz = (float)analysis / FEATURE_NPERSEG;
+  return bandBins(binHz, FEATURE_THETA_LO, FEATURE_THETA_HI) >= FEATURE_MIN_BAND_BINS &&
+         bandBins(binHz, FEATURE_ALPHA_LO, FEATURE_ALPHA_HI) >= FEATURE_MIN_BAND_BINS &&
+         bandBins(binHz, FEATURE_BETA_LO, FEATURE_BETA_HI) >= FEATURE_MIN_BAND_BINS;
+}
+
+bool BandPowerExtractor::configure(uint32_t rate, uint16_t hop) {
+  if (!supports(rate) || hop == 0) {
+    return false;
+  }
+  uint32_t analysis = rate > FEATURE_ANALYSIS_RATE ? FEATURE_ANALYSIS_RATE : rate;
+  decimation = rate / analysis;
+  window = analysis * FEATURE_WINDOW_SEC;
+  hopSamples = (hop + decimation - 1) / decimation;
+  sampleRate = rate;
+
+  // scipy.signal.get_window("hann", N) - periodic
+  float sumSq = 0.0f;
+  for (int n = 0; n < FEATURE_NPERSEG; n++) {
+    hann[n] = 0.5f - 0.5f * cosf(2.0f * PI * n / FEATURE_NPERSEG);
+    sumSq += hann[n] * hann[n];
+  }
+  psdScale = 2.0f / (analysis * sumSq);
+
+  // Bins with FEATURE_THETA_LO <= f <= FEATURE_BETA_HI, same inclusive test as the backend
+  binHz = (float)analysis / FEATURE_NPERSEG;
+  bins = 0;
+  firstBin = 0;
+  for (uint16_t k = 1; k < FEATURE_NPERSEG / 2 && bins < FEATURE_MAX_BINS; k++) {
+    float f = k * binHz;
+    if (f < FEATURE_THETA_LO || f > FEATURE_BETA_HI) {
+      continue;
+    }
+    if (bins == 0) {
+      firstBin = k;
+    }
+    goertzel[bins++] = 2.0f * cosf(2.0f * PI * k / FEATURE_NPERSEG);
+  }
+
+  reset();
+  return true;
+}
+
+void BandPowerExtractor::reset() {
+  head = 0;
+  pushed = 0;
+  sinceLast = 0;
+  decimCount = 0;
+  decimSum = 0.0f;
+  for (int i = 0; i < FEATURE_COUNT; i++) {
+    out[i] = 0.0f;
+  }
+}
+
+bool BandPowerExtractor::push(float value) {
+  if (decimation > 1) {
+    // Mean of each group, like SerialReader._decimate()
+    decimSum += value;
+    if (++decimCount < decimation) {
+      return false;
+    }
+    value = decimSum / decimation;
+    decimCount = 0;
+    decimSum = 0.0f;
+  }
+  samples[head] = value;
+  if (++head >= window) {
+    head = 0;
+  }
+  pushed++;
+  sinceLast++;
+
+  if (pushed < window || sinceLast < hopSamples) {
+    return false;
+  }
+  sinceLast = 0;
+  compute();
+  return true;
+}
+
+void BandPowerExtractor::compute() {
+  float seg[FEATURE_NPERSEG];
+  uint8_t segments = 0;
+
+  for (uint8_t i = 0; i < bins; i++) {
+    psd[i] = 0.0f;
+  }
+
+  // head is the oldest sample once the window is full
+  for (uint32_t start = 0; start + FEATURE_NPERSEG <= window; start += FEATURE_NPERSEG - FEATURE_NOVERLAP) {
+    uint32_t pos = head + start;
+    if (pos >= window) pos -= window;
+
+    float mean = 0.0f;
+    for (int n = 0; n < FEATURE_NPERSEG; n++) {
+      seg[n] = samples[pos];
+      mean += seg[n];
+      if (++pos >= window) pos = 0;
+    }
+    mean /= FEATURE_NPERSEG;
+    for (int n = 0; n < FEATURE_NPERSEG; n++) {
+      seg[n] = (seg[n] - mean) * hann[n];
+    }
+
+    for (uint8_t i = 0; i < bins; i++) {
+      const float c = goertzel[i];
+      float s1 = 0.0f, s2 = 0.0f;
+      for (int n = 0; n < FEATURE_NPERSEG; n++) {
+        float s0 = seg[n] + c * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+      }
+      psd[i] += s1 * s1 + s2 * s2 - c * s1 * s2;
+    }
+    segments++;
+  }
+
+  const float scale = psdScale / segments;
+  for (uint8_t i = 0; i < bins; i++) {
+    psd[i] *= scale;
+  }
+
+  float theta = integrate(FEATURE_THETA_LO, FEATURE_THETA_HI);
+  float alpha = integrate(FEATURE_ALPHA_LO, FEATURE_ALPHA_HI);
+  float beta = integrate(FEATURE_BETA_LO, FEATURE_BETA_HI);
+
+  out[FEATURE_THETA] = theta;
+  out[FEATURE_ALPHA] = alpha;
+  out[FEATURE_BETA] = beta;
+  out[FEATURE_ALPHA_THETA] = alpha / (theta + 1e-12f);
+  out[FEATURE_ALPHA_BETA] = alpha / (beta + 1e-12f);
+  out[FEATURE_TOTAL] = theta + alpha + beta + 1e-12f;
+}
+
+/** np.trapz over the bins with lo <= f <= hi. */
+float BandPowerExtractor::integrate(float lo, float hi) const {
+  float area = 0.0f;
+  bool havePrev = false;
+  float prev = 0.0f;
+  for (uint8_t i = 0; i < bins; i++) {
+    float f = binFrequency(i);
+    if (f < lo || f > hi) {
+      continue;
+    }
+    if (havePrev) {
+      area += 0.5f * (prev + psd[i]) * binHz;
+    }
+    prev = psd[i];
+    havePrev = true;
+  }
+  return area;
+}
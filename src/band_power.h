@@ -0,0 +1,119 @@
+/*
+ * CortexKey firmware - streaming band-power feature extractor
+ *
+ * Computes the same 6-element vector as extract_features() in
+ * backend/eeg_pipeline.py over a sliding 2 s window:
+ *
+ *   [theta, alpha, beta, alpha/theta, alpha/beta, total]
+ *
+ * Faster streams are averaged down to FEATURE_ANALYSIS_RATE first, as
+ * SerialReader._decimate() does for the backend: a fixed 256-sample
+ * segment at 2000 Hz would leave 7.8 Hz bins, none of them in 8-13 Hz.
+ * Then Welch PSD with scipy's defaults (periodic Hann, nperseg = 256,
+ * 50 % overlap, constant detrend, one-sided density) and trapezoidal
+ * integration over the 4-8 / 8-13 / 13-30 Hz bins. Only the 4-30 Hz bins
+ * are ever used, so instead of a full FFT each segment runs a Goertzel
+ * bank over just those bins (26 at 250 Hz).
+ *
+ * Input should already be notch + bandpass filtered (EegFilterChain).
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define FEATURE_COUNT        6
+#define FEATURE_WINDOW_SEC   2
+#define FEATURE_ANALYSIS_RATE 250   // Hz the window is analysed at (the backend's FS)
+#define FEATURE_WINDOW_MAX   (FEATURE_WINDOW_SEC * FEATURE_ANALYSIS_RATE)
+#define FEATURE_NPERSEG      256
+#define FEATURE_NOVERLAP     (FEATURE_NPERSEG / 2)
+#define FEATURE_MAX_BINS     32
+#define FEATURE_MIN_BAND_BINS 2     // Fewer and a band's trapezoid integral is 0
+#define FEATURE_HOP_DEFAULT  50     // Samples (200 ms @ 250 Hz, the backend's push period)
+
+#define FEATURE_THETA_LO     4.0f
+#define FEATURE_THETA_HI     8.0f
+#define FEATURE_ALPHA_LO     8.0f
+#define FEATURE_ALPHA_HI     13.0f
+#define FEATURE_BETA_LO      13.0f
+#define FEATURE_BETA_HI      30.0f
+
+enum FeatureIndex {
+  FEATURE_THETA,
+  FEATURE_ALPHA,
+  FEATURE_BETA,
+  FEATURE_ALPHA_THETA,
+  FEATURE_ALPHA_BETA,
+  FEATURE_TOTAL
+};
+
+class BandPowerExtractor {
+public:
+  /**
+   * Set the stream rate and hop (stream samples between feature vectors,
+   * rounded up to whole analysis samples). Precomputes the Hann window
+   * and Goertzel coefficients and resets the window. Returns false unless
+   * supports(rate).
+   */
+  bool configure(uint32_t rate, uint16_t hop);
+
+  /**
+   * True when rate is FEATURE_ANALYSIS_RATE or a multiple of it (or a
+   * slower rate whose whole window still fits a segment) and every band
+   * gets FEATURE_MIN_BAND_BINS bins.
+   */
+  static bool supports(uint32_t rate);
+
+  /** Empty the sliding window. */
+  void reset();
+
+  /**
+   * Add one sample. Returns true when a new feature vector is ready
+   * (first after a full window, then every hop samples).
+   */
+  bool push(float value);
+
+  /** Latest feature vector (FEATURE_COUNT floats). */
+  const float *features() const { return out; }
+
+  /** Stream samples pushed since reset() when features() was computed. */
+  uint32_t featureSampleCount() const { return pushed * decimation; }
+
+  /** Stream rate, and hop and window in stream samples. */
+  uint32_t rate() const { return sampleRate; }
+  uint16_t hop() const { return hopSamples * decimation; }
+  uint16_t windowSamples() const { return window * decimation; }
+
+  /** Per-bin Welch PSD behind the latest vector (for tests/telemetry). */
+  const float *binPsd() const { return psd; }
+  uint8_t binCount() const { return bins; }
+  float binFrequency(uint8_t i) const { return (firstBin + i) * binHz; }
+
+private:
+  void compute();
+  float integrate(float lo, float hi) const;
+  static uint8_t bandBins(float binHz, float lo, float hi);
+
+  float samples[FEATURE_WINDOW_MAX];
+  uint16_t window = 0;        // Analysis samples per window
+  uint16_t head = 0;          // Next write position
+  uint32_t pushed = 0;        // Analysis samples
+  uint16_t sinceLast = 0;
+  uint16_t hopSamples = FEATURE_HOP_DEFAULT;   // Analysis samples
+  uint32_t sampleRate = 0;    // Stream rate
+
+  uint8_t decimation = 1;     // Stream samples per analysis sample
+  uint8_t decimCount = 0;
+  float decimSum = 0.0f;
+
+  float hann[FEATURE_NPERSEG];
+  float psdScale = 0.0f;      // 2 / (fs * sum(w^2)), one-sided density
+
+  uint8_t bins = 0;
+  uint16_t firstBin = 0;
+  float binHz = 0.0f;
+  float goertzel[FEATURE_MAX_BINS];   // 2 cos(2 pi k / N)
+  float psd[FEATURE_MAX_BINS];
+
+  float out[FEATURE_COUNT] = {};
+};
@@ -0,0 +1,288 @@
+/*
+ * CortexKey firmware - on-target micro-benchmarks
+ */
+#include "bench.h"
+
+#include <math.h>
+#include <new>
+
+#include "acquisition.h"
+#include "adc_scan.h"
+#include "artifact.h"
+#include "auth_session.h"
+#include "band_power.h"
+#include "decimator.h"
+#include "dsp_filter.h"
+#include "mock_eeg.h"
+#include "perf.h"
+#include "protocol.h"
+
+// ============================================================
+// KERNELS
+// ============================================================
+
+/** Discards everything: Serial.print() float formatting without the UART. */
+class NullPrint : public Print {
+public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t *, size_t len) override { return len; }
+};
+
+struct BenchState {
+  MockEeg mock;
+  Decimator decim;
+  EegFilterChain filter;
+  ArtifactDetector artifact;
+  BandPowerExtractor bands;
+  SampleFrameEncoder frame;
+  CompressedFrameEncoder zframe;
+  AcquisitionPipeline pipeline;
+  NullPrint null;
+  uint16_t raw[EEG_MAX_CHANNELS];
+  int32_t q8[EEG_MAX_CHANNELS];
+  float values[EEG_MAX_CHANNELS];
+  char line[ASCII_SAMPLE_MAX(EEG_MAX_CHANNELS)];
+  uint8_t bytes[FRAME_MAX_PAYLOAD];
+  uint8_t flags;
+  uint32_t sink;            // Results land here so nothing is optimized away
+};
+
+typedef void (*BenchSetup)(BenchState &st);
+typedef void (*BenchKernel)(BenchState &st, uint32_t i);
+
+struct BenchEntry {
+  const char *name;
+  BenchSetup setup;         // nullptr: nothing to prepare
+  BenchKernel run;
+};
+
+/** A sample-like value that changes every call (~ +/-50 uV). */
+static inline float testValue(uint32_t i) {
+  return (float)((int32_t)(i * 2654435761u) >> 24) * 0.4f;
+}
+
+static void setupMock(BenchState &st) {
+  st.mock.begin(SAMPLE_RATE, 12345);
+}
+
+static void setupDecimAvg(BenchState &st) { st.decim.configure(16, DECIM_AVG); }
+static void setupDecimCic(BenchState &st) { st.decim.configure(16, DECIM_CIC); }
+static void setupDecimFir(BenchState &st) { st.decim.configure(16, DECIM_FIR); }
+
+static void setupFilter(BenchState &st) {
+  st.filter.configure(SAMPLE_RATE, 50);
+}
+
+static void setupArtifact(BenchState &st) {
+  st.artifact.configure(SAMPLE_RATE);
+}
+
+static void setupPipeline(BenchState &st) {
+  st.pipeline.source.begin(SAMPLE_RATE);
+  st.pipeline.stage<FilterStage>().enabled = true;
+  st.pipeline.requestConfigure();
+  st.pipeline.requestReset();
+}
+
+static void setupBands(BenchState &st) {
+  st.bands.configure(SAMPLE_RATE, FEATURE_HOP_DEFAULT);
+}
+
+static void setupValues(BenchState &st) {
+  for (uint8_t ch = 0; ch < EEG_MAX_CHANNELS; ch++) {
+    st.values[ch] = testValue(ch + 1);
+  }
+  for (size_t i = 0; i < sizeof(st.bytes); i++) {
+    st.bytes[i] = i * 7;
+  }
+  st.frame.begin(0, 0, 0, 1);
+  st.zframe.reset();
+  st.zframe.begin(0, 0, 0, 1, 1);
+}
+
+static void runEmpty(BenchState &st, uint32_t i) {
+  st.sink += i;
+}
+
+static void runMockAuth(BenchState &st, uint32_t) {
+  st.values[0] = st.mock.nextAuth();
+}
+
+static void runMockImp(BenchState &st, uint32_t) {
+  st.values[0] = st.mock.nextImpostor();
+}
+
+static void runSineLut(BenchState &st, uint32_t i) {
+  st.values[0] = sineFromPhase(i * 0x9E3779B9u);
+}
+
+static void runSineLibm(BenchState &st, uint32_t i) {
+  st.values[0] = sinf(i * 0.001f);
+}
+
+static void runAdcRaw(BenchState &st, uint32_t) {
+  st.sink += adcScanRaw(st.raw);
+}
+
+static void runAdcScan(BenchState &st, uint32_t) {
+  st.sink += adcScan(st.values);
+}
+
+static void runDecim(BenchState &st, uint32_t i) {
+  st.raw[0] = 2048 + (i & 15);
+  st.sink += st.decim.push(st.raw, 1, st.q8);
+}
+
+static void runFilterFloat(BenchState &st, uint32_t i) {
+  st.values[0] = st.filter.process(testValue(i));
+}
+
+static void runFilterFixed(BenchState &st, uint32_t i) {
+  st.sink += st.filter.processFixed((int32_t)(testValue(i) * 4096.0f));
+}
+
+static void runArtifact(BenchState &st, uint32_t i) {
+  st.sink += st.artifact.push(testValue(i));
+}
+
+static void runPipeline(BenchState &st, uint32_t i) {
+  st.sink += st.pipeline.acquire(i, st.values, st.flags);
+}
+
+static void runBands(BenchState &st, uint32_t i) {
+  st.sink += st.bands.push(testValue(i));
+}
+
+static void runAuthSvm(BenchState &st, uint32_t i) {
+  st.values[0] = testValue(i) * 0.01f;
+  st.values[FEATURE_COUNT] = authClassify(st.values);
+}
+
+static void runAscii1(BenchState &st, uint32_t i) {
+  st.values[0] = testValue(i);
+  st.sink += formatAsciiSample(st.line, i, st.values, 1);
+}
+
+static void runAscii8(BenchState &st, uint32_t i) {
+  st.values[0] = testValue(i);
+  st.sink += formatAsciiSample(st.line, i, st.values, EEG_MAX_CHANNELS);
+}
+
+static void runPrintFloat(BenchState &st, uint32_t i) {
+  st.sink += st.null.print(testValue(i), 3);
+}
+
+static void runFrame16(BenchState &st, uint32_t i) {
+  if (!st.frame.add(testValue(i))) {
+    st.sink += st.frame.finish();
+    st.frame.begin(0, i, 0, 1);
+    st.frame.add(testValue(i));
+  }
+}
+
+static void runCompressed(BenchState &st, uint32_t i) {
+  st.zframe.add(testValue(i));
+  if (st.zframe.full()) {
+    st.sink += st.zframe.finish();
+    st.zframe.begin(0, i, 0, 1, 1);
+  }
+}
+
+static void runCrc(BenchState &st, uint32_t) {
+  st.sink += crc16(st.bytes, sizeof(st.bytes));
+}
+
+static const BenchEntry KERNELS[] = {
+  {"EMPTY",        nullptr,       runEmpty},       // Harness overhead, subtracted from the rest
+  {"MOCK_AUTH",    setupMock,     runMockAuth},
+  {"MOCK_IMP",     setupMock,     runMockImp},
+  {"SINE_LUT",     nullptr,       runSineLut},
+  {"SINE_LIBM",    nullptr,       runSineLibm},
+  {"ADC_RAW",      nullptr,       runAdcRaw},      // Enabled channels, one conversion each
+  {"ADC_SCAN",     nullptr,       runAdcScan},     // + decimator and calibration table
+  {"DECIM_AVG16",  setupDecimAvg, runDecim},
+  {"DECIM_CIC16",  setupDecimCic, runDecim},
+  {"DECIM_FIR16",  setupDecimFir, runDecim},
+  {"FILTER_FLOAT", setupFilter,   runFilterFloat},
+  {"FILTER_FIXED", setupFilter,   runFilterFixed},
+  {"ARTIFACT",     setupArtifact, runArtifact},    // Per channel, ahead of the filter
+  {"ACQUIRE",      setupPipeline, runPipeline},    // One tick of AcquisitionPipeline, filter on
+  {"BANDPOWER",    setupBands,    runBands},       // Amortized: a Welch PSD every hop samples
+  {"AUTH_SVM",     setupValues,   runAuthSvm},     // One window: scaler + SvmModel + Platt
+  {"ASCII_1CH",    setupValues,   runAscii1},
+  {"ASCII_8CH",    setupValues,   runAscii8},
+  {"PRINT_FLOAT",  setupValues,   runPrintFloat},  // Print::print(value, 3), for ASCII_1CH
+  {"FRAME16",      setupValues,   runFrame16},
+  {"COMPRESSED",   setupValues,   runCompressed},
+  {"CRC16_240",    setupValues,   runCrc},
+};
+
+// ============================================================
+// HARNESS
+// ============================================================
+
+struct BenchResult {
+  uint32_t meanCycles;
+  uint32_t bestCycles;
+};
+
+/** Time calls invocations in chunks; per-call cycles, overhead not removed. */
+static BenchResult measure(const BenchEntry &k, BenchState &st, uint32_t calls) {
+  if (k.setup) {
+    k.setup(st);
+  }
+  uint64_t total = 0;
+  uint32_t best = UINT32_MAX;
+  uint32_t i = 0;
+  while (i < calls) {
+    uint32_t n = calls - i < BENCH_CHUNK ? calls - i : BENCH_CHUNK;
+    uint32_t start = perfCycles();
+    for (uint32_t end = i + n; i < end; i++) {
+      k.run(st, i);
+    }
+    uint32_t cycles = perfCycles() - start;
+    total += cycles;
+    if (cycles / n < best) {
+      best = cycles / n;
+    }
+    vTaskDelay(1);            // Let IDLE feed the task watchdog
+  }
+  return {(uint32_t)(total / calls), best};
+}
+
+int benchRun(Print &out, uint32_t calls, const char *only) {
+  BenchState *st = new (std::nothrow) BenchState();
+  if (!st) {
+    return -1;
+  }
+  const uint32_t mhz = ESP.getCpuFreqMHz();
+  BenchResult overhead = measure(KERNELS[0], *st, calls);
+  int ran = 0;
+
+  for (const BenchEntry &k : KERNELS) {
+    if (*only && strcmp(only, k.name) != 0) {
+      continue;
+    }
+    BenchResult r = measure(k, *st, calls);
+    if (&k != &KERNELS[0]) {
+      r.meanCycles = r.meanCycles > overhead.meanCycles ? r.meanCycles - overhead.meanCycles : 0;
+      r.bestCycles = r.bestCycles > overhead.bestCycles ? r.bestCycles - overhead.bestCycles : 0;
+    }
+    out.print("BENCH:Name=");
+    out.print(k.name);
+    out.print(",Calls=");
+    out.print(calls);
+    out.print(",Cycles=");
+    out.print(r.meanCycles);
+    out.print(",Best=");
+    out.print(r.bestCycles);
+    out.print(",Ns=");
+    out.print((uint32_t)((uint64_t)r.meanCycles * 1000 / mhz));
+    out.print(",PerSec=");
+    out.println(r.meanCycles ? (uint32_t)((uint64_t)mhz * 1000000 / r.meanCycles) : 0);
+    ran++;
+  }
+
+  delete st;
+  return ran;
+}
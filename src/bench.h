@@ -0,0 +1,32 @@
+/*
+ * CortexKey firmware - on-target micro-benchmarks
+ *
+ * BENCH runs each kernel of the acquisition, DSP and TX paths n times on
+ * the comms core and prints its cost from the cycle counter:
+ *
+ *   BENCH:Name=FILTER_FLOAT,Calls=10000,Cycles=412,Best=405,Ns=1716,PerSec=582524
+ *
+ * Cycles is the mean per call, Best the mean of the fastest chunk of
+ * BENCH_CHUNK calls (least disturbed by interrupts); both have the
+ * harness overhead (the EMPTY kernel) subtracted. Pairs such as
+ * SINE_LUT / SINE_LIBM, FILTER_FIXED / FILTER_FLOAT and ASCII_1CH /
+ * PRINT_FLOAT are there to compare implementations on real silicon.
+ *
+ * Kernel state is heap-allocated for the run and freed afterwards, so the
+ * suite costs no RAM while streaming. Only run it while idle: the ADC
+ * kernels share the live scan path.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define BENCH_DEFAULT_CALLS  10000
+#define BENCH_MAX_CALLS      1000000
+#define BENCH_CHUNK          1000     // Calls timed per chunk; the task yields between chunks
+
+/**
+ * Run every kernel (only is "") or the kernel named only, calls times
+ * each, printing one BENCH: line per kernel to out. Returns the number
+ * of kernels run, or -1 if the state could not be allocated.
+ */
+int benchRun(Print &out, uint32_t calls, const char *only);
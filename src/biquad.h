@@ -0,0 +1,51 @@
+/*
+ * CortexKey firmware - fixed-point biquad section
+ *
+ * Direct Form I with Q2.30 coefficients, Q12 samples (1/4096 uV) and a
+ * 64-bit accumulator: exact enough for poles close to the unit circle at
+ * 2 kHz, and 300x headroom over the +/-1650 uV ADC range. No floats.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BIQUAD_COEFF_BITS   30   // Q2.30
+#define FILTER_SAMPLE_BITS  12   // Q12 microvolts
+
+struct BiquadCoeffs {
+  int32_t b0, b1, b2;
+  int32_t a1, a2;           // a0 = 1: y = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2
+};
+
+class Biquad {
+public:
+  void set(const BiquadCoeffs &coeffs) {
+    c = coeffs;
+    reset();
+  }
+
+  void reset() {
+    x1 = x2 = y1 = y2 = 0;
+  }
+
+  inline int32_t process(int32_t x) {
+    int64_t acc = (int64_t)c.b0 * x + (int64_t)c.b1 * x1 + (int64_t)c.b2 * x2
+                - (int64_t)c.a1 * y1 - (int64_t)c.a2 * y2;
+    acc += (int64_t)1 << (BIQUAD_COEFF_BITS - 1);   // round to nearest
+    acc >>= BIQUAD_COEFF_BITS;
+    if (acc > INT32_MAX) acc = INT32_MAX;
+    if (acc < INT32_MIN) acc = INT32_MIN;
+    int32_t y = (int32_t)acc;
+
+    x2 = x1;
+    x1 = x;
+    y2 = y1;
+    y1 = y;
+    return y;
+  }
+
+private:
+  BiquadCoeffs c = {1 << BIQUAD_COEFF_BITS, 0, 0, 0, 0};   // Pass-through
+  int32_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+};
@@ -0,0 +1,151 @@
+/*
+ * CortexKey firmware - interrupt-driven buttons
+ */
+#include "buttons.h"
+
+#include <atomic>
+
+#include <driver/gpio.h>
+#include <freertos/queue.h>
+#include <freertos/timers.h>
+
+// ============================================================
+// STATE
+// ============================================================
+
+struct Button {
+  uint8_t pin = 0;
+  TimerHandle_t debounce;          // One-shot, restarted by every edge
+  TimerHandle_t hold;              // One-shot, started on a debounced press
+  std::atomic<bool> settling{false};
+  volatile uint32_t edgeUs = 0;    // First edge of the current bounce burst
+  bool down = false;               // Debounced level (timer task only)
+  bool longSent = false;
+  uint32_t pressUs = 0;
+};
+
+static const uint8_t BUTTON_PINS[] = {BUTTON_VALID, BUTTON_INVALID};
+static Button buttons[sizeof(BUTTON_PINS)];
+static QueueHandle_t events = nullptr;
+static TaskHandle_t consumerTask = nullptr;
+static std::atomic<uint32_t> dropped{0};
+
+// ============================================================
+// ISR + TIMER CALLBACKS
+// ============================================================
+
+/**
+ * Any edge: keep the time of the first one in the burst (the real press
+ * or release instant) and push the debounce deadline out again.
+ */
+static void IRAM_ATTR onEdge(void *arg) {
+  Button *b = (Button *)arg;
+  uint32_t now = micros();
+  if (!b->settling.exchange(true)) {
+    b->edgeUs = now;
+  }
+  BaseType_t woken = pdFALSE;
+  xTimerResetFromISR(b->debounce, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+static void post(const Button &b, ButtonEventType type, uint32_t heldMs) {
+  ButtonEvent ev = {b.pin, type, b.pressUs, heldMs};
+  if (xQueueSend(events, &ev, 0) != pdTRUE) {
+    dropped++;
+    return;
+  }
+  if (consumerTask) {
+    xTaskNotifyGive(consumerTask);
+  }
+}
+
+/** The level has been stable for BUTTON_DEBOUNCE ms. */
+static void onSettled(TimerHandle_t timer) {
+  Button &b = *(Button *)pvTimerGetTimerID(timer);
+  uint32_t edgeUs = b.edgeUs;
+  b.settling.store(false);
+
+  bool down = digitalRead(b.pin) == LOW;
+  if (down == b.down) {
+    return;                        // Glitch shorter than the debounce time
+  }
+  b.down = down;
+  if (down) {
+    b.pressUs = edgeUs;
+    b.longSent = false;
+    xTimerStart(b.hold, 0);
+  } else {
+    xTimerStop(b.hold, 0);
+    if (!b.longSent) {
+      post(b, BUTTON_SHORT_PRESS, (edgeUs - b.pressUs) / 1000);
+    }
+  }
+}
+
+/** LONG_PRESS_TIME after the press edge (debounce time already elapsed). */
+static void onHeld(TimerHandle_t timer) {
+  Button &b = *(Button *)pvTimerGetTimerID(timer);
+  if (b.down && !b.longSent) {
+    b.longSent = true;
+    post(b, BUTTON_LONG_PRESS, LONG_PRESS_TIME);
+  }
+}
+
+// ============================================================
+// PUBLIC API
+// ============================================================
+
+void buttonsBegin() {
+  events = xQueueCreate(BUTTON_QUEUE_LEN, sizeof(ButtonEvent));
+  for (size_t i = 0; i < sizeof(BUTTON_PINS); i++) {
+    Button &b = buttons[i];
+    b.pin = BUTTON_PINS[i];
+    pinMode(b.pin, INPUT_PULLUP);
+    b.down = digitalRead(b.pin) == LOW;
+    b.longSent = b.down;           // Held through boot: no press until released
+    b.debounce = xTimerCreate("btn", pdMS_TO_TICKS(BUTTON_DEBOUNCE), pdFALSE, &b, onSettled);
+    b.hold = xTimerCreate("hold", pdMS_TO_TICKS(LONG_PRESS_TIME - BUTTON_DEBOUNCE), pdFALSE, &b, onHeld);
+    attachInterruptArg(digitalPinToInterrupt(b.pin), onEdge, &b, CHANGE);
+  }
+}
+
+void buttonsSetConsumer(TaskHandle_t consumer) {
+  consumerTask = consumer;
+}
+
+bool buttonsRead(ButtonEvent &out) {
+  return xQueueReceive(events, &out, 0) == pdTRUE;
+}
+
+uint32_t buttonsDropped() {
+  return dropped.load();
+}
+
+bool buttonsIdle() {
+  for (const Button &b : buttons) {
+    if (b.down || b.settling.load() || digitalRead(b.pin) == LOW) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void buttonsSleepArm() {
+  for (const Button &b : buttons) {
+    gpio_intr_disable((gpio_num_t)b.pin);       // A level interrupt would fire without end
+    gpio_wakeup_enable((gpio_num_t)b.pin, GPIO_INTR_LOW_LEVEL);
+  }
+}
+
+void buttonsSleepDone() {
+  for (Button &b : buttons) {
+    gpio_wakeup_disable((gpio_num_t)b.pin);
+    gpio_set_intr_type((gpio_num_t)b.pin, GPIO_INTR_ANYEDGE);
+    gpio_intr_enable((gpio_num_t)b.pin);
+    if ((digitalRead(b.pin) == LOW) != b.down && !b.settling.exchange(true)) {
+      b.edgeUs = micros();         // Pressed while asleep: the wake-up is the edge
+      xTimerReset(b.debounce, 0);
+    }
+  }
+}
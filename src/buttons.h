@@ -0,0 +1,50 @@
+/*
+ * CortexKey firmware - interrupt-driven buttons
+ *
+ * Each button pin raises a GPIO interrupt on every edge. The ISR only
+ * timestamps the first edge of a bounce burst and restarts a one-shot
+ * debounce timer; once the level has held for BUTTON_DEBOUNCE ms the
+ * timer callback (FreeRTOS timer task) decides press or release, and a
+ * second timer reports a long press while still held. Events are queued
+ * and the consumer task is notified, so nothing polls the pins.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+enum ButtonEventType : uint8_t {
+  BUTTON_SHORT_PRESS,     // Released before LONG_PRESS_TIME
+  BUTTON_LONG_PRESS,      // Still held LONG_PRESS_TIME after the press
+};
+
+struct ButtonEvent {
+  uint8_t pin;
+  ButtonEventType type;
+  uint32_t pressUs;       // micros() at the press edge, taken in the ISR
+  uint32_t heldMs;        // Press to release edge (short) or LONG_PRESS_TIME (long)
+};
+
+/** Attach the edge interrupts on BUTTON_VALID / BUTTON_INVALID. Call once from setup(). */
+void buttonsBegin();
+
+/** Task to notify after every queued event. */
+void buttonsSetConsumer(TaskHandle_t consumer);
+
+/** Pop the oldest event. Returns false when none is pending. */
+bool buttonsRead(ButtonEvent &out);
+
+/** Events lost because the queue was full. */
+uint32_t buttonsDropped();
+
+/** Both buttons released and settled: nothing for a light sleep to cut short. */
+bool buttonsIdle();
+
+/**
+ * Light sleep (power.cpp) cannot latch edges: before sleeping, turn the
+ * pins into low-level wake-up sources; afterwards restore the edge
+ * interrupts and treat any level change during the sleep as an edge.
+ */
+void buttonsSleepArm();
+void buttonsSleepDone();
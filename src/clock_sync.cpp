@@ -0,0 +1,77 @@
+/*
+ * CortexKey firmware - host clock sync
+ */
+#include "clock_sync.h"
+
+void ClockSync::reset() {
+  count = 0;
+  next = 0;
+  accepted = 0;
+  refDevice = 0;
+  refOffset = 0;
+  refRtt = 0;
+  drift = 0.0;
+}
+
+bool ClockSync::add(uint64_t t1, int64_t t2, int64_t t3, uint64_t t4) {
+  if (t4 < t1 || t3 < t2) {
+    return false;
+  }
+  int64_t rtt = (int64_t)(t4 - t1) - (t3 - t2);
+  if (rtt < 0 || rtt > SYNC_RTT_MAX_US) {
+    return false;
+  }
+  Exchange &e = history[next];
+  e.deviceUs = t2 + (t3 - t2) / 2;
+  e.offsetUs = ((int64_t)(t1 - (uint64_t)t2) + (int64_t)(t4 - (uint64_t)t3)) / 2;
+  e.rttUs = (uint32_t)rtt;
+  next = (next + 1) % SYNC_SAMPLES;
+  if (count < SYNC_SAMPLES) count++;
+  accepted++;
+  fit();
+  return true;
+}
+
+void ClockSync::fit() {
+  // Anchor: the least delayed exchange
+  const Exchange *best = &history[0];
+  int64_t first = history[0].deviceUs;
+  int64_t last = first;
+  for (uint8_t i = 1; i < count; i++) {
+    if (history[i].rttUs < best->rttUs) best = &history[i];
+    if (history[i].deviceUs < first) first = history[i].deviceUs;
+    if (history[i].deviceUs > last) last = history[i].deviceUs;
+  }
+  refDevice = best->deviceUs;
+  refOffset = best->offsetUs;
+  refRtt = best->rttUs;
+
+  if (last - first < (int64_t)SYNC_DRIFT_MIN_SEC * 1000000) {
+    drift = 0.0;
+    return;
+  }
+
+  // Slope of offset over device time, over exchanges within 2x the best
+  // round trip (a queued reply skews its offset by up to rtt / 2)
+  double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (history[i].rttUs > 2 * refRtt + 1000) {
+      continue;
+    }
+    double x = (history[i].deviceUs - refDevice) * 1e-6;     // s
+    double y = (double)(history[i].offsetUs - refOffset);    // us
+    n += 1;
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  double den = n * sxx - sx * sx;
+  double slope = (n >= 2 && den > 0) ? (n * sxy - sx * sy) / den : 0.0;
+  drift = (slope > SYNC_DRIFT_MAX_PPM || slope < -SYNC_DRIFT_MAX_PPM) ? 0.0 : slope;
+}
+
+uint64_t ClockSync::toHost(int64_t deviceUs) const {
+  double elapsed = (deviceUs - refDevice) * 1e-6;
+  return (uint64_t)(deviceUs + refOffset + (int64_t)(drift * elapsed));
+}
@@ -0,0 +1,77 @@
+/*
+ * CortexKey firmware - host clock sync
+ *
+ * NTP-style exchanges over the command link map device time (esp_timer,
+ * microseconds since boot) onto the host clock, so frames from several
+ * headsets can carry one common timeline (FRAME_FLAG_HOST_TIME):
+ *
+ *   host                          device
+ *   t1  "SYNC <t1>" ------------>  t2   command handled
+ *   t4  <------ "SYNC:T1=,T2=,T3="  t3   reply written
+ *
+ *   offset = ((t1 - t2) + (t4 - t3)) / 2    host - device
+ *   rtt    = (t4 - t1) - (t3 - t2)          path delay, both ways
+ *
+ * The host only learns t4 once the reply arrives, so it hands it back
+ * with its next request ("SYNC <t1> <t4 of the last reply>") and the
+ * device completes the exchange then. Of the last SYNC_SAMPLES
+ * exchanges the one with the shortest round trip (least queueing, so
+ * the most symmetric path) anchors the offset; once they span
+ * SYNC_DRIFT_MIN_SEC a least-squares fit of the near-minimum ones gives
+ * the crystal drift, which toHost() extrapolates between exchanges.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+class ClockSync {
+public:
+  /** Forget every exchange (SYNC RESET, or the host clock stepped). */
+  void reset();
+
+  /**
+   * Add one completed exchange (t1 / t4 host, t2 / t3 device). Returns
+   * false when it is discarded: negative or above SYNC_RTT_MAX_US round
+   * trip, or a t4 that does not belong to this request.
+   */
+  bool add(uint64_t t1, int64_t t2, int64_t t3, uint64_t t4);
+
+  /** At least one exchange, so toHost() is meaningful. */
+  bool synced() const { return count > 0; }
+
+  /** Host time of a device time. */
+  uint64_t toHost(int64_t deviceUs) const;
+
+  /** host - device at the anchor exchange. */
+  int64_t offsetUs() const { return refOffset; }
+
+  /** Round trip of the anchor exchange. */
+  uint32_t rttUs() const { return refRtt; }
+
+  /** Device clock rate error against the host (positive = device slow). */
+  float driftPpm() const { return (float)drift; }
+
+  /** Exchanges accepted since reset(). */
+  uint32_t exchanges() const { return accepted; }
+
+private:
+  void fit();
+
+  struct Exchange {
+    int64_t deviceUs;           // Midpoint (t2 + t3) / 2
+    int64_t offsetUs;           // host - device
+    uint32_t rttUs;
+  };
+
+  Exchange history[SYNC_SAMPLES];
+  uint8_t count = 0;
+  uint8_t next = 0;
+  uint32_t accepted = 0;
+
+  int64_t refDevice = 0;
+  int64_t refOffset = 0;
+  uint32_t refRtt = 0;
+  double drift = 0.0;           // ppm = offset change in us per second of device time
+};
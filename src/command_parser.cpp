@@ -0,0 +1,166 @@
+/*
+ * CortexKey firmware - non-blocking serial command parser
+ */
+#include "command_parser.h"
+
+void CommandParser::poll(Stream &in) {
+  while (in.available() > 0) {
+    int c = in.read();
+    if (c < 0) {
+      break;
+    }
+    feed((char)c);
+  }
+}
+
+bool CommandParser::feed(char c) {
+  uint8_t b = (uint8_t)c;
+  if (frameLen && millis() - frameStartMs > CMD_FRAME_TIMEOUT_MS) {
+    frameLen = 0;               // Cut off: back to lines
+  }
+  if (frameLen || (len == 0 && !overflow && frameHandler && b == FRAME_SYNC0)) {
+    return feedFrame(b);
+  }
+
+  if (c == '\n' || c == '\r') {
+    if (overflow) {
+      Serial.println("ERROR:Command too long");
+      overflow = false;
+      len = 0;
+      return false;
+    }
+    if (len == 0) {
+      return false;   // Blank line, or the '\n' of a "\r\n" pair
+    }
+    line[len] = '\0';
+    dispatch();
+    len = 0;
+    return true;
+  }
+
+  if (len >= CMD_LINE_MAX) {
+    overflow = true;  // Swallow the rest of the line
+    return false;
+  }
+  line[len++] = (c >= 'a' && c <= 'z') ? (c - 'a' + 'A') : c;
+  return false;
+}
+
+bool CommandParser::feedFrame(uint8_t b) {
+  if (frameLen == 0) {
+    frameStartMs = millis();
+  }
+  frame[frameLen++] = b;
+  if (frameLen == 2 && b != FRAME_SYNC1) {
+    frameLen = 0;               // Stray sync byte, not a frame
+    return false;
+  }
+  if (frameLen == FRAME_HEADER_SIZE) {
+    frameSize = recordFrameSize(frame);
+    if (frameSize > CMD_FRAME_MAX) {
+      frameLen = 0;
+      Serial.println("ERROR:Frame too long");
+      return false;
+    }
+  }
+  if (frameLen < FRAME_HEADER_SIZE || frameLen < frameSize) {
+    return false;
+  }
+  frameLen = 0;
+  frameHandler(frame, frameSize);
+  return true;
+}
+
+const CommandEntry *CommandParser::find(const char *verb) const {
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(commands[i].name, verb) == 0) {
+      return &commands[i];
+    }
+  }
+  return nullptr;
+}
+
+void CommandParser::dispatch() {
+  // Trim, then split "VERB args" in place
+  char *verb = line;
+  while (*verb == ' ' || *verb == '\t') verb++;
+  char *end = line + len;
+  while (end > verb && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+  if (*verb == '\0') {
+    return;
+  }
+
+  char *args = verb;
+  while (*args && *args != ' ' && *args != '\t') args++;
+  if (*args) {
+    *args++ = '\0';
+    while (*args == ' ' || *args == '\t') args++;
+  }
+
+  const CommandEntry *entry = find(verb);
+  if (entry) {
+    entry->handler(args);
+  } else {
+    Serial.println("ERROR:Unknown command");
+  }
+}
+
+bool parseUintArg(const char *args, uint32_t minValue, uint32_t maxValue, uint32_t &out) {
+  if (!args || *args == '\0') {
+    return false;
+  }
+  // Lines are upper-cased before dispatch, so the prefix is "0X"
+  uint32_t base = 10;
+  if (args[0] == '0' && args[1] == 'X') {
+    base = 16;
+    args += 2;
+  }
+
+  uint32_t v = 0;
+  int digits = 0;
+  for (;; args++, digits++) {
+    uint32_t d;
+    char c = *args;
+    if (c >= '0' && c <= '9') d = c - '0';
+    else if (base == 16 && c >= 'A' && c <= 'F') d = c - 'A' + 10;
+    else break;
+    if (v > (0xFFFFFFFFu - d) / base) {
+      return false;
+    }
+    v = v * base + d;
+  }
+  if (digits == 0 || (*args != '\0' && *args != ' ')) {
+    return false;
+  }
+  if (v < minValue || v > maxValue) {
+    return false;
+  }
+  out = v;
+  return true;
+}
+
+bool parseUint64Arg(const char *args, uint64_t &out) {
+  if (!args) {
+    return false;
+  }
+  uint64_t v = 0;
+  int digits = 0;
+  for (; *args >= '0' && *args <= '9'; args++, digits++) {
+    uint64_t d = *args - '0';
+    if (v > (UINT64_MAX - d) / 10) {
+      return false;
+    }
+    v = v * 10 + d;
+  }
+  if (digits == 0 || (*args != '\0' && *args != ' ')) {
+    return false;
+  }
+  out = v;
+  return true;
+}
+
+const char *nextArg(const char *args) {
+  while (*args && *args != ' ' && *args != '\t') args++;
+  while (*args == ' ' || *args == '\t') args++;
+  return args;
+}
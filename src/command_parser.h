@@ -0,0 +1,92 @@
+/*
+ * CortexKey firmware - non-blocking serial command parser
+ *
+ * Bytes are fed one at a time into a fixed line buffer; a complete line
+ * ("VERB [args]\n") is upper-cased, split at the first space and
+ * dispatched through a const table of {name, handler}. No String, no heap,
+ * and poll() only consumes what is already in the UART FIFO, so a partial
+ * line never blocks the caller.
+ *
+ * Adding a command is one table row:
+ *   static const CommandEntry COMMANDS[] = {
+ *     {"START", cmdStart},
+ *     {"RATE",  cmdRate},     // handler receives "500" for "RATE 500"
+ *   };
+ *   CommandParser parser(COMMANDS);
+ *
+ * With a frame handler set, a line that starts with the frame sync byte
+ * is read as one binary record frame instead (protocol.h; the host sends
+ * CONFIG that way) and handed over whole. A frame not complete within
+ * CMD_FRAME_TIMEOUT_MS is dropped, so a cut-off one cannot swallow the
+ * next command.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "protocol.h"
+
+#define CMD_LINE_MAX  64    // Longest accepted line, excluding newline
+#define CMD_FRAME_MAX         (FRAME_HEADER_SIZE + CONFIG_FIELDS * 4 + FRAME_CRC_SIZE)
+#define CMD_FRAME_TIMEOUT_MS  100
+
+/** Receives the trimmed argument text ("" when none). */
+typedef void (*CommandHandler)(const char *args);
+
+/** Receives a complete record frame (CRC not yet checked). */
+typedef void (*FrameHandler)(const uint8_t *frame, size_t len);
+
+struct CommandEntry {
+  const char *name;
+  CommandHandler handler;
+};
+
+class CommandParser {
+public:
+  template <size_t N>
+  explicit CommandParser(const CommandEntry (&table)[N]) : commands(table), count(N) {}
+
+  /** Consume every byte currently available on the stream. */
+  void poll(Stream &in);
+
+  /** Feed one byte. Returns true if it completed (and dispatched) a line. */
+  bool feed(char c);
+
+  /** Table lookup for an already split, upper-case verb. */
+  const CommandEntry *find(const char *verb) const;
+
+  /** Accept binary frames at the start of a line (nullptr: text only). */
+  void setFrameHandler(FrameHandler handler) { frameHandler = handler; }
+
+private:
+  void dispatch();
+  bool feedFrame(uint8_t b);
+
+  const CommandEntry *commands;
+  size_t count;
+  char line[CMD_LINE_MAX + 1];
+  size_t len = 0;
+  bool overflow = false;
+
+  FrameHandler frameHandler = nullptr;
+  uint8_t frame[CMD_FRAME_MAX];
+  size_t frameLen = 0;        // Bytes of a frame in progress, 0 = line mode
+  size_t frameSize = 0;       // Its full size, once the header is in
+  unsigned long frameStartMs = 0;
+};
+
+/**
+ * Parse an unsigned argument, decimal or 0x-prefixed hex, up to the next
+ * space. Returns false if args is empty, not a number or outside
+ * [minValue, maxValue].
+ */
+bool parseUintArg(const char *args, uint32_t minValue, uint32_t maxValue, uint32_t &out);
+
+/**
+ * Parse a decimal 64-bit argument (microsecond timestamps) up to the
+ * next space. Returns false if args is empty or not such a number.
+ */
+bool parseUint64Arg(const char *args, uint64_t &out);
+
+/** The argument after the first one in args ("" when none). */
+const char *nextArg(const char *args);
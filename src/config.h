@@ -0,0 +1,114 @@
+/*
+ * CortexKey firmware - build-time configuration
+ *
+ * Pin map, timing and buffer sizes shared by every firmware module.
+ */
+#pragma once
+
+// ============================================================
+// HARDWARE
+// ============================================================
+#ifndef USE_MOCK_DATA
+#define USE_MOCK_DATA    1      // 0: real sensor (env:esp32dev-sensor); picks the pipeline source
+#endif
+#ifndef BENCH_AT_BOOT
+#define BENCH_AT_BOOT    0      // 1: run the BENCH suite once at boot (env:esp32dev-bench)
+#endif
+#define EEG_PIN          34     // GPIO34 (ADC1_CH6)
+#define BUTTON_VALID     18     // GPIO18 - Valid user button
+#define BUTTON_INVALID   19     // GPIO19 - Invalid user button
+#define LED_PIN          2      // Built-in LED
+
+#define EEG_MAX_CHANNELS          8       // ADC1 pins 32-39 (see adc_scan.cpp)
+#define EEG_DEFAULT_CHANNEL_MASK  0x01    // Channel 0 = EEG_PIN
+#define EEG_DEFAULT_GAIN          1000    // BioAmp EXG Pill front-end gain (GAIN)
+
+// ============================================================
+// TIMING
+// ============================================================
+#define SAMPLE_RATE      250    // Hz at boot; RATE <hz> changes it at runtime
+#define SAMPLE_RATE_MAX  2000   // Hz; every usable rate also needs a filter design
+#define AUTO_STOP_SEC    10     // Length of a button-triggered test
+#define STATS_INTERVAL_SEC 1  // STATS record cadence while streaming (protocol.h)
+#define SERIAL_BAUD      115200 // Boot rate; the host may negotiate more with BAUD
+#define BAUD_CONFIRM_MS  1000   // Revert a BAUD switch not confirmed within this
+
+#define BUTTON_DEBOUNCE  50     // ms the level must hold after the last edge
+#define LONG_PRESS_TIME  2000   // ms for long press
+#define BUTTON_QUEUE_LEN 8      // Button events waiting for the comms task
+
+// ============================================================
+// NETWORK (LINK UDP)
+// ============================================================
+#define WIFI_ENABLED     0      // 1 to build the Wi-Fi/UDP transport
+#define WIFI_SSID        ""
+#define WIFI_PASSWORD    ""
+#define UDP_GROUP        239, 255, 0, 42   // Multicast group (or a unicast ingest host)
+#define UDP_PORT         5005
+#define UDP_MAX_BLOCK    1460   // TX block bytes per datagram: 1472 UDP MTU - 12 header
+
+// ============================================================
+// SAMPLING ENGINE
+// ============================================================
+#define SAMPLER_TIMER        0      // Hardware timer group 0, timer 0
+#define SAMPLER_TIMER_DIV    80     // 80 MHz APB / 80 = 1 MHz tick (1 us)
+#define SAMPLER_CORE         1      // Core the acquisition task is pinned to
+#define SAMPLER_TASK_STACK   4096   // bytes
+#define SAMPLER_TICK_MAX     8000   // Hz: rate x OVERSAMPLE ratio (8 channels fit in 125 us)
+#define SAMPLE_RING_SIZE     1024   // Samples buffered between the two cores (~0.5 s at 2 kHz)
+
+// ============================================================
+// COMMS TASK
+// ============================================================
+#define COMMS_CORE           0      // Serial TX, commands, buttons, LED
+#define COMMS_TASK_STACK     8192   // bytes
+#define COMMS_TASK_PRIORITY  2      // Above IDLE0, below the Wi-Fi/lwIP tasks
+#define COMMS_POLL_MS        10     // Max sleep between command polls
+
+// ============================================================
+// POWER (power.h)
+// ============================================================
+#define POWER_MAX_MHZ          240    // Heavy streams, BENCH, POWER MAX
+#define POWER_MIN_MHZ          80     // DFS floor: below this APB (UART, sample timer) slows too
+#define POWER_LOAD_MIN_MHZ     4000   // ADC conversions/s a light stream may need at POWER_MIN_MHZ
+#define POWER_LOAD_160MHZ      16000  // ... at 160 MHz; above that POWER_MAX_MHZ
+#define POWER_SLEEP_AFTER_MS   2000   // Idle with no command or button this long: light sleep
+#define POWER_SLEEP_MAX_MS     1000   // Timer wake-up bound on one light sleep
+#define POWER_UART_WAKE_EDGES  3      // RX edges that wake the chip (that character is lost)
+
+// ============================================================
+// AUTH SESSION (auth_session.h)
+// ============================================================
+#define AUTH_HOP_MS            200    // One classified window per hop, after the first 2 s
+#define AUTH_MIN_WINDOWS       2      // Windows averaged before an early decision
+#define AUTH_ACCEPT_P          0.90f  // Mean P(authenticated) that ends a session as ACCEPT
+#define AUTH_REJECT_P          0.10f  // ... as REJECT; in between, decided at AUTO_STOP_SEC
+
+// ============================================================
+// ARTIFACT DETECTION (artifact.h)
+// ============================================================
+#define ARTIFACT_AMPLITUDE_UV  75     // |x - baseline|: blinks, electrode pops
+#define ARTIFACT_BASELINE_SEC  2      // DC tracker time constant
+#define ARTIFACT_STEP_UV       50     // Change within 4 ms: movement spikes
+#define ARTIFACT_HIGHBAND_HZ   35     // Muscle band, above the 5-30 Hz EEG pass band
+#define ARTIFACT_HIGHBAND_MS   100    // RMS window of the muscle band
+#define ARTIFACT_HIGHBAND_UV   20     // Muscle band RMS of an EMG burst
+#define ARTIFACT_HOLD_MS       200    // Keep flagging this long after the last hit
+
+// ============================================================
+// CLOCK SYNC (clock_sync.h)
+// ============================================================
+#define SYNC_SAMPLES           16     // Exchanges kept for the anchor and the drift fit
+#define SYNC_RTT_MAX_US        50000  // Slower exchanges are discarded
+#define SYNC_DRIFT_MIN_SEC     10     // Exchange span before drift is fitted
+#define SYNC_DRIFT_MAX_PPM     200    // Beyond any crystal: the fit is wrong, use none
+
+// ============================================================
+// SESSION RECORDER (recorder.h)
+// ============================================================
+#define RECORD_ENABLED         1      // Record MODE_AUTH_* sessions from boot (RECORD ON|OFF)
+#define RECORD_PSRAM_BYTES     (2UL * 1024 * 1024)   // Log in PSRAM, on modules that have it
+#define RECORD_PARTITION       "spiffs"   // Otherwise this flash data partition (default table)
+#define RECORD_SECTOR_BYTES    4096   // Flash erase unit
+#define RECORD_PAGE_BYTES      256    // Flash program unit: the log is written a page at a time
+#define RECORD_DUMP_SLICE      4096   // DUMP bytes written per comms loop iteration
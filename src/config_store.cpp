@@ -0,0 +1,61 @@
+/*
+ * CortexKey firmware - persistent configuration
+ */
+#include "config_store.h"
+
+#include <Preferences.h>
+
+#include "band_power.h"
+#include "decimator.h"
+#include "tx_ring.h"
+
+void configDefaults(DeviceConfig &config) {
+  memset(&config, 0, sizeof(config));
+  config.version = CONFIG_VERSION;
+  config.rate = SAMPLE_RATE;
+  config.oversample = 1;
+  config.decimFilter = DECIM_CIC;
+  config.channelMask = EEG_DEFAULT_CHANNEL_MASK;
+  config.format = FORMAT_ASCII;
+  config.compressOrder = 1;
+  config.blockSamples = TX_BLOCK_DEFAULT;
+  config.featureHop = FEATURE_HOP_DEFAULT;
+  config.notchHz = 50;
+  config.artifact = 1;
+  config.baud = SERIAL_BAUD;
+  for (uint8_t ch = 0; ch < EEG_MAX_CHANNELS; ch++) {
+    config.gain[ch] = EEG_DEFAULT_GAIN;
+  }
+}
+
+bool configLoad(DeviceConfig &config) {
+  Preferences prefs;
+  bool ok = false;
+  if (prefs.begin(CONFIG_NVS_NAMESPACE, true)) {
+    ok = prefs.getBytes("cfg", &config, sizeof(config)) == sizeof(config) &&
+         config.version == CONFIG_VERSION;
+    prefs.end();
+  }
+  if (!ok) {
+    configDefaults(config);
+  }
+  return ok;
+}
+
+bool configSave(const DeviceConfig &config) {
+  Preferences prefs;
+  if (!prefs.begin(CONFIG_NVS_NAMESPACE, false)) {
+    return false;
+  }
+  bool ok = prefs.putBytes("cfg", &config, sizeof(config)) == sizeof(config);
+  prefs.end();
+  return ok;
+}
+
+void configErase() {
+  Preferences prefs;
+  if (prefs.begin(CONFIG_NVS_NAMESPACE, false)) {
+    prefs.remove("cfg");
+    prefs.end();
+  }
+}
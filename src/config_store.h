@@ -0,0 +1,35 @@
+/*
+ * CortexKey firmware - persistent configuration
+ *
+ * One DeviceConfig blob (protocol.h) in NVS: sample rate, oversampling,
+ * channels, per-channel gain, output format, filters, baud and the boot
+ * options. setup() applies it before the host says anything, so with
+ * CONFIG AUTOSTART ON the device streams in its last configuration within
+ * milliseconds of power-up, and CONFIG QUIET ON drops the banner and the
+ * startup delay. CONFIG SAVE stores what is running, or the host sends a
+ * single CONFIG frame.
+ *
+ * A blob of another CONFIG_VERSION (or none) boots the build-time
+ * defaults from config.h. The ADC calibration table lives in its own
+ * namespace (adc_cal.h).
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "protocol.h"
+
+#define CONFIG_VERSION        1         // Bump when DeviceConfig changes
+#define CONFIG_NVS_NAMESPACE  "ckcfg"
+
+/** The build-time configuration (config.h): what a first boot runs. */
+void configDefaults(DeviceConfig &config);
+
+/** Read the stored configuration. Returns false (config = defaults) when none is usable. */
+bool configLoad(DeviceConfig &config);
+
+/** Store config for the next boot. */
+bool configSave(const DeviceConfig &config);
+
+/** Forget the stored configuration; the next boot runs the defaults. */
+void configErase();
@@ -0,0 +1,129 @@
+/*
+ * CortexKey firmware - oversampling decimator
+ */
+#include "decimator.h"
+
+#include <math.h>
+#include <string.h>
+
+const char *decimFilterName(DecimFilter filter) {
+  switch (filter) {
+    case DECIM_AVG: return "AVG";
+    case DECIM_FIR: return "FIR";
+    default: return "CIC";
+  }
+}
+
+bool Decimator::configure(uint8_t osr, DecimFilter filter) {
+  if (osr == 0 || osr > DECIM_MAX_OSR || (osr & (osr - 1))) {
+    return false;
+  }
+  ratio = osr;
+  ratioBits = 0;
+  while ((1u << ratioBits) < osr) ratioBits++;
+  type = filter;
+  if (type == DECIM_FIR) {
+    designFir();
+  }
+  reset();
+  return true;
+}
+
+void Decimator::reset() {
+  phase = 0;
+  histPos = 0;
+  memset(integ, 0, sizeof(integ));
+  memset(comb, 0, sizeof(comb));
+  memset(history, 0, sizeof(history));
+}
+
+/**
+ * Blackman-windowed sinc, cutoff at 0.8 x the output Nyquist, quantized
+ * to Q15 with the rounding error folded into the centre tap so DC gain is
+ * exactly 1.
+ */
+void Decimator::designFir() {
+  tapCount = ratio * DECIM_FIR_TAPS_PER_PHASE;
+  const float fc = 0.4f / ratio;             // Cycles per input sample
+  const float mid = (tapCount - 1) * 0.5f;
+  float h[DECIM_FIR_MAX_TAPS];
+  float sum = 0.0f;
+  for (uint16_t n = 0; n < tapCount; n++) {
+    float t = n - mid;
+    float sinc = (t == 0.0f) ? 2.0f * fc : sinf(2.0f * (float)M_PI * fc * t) / ((float)M_PI * t);
+    float w = 0.42f - 0.5f * cosf(2.0f * (float)M_PI * n / (tapCount - 1))
+            + 0.08f * cosf(4.0f * (float)M_PI * n / (tapCount - 1));
+    h[n] = sinc * w;
+    sum += h[n];
+  }
+  int32_t total = 0;
+  for (uint16_t n = 0; n < tapCount; n++) {
+    taps[n] = (int16_t)lroundf(h[n] / sum * (1 << DECIM_FIR_COEFF_BITS));
+    total += taps[n];
+  }
+  taps[tapCount / 2] += (1 << DECIM_FIR_COEFF_BITS) - total;
+}
+
+bool Decimator::push(const uint16_t *raw, uint8_t channels, int32_t *out) {
+  if (ratio == 1) {
+    for (uint8_t ch = 0; ch < channels; ch++) {
+      out[ch] = (int32_t)raw[ch] << DECIM_FRAC_BITS;
+    }
+    return true;
+  }
+
+  bool ready = ++phase >= ratio;
+  if (ready) {
+    phase = 0;
+  }
+
+  if (type == DECIM_FIR) {
+    const uint16_t mask = tapCount - 1;
+    for (uint8_t ch = 0; ch < channels; ch++) {
+      history[ch][histPos] = raw[ch];
+    }
+    if (ready) {
+      // taps[0] meets the newest input
+      for (uint8_t ch = 0; ch < channels; ch++) {
+        const uint16_t *x = history[ch];
+        int32_t acc = 0;
+        for (uint16_t k = 0; k < tapCount; k++) {
+          acc += (int32_t)taps[k] * x[(histPos - k) & mask];
+        }
+        const int shift = DECIM_FIR_COEFF_BITS - DECIM_FRAC_BITS;
+        out[ch] = (acc + (1 << (shift - 1))) >> shift;
+      }
+    }
+    histPos = (histPos + 1) & mask;
+    return ready;
+  }
+
+  const uint8_t order = (type == DECIM_AVG) ? 1 : DECIM_CIC_ORDER;
+  for (uint8_t ch = 0; ch < channels; ch++) {
+    uint32_t v = raw[ch];
+    for (uint8_t i = 0; i < order; i++) {
+      integ[ch][i] += v;
+      v = integ[ch][i];
+    }
+  }
+  if (!ready) {
+    return false;
+  }
+
+  // DC gain is osr^order; rescale to Q8 codes
+  const int shift = order * ratioBits - DECIM_FRAC_BITS;
+  for (uint8_t ch = 0; ch < channels; ch++) {
+    uint32_t v = integ[ch][order - 1];
+    for (uint8_t i = 0; i < order; i++) {
+      uint32_t d = v - comb[ch][i];
+      comb[ch][i] = v;
+      v = d;
+    }
+    if (shift >= 0) {
+      out[ch] = (int32_t)((v + (shift ? (1u << (shift - 1)) : 0)) >> shift);
+    } else {
+      out[ch] = (int32_t)(v << -shift);
+    }
+  }
+  return true;
+}
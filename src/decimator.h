@@ -0,0 +1,75 @@
+/*
+ * CortexKey firmware - oversampling decimator
+ *
+ * With OVERSAMPLE n the sampler ticks n times per output sample and every
+ * tick's raw ADC codes are fed in here; one decimated sample per channel
+ * comes out every n ticks. Averaging n conversions cuts white ADC noise by
+ * sqrt(n) and the result keeps DECIM_FRAC_BITS of sub-LSB resolution.
+ *
+ * Filters (all integer):
+ *   AVG  n-sample boxcar (CIC order 1)
+ *   CIC  3rd-order CIC (sinc^3): much deeper nulls at the first alias bands
+ *   FIR  windowed-sinc lowpass, DECIM_FIR_TAPS_PER_PHASE * n taps, only
+ *        computed on output ticks (polyphase decimation)
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "config.h"
+
+#define DECIM_MAX_OSR             16
+#define DECIM_FRAC_BITS           8       // Output is raw code in Q8
+#define DECIM_CIC_ORDER           3
+#define DECIM_FIR_TAPS_PER_PHASE  8
+#define DECIM_FIR_MAX_TAPS        (DECIM_MAX_OSR * DECIM_FIR_TAPS_PER_PHASE)
+#define DECIM_FIR_COEFF_BITS      15      // Q15, taps sum to exactly 1.0
+
+enum DecimFilter {
+  DECIM_AVG,
+  DECIM_CIC,
+  DECIM_FIR
+};
+
+const char *decimFilterName(DecimFilter filter);
+
+class Decimator {
+public:
+  /**
+   * Set the oversampling ratio (power of two, 1 .. DECIM_MAX_OSR) and
+   * filter, and reset. Returns false, leaving the decimator unchanged,
+   * for any other ratio.
+   */
+  bool configure(uint8_t osr, DecimFilter filter);
+
+  /** Clear all filter state (start of a new stream). */
+  void reset();
+
+  /**
+   * Add one raw conversion per channel. Returns true when out[] holds a
+   * decimated sample (Q8 raw codes) - every osr() calls.
+   */
+  bool push(const uint16_t *raw, uint8_t channels, int32_t *out);
+
+  uint8_t osr() const { return ratio; }
+  DecimFilter filter() const { return type; }
+
+private:
+  void designFir();
+
+  uint8_t ratio = 1;
+  uint8_t ratioBits = 0;
+  DecimFilter type = DECIM_CIC;
+  uint8_t phase = 0;            // Inputs since the last output
+
+  // CIC: integrators run at the input rate, combs at the output rate.
+  // Unsigned so wrap-around is defined; the comb differences are exact.
+  uint32_t integ[EEG_MAX_CHANNELS][DECIM_CIC_ORDER];
+  uint32_t comb[EEG_MAX_CHANNELS][DECIM_CIC_ORDER];
+
+  // FIR: per-channel history ring (length = taps, a power of two)
+  int16_t taps[DECIM_FIR_MAX_TAPS];
+  uint16_t tapCount = 0;
+  uint16_t histPos = 0;
+  uint16_t history[EEG_MAX_CHANNELS][DECIM_FIR_MAX_TAPS];
+};
@@ -0,0 +1,37 @@
+/*
+ * CortexKey firmware - streaming EEG filter chain
+ */
+#include "dsp_filter.h"
+
+bool EegFilterChain::configure(uint32_t rate, uint8_t notchHz) {
+  const FilterDesign *design = filterDesignFor(rate);
+  if (!design || (notchHz != 0 && notchHz != 50 && notchHz != 60)) {
+    return false;
+  }
+
+  count = 0;
+  if (notchHz == 50) {
+    sections[count++].set(design->notch50);
+  } else if (notchHz == 60) {
+    sections[count++].set(design->notch60);
+  }
+  for (uint8_t i = 0; i < FILTER_BANDPASS_SECTIONS; i++) {
+    sections[count++].set(design->bandpass[i]);
+  }
+
+  sampleRate = rate;
+  notchFreq = notchHz;
+  return true;
+}
+
+void EegFilterChain::reset() {
+  for (uint8_t i = 0; i < count; i++) {
+    sections[i].reset();
+  }
+}
+
+float EegFilterChain::process(float uV) {
+  const float toFixed = (float)(1 << FILTER_SAMPLE_BITS);
+  const float fromFixed = 1.0f / toFixed;
+  return processFixed((int32_t)(uV * toFixed)) * fromFixed;
+}
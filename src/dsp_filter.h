@@ -0,0 +1,52 @@
+/*
+ * CortexKey firmware - streaming EEG filter chain
+ *
+ * Causal version of the backend's pre-processing in eeg_pipeline.py:
+ * optional 50/60 Hz notch followed by the 5-30 Hz Butterworth bandpass,
+ * as a cascade of fixed-point biquads from filter_coeffs.h. One sample in,
+ * one sample out, so the host no longer has to re-filter every
+ * overlapping window. (The backend uses filtfilt, which is zero-phase;
+ * this chain has the same magnitude response once, and group delay.)
+ */
+#pragma once
+
+#include "config.h"
+#include "filter_coeffs.h"
+
+static_assert(hasFilterDesign(SAMPLE_RATE),
+              "SAMPLE_RATE has no filter design - add it to tools/gen_filter_coeffs.py");
+
+#define FILTER_MAX_SECTIONS  (1 + FILTER_BANDPASS_SECTIONS)
+
+class EegFilterChain {
+public:
+  /**
+   * Load coefficients for a sample rate. notchHz is 50, 60 or 0 (no
+   * notch). Returns false, leaving the chain unchanged, if the rate has
+   * no design. Resets the filter state.
+   */
+  bool configure(uint32_t rate, uint8_t notchHz);
+
+  /** Clear the delay lines (start of a new stream). */
+  void reset();
+
+  /** Filter one sample in Q12 microvolts. */
+  inline int32_t processFixed(int32_t x) {
+    for (uint8_t i = 0; i < count; i++) {
+      x = sections[i].process(x);
+    }
+    return x;
+  }
+
+  /** Filter one sample in microvolts. */
+  float process(float uV);
+
+  uint32_t rate() const { return sampleRate; }
+  uint8_t notch() const { return notchFreq; }
+
+private:
+  Biquad sections[FILTER_MAX_SECTIONS];
+  uint8_t count = 0;
+  uint32_t sampleRate = 0;
+  uint8_t notchFreq = 0;
+};
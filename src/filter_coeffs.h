@@ -0,0 +1,73 @@
+/*
+ * CortexKey firmware - filter coefficient tables
+ *
+ * GENERATED by tools/gen_filter_coeffs.py - do not edit by hand.
+ * Notch: iirnotch Q=30 at 50, 60 Hz.
+ * Bandpass: Butterworth order 4, 5-30 Hz.
+ * Coefficients are Q2.30: { b0, b1, b2, a1, a2 }, a0 = 1.
+ */
+#pragma once
+
+#include "biquad.h"
+
+#define FILTER_BANDPASS_SECTIONS  4
+
+struct FilterDesign {
+  uint32_t rate;
+  BiquadCoeffs notch50;
+  BiquadCoeffs notch60;
+  BiquadCoeffs bandpass[FILTER_BANDPASS_SECTIONS];
+};
+
+constexpr FilterDesign FILTER_DESIGNS[] = {
+  { 250,
+    {  1051711606,  -649993519,  1051711606,  -649993519,  1029681389 },
+    {  1047411947,  -131535081,  1047411947,  -131535081,  1021082069 },
+    {
+      {   282982398,           0,  -282982398, -1245948674,   415964850 },
+      {   282982398,           0,  -282982398, -1337749881,   730798643 },
+      {   282982398,           0,  -282982398, -1868344586,   820806341 },
+      {   282982398,           0,  -282982398, -2054725273,   998220464 },
+    } },
+  { 500,
+    {  1062613752, -1719345168,  1062613752, -1719345168,  1051485680 },
+    {  1060415548, -1546019333,  1060415548, -1546019333,  1047089271 },
+    {
+      {   153401455,           0,  -153401455, -1685711803,   682180244 },
+      {   153401455,           0,  -153401455, -1821513059,   877777622 },
+      {   153401455,           0,  -153401455, -2006029882,   939368467 },
+      {   153401455,           0,  -153401455, -2105005185,  1035659014 },
+    } },
+  { 1000,
+    {  1068148958, -2031740054,  1068148958, -2031740054,  1062556092 },
+    {  1067037342, -1984212461,  1067037342, -1984212461,  1060332861 },
+    {
+      {    80273846,           0,   -80273846, -1912523313,   857976522 },
+      {    80273846,           0,   -80273846, -2009214054,   969755518 },
+      {    80273846,           0,   -80273846, -2076303079,  1004395955 },
+      {    80273846,           0,   -80273846, -2127207009,  1054574479 },
+    } },
+  { 2000,
+    {  1070938108, -2115506166,  1070938108, -2115506166,  1068134392 },
+    {  1070379118, -2102839522,  1070379118, -2102839522,  1067016412 },
+    {
+      {    41118589,           0,   -41118589, -2028806453,   960109504 },
+      {    41118589,           0,   -41118589, -2085228281,  1020285225 },
+      {    41118589,           0,   -41118589, -2111776721,  1038501566 },
+      {    41118589,           0,   -41118589, -2137583996,  1064120772 },
+    } },
+};
+
+constexpr size_t FILTER_DESIGN_COUNT = sizeof(FILTER_DESIGNS) / sizeof(FILTER_DESIGNS[0]);
+
+/** True when a sample rate has a tabulated design. */
+constexpr bool hasFilterDesign(uint32_t rate, size_t i = 0) {
+  return i < FILTER_DESIGN_COUNT && (FILTER_DESIGNS[i].rate == rate || hasFilterDesign(rate, i + 1));
+}
+
+/** Design for a sample rate, or nullptr when the rate is not tabulated. */
+constexpr const FilterDesign *filterDesignFor(uint32_t rate, size_t i = 0) {
+  return i >= FILTER_DESIGN_COUNT ? nullptr
+       : FILTER_DESIGNS[i].rate == rate ? &FILTER_DESIGNS[i]
+       : filterDesignFor(rate, i + 1);
+}
@@ -4,18 +4,45 @@
  * 
  * Hardware:
  *   ESP32 DevKit V1
- *   BioAmp EXG Pill → GPIO34 (ADC1_CH6)
+ *   BioAmp EXG Pill → GPIO34 (ADC1_CH6); up to 8 on ADC1 (adc_scan.cpp)
  *   Button 1 (Valid User) → GPIO18 (pull-up enabled)
  *   Button 2 (Invalid User) → GPIO19 (pull-up enabled)
  * 
- * Serial: 115200 baud
- * Sample Rate: 250 Hz (4ms per sample)
- * Output Format: DATA,timestamp_ms,sample1,sample2...\n
+ * Serial: 115200 baud at boot (or the stored CONFIG baud); BAUD negotiates
+ *   up to 2 Mbaud
+ * Config: rate, channels, gains, format, filters, baud and boot options
+ *   persist in NVS (config_store.h); with CONFIG QUIET ON and AUTOSTART
+ *   ON a boot skips the banner and streams at once
+ * Sample Rate: 250 Hz default, up to 2 kHz via RATE (hardware-timer driven)
+ * Timestamps: sample index x period, never millis(); binary frames also
+ *   carry the sampling timer's 64-bit us time of their first sample, on
+ *   the host clock once SYNC has run (clock_sync.h)
+ * Output Format: DATA,timestamp_ms,ch0[,ch1...]\n or binary frames (protocol.h)
+ * Stream health: a STATS record (frame, or STATS: line in ASCII) every
+ *   STATS_INTERVAL_SEC and at stop - samples taken/sent, overruns, TX drops
+ * Artifacts: blinks, spikes and muscle bursts are detected on the raw
+ *   samples (artifact.h); frames holding them carry FRAME_FLAG_ARTIFACT
+ *   and FEATURES / AUTH skip the windows they fall in
+ * Recorder: every button test / AUTH session is also logged to PSRAM or
+ *   the flash spiffs partition (recorder.h), whatever the link does;
+ *   DUMP sends the log back in one burst
  * 
  * Button Functions:
  *   GPIO18 Press: Start VALID user authentication test
  *   GPIO19 Press: Start INVALID user authentication test
  *   Long Press (2s): Stop and return to idle
+ *   With AUTH ON (default) a test is classified on the device
+ *   (auth_session.h) and ends at the first confident decision; only
+ *   AUTH: lines go to the host. AUTH OFF streams the 10 s test instead.
+ * 
+ * Tasks:
+ *   Core 1: timer-driven acquisition (sampler.cpp)
+ *   Core 0: comms - serial TX, command parser, buttons, LED
+ *   Buttons: GPIO edge interrupts + debounce timers (buttons.cpp) queue
+ *   press events and wake comms; nothing polls the pins.
+ *   Power: 80 MHz and light sleep when idle, stream clock by load (power.h)
+ *   The two only share the lock-free sample ring, so a slow host or a
+ *   long STATUS reply can never stall sampling.
  * 
  * Commands (via Serial):
  *   START        → Begin streaming
@@ -23,23 +50,78 @@
  *   MOCK_AUTH    → Switch to authenticated mock data
  *   MOCK_IMP     → Switch to impostor mock data
  *   STATUS       → Get current status
+ *   ASCII        → Stream DATA,timestamp,value lines (default)
+ *   BINARY       → Stream packed int16 sample frames (see protocol.h)
+ *   BINARY24     → Stream packed int24 sample frames
+ *   COMPRESSED [1|2] → Stream delta (order 1/2) + Rice coded sample frames
+ *   BLOCK <n>    → Send samples in blocks of n (1-100, default 25)
+ *   FILTER ON|OFF → On-device notch + 5-30 Hz bandpass (default OFF)
+ *   NOTCH 50|60|OFF → Powerline notch frequency for FILTER (default 50)
+ *   FEATURES [hop] → Stream band-power feature frames every hop samples
+ *                    (default 50) over a 2 s window; turns FILTER ON
+ *   RATE <hz>     → Sample rate 250|500|1000|2000 (idle only); block and
+ *                    feature hop keep their duration
+ *   OVERSAMPLE <n> [AVG|CIC|FIR] → Sample n times per output and decimate
+ *                    (1/2/4/8/16, default CIC; idle only)
+ *   CHANNELS <mask> → Enable ADC1 channels (bit i = channel i, idle only)
+ *   GAIN <ch> <g> → Front-end amplifier gain of a channel (default 1000)
+ *   BAUD <rate>   → Switch the UART (115200 .. 2000000) after "ACK:BAUD";
+ *                    reverts unless BAUD CONFIRM arrives within 1 s
+ *   LINK SERIAL|UDP → Send sample blocks over the UART or as UDP datagrams
+ *                    to UDP_GROUP (needs WIFI_ENABLED); text stays on Serial
+ *   ADCCAL [REBUILD] → Show (or rebuild from eFuse) the ADC calibration table
+ *   PERF [RESET|<s>] → Loop/acquisition timing, jitter histogram, TX rate,
+ *                    buffer peaks, heap, idle; <s> also sends it every s
+ *                    seconds (PERF frame, or PERF: line in ASCII; 0 = off)
+ *   BENCH [n] [name] → Time each DSP / TX kernel n times (default 10000,
+ *                    idle only) and print cycles per call (bench.h)
+ *   POWER [ECO|MAX] → Show the clock and sleep counters, or pick DFS + idle
+ *                    light sleep (ECO, default) or a fixed 240 MHz (MAX)
+ *   AUTH [ON|OFF] → Run an on-device authentication session now (mock
+ *                    type picks the signal), or choose whether button
+ *                    tests run one (ON, default) or stream (OFF)
+ *   ARTIFACT ON|OFF → Artifact detection and window rejection (default ON);
+ *                    ASCII lines are never tagged
+ *   CONFIG [SAVE|ERASE|AUTOSTART ON|OFF|QUIET ON|OFF] → Dump the running
+ *                    configuration as one CONFIG frame, store it for the
+ *                    next boot, or forget it; a CONFIG frame sent in
+ *                    place of a line applies and stores a whole one
+ *   RECORD [ON|OFF|CLEAR] → Show the session log, turn recording of
+ *                    test / AUTH sessions on (default) or off, or empty it
+ *   DUMP         → (idle) "STATUS:Dump,Bytes=<n>,Sessions=<s>", the n log
+ *                    bytes (SESSION records + int24 sample frames), then
+ *                    "STATUS:Dump done"; commands wait until it is out
+ *   SYNC <t1> [<t4>] → Clock sync exchange (host us): replies
+ *                    SYNC:T1=,T2=,T3= and, with the previous reply's
+ *                    arrival time t4, adds that exchange; SYNC alone
+ *                    shows the fit, SYNC RESET drops it
  */
 
-// ============================================================
-// CONFIGURATION
-// ============================================================
-#define USE_MOCK_DATA    true   // Set to false when real sensor connected
-#define EEG_PIN          34     // GPIO34 (ADC1_CH6)
-#define BUTTON_VALID     18     // GPIO18 - Valid user button
-#define BUTTON_INVALID   19     // GPIO19 - Invalid user button
-#define LED_PIN          2      // Built-in LED
+#include <Arduino.h>
 
-#define SAMPLE_RATE      250    // Hz
-#define SAMPLE_INTERVAL  4000   // microseconds (1000000 / 250)
-#define SERIAL_BAUD      115200
+#include <esp_timer.h>
 
-#define BUTTON_DEBOUNCE  50     // ms
-#define LONG_PRESS_TIME  2000   // ms for long press
+#include "acquisition.h"
+#include "adc_cal.h"
+#include "adc_scan.h"
+#include "artifact.h"
+#include "auth_session.h"
+#include "band_power.h"
+#include "bench.h"
+#include "buttons.h"
+#include "clock_sync.h"
+#include "command_parser.h"
+#include "config.h"
+#include "config_store.h"
+#include "dsp_filter.h"
+#include "mock_eeg.h"
+#include "perf.h"
+#include "power.h"
+#include "protocol.h"
+#include "recorder.h"
+#include "sampler.h"
+#include "transport.h"
+#include "tx_ring.h"
 
 // ============================================================
 // STATE
@@ -56,246 +138,1348 @@ enum MockType {
   MOCK_IMPOSTOR
 };
 
-Mode currentMode = MODE_IDLE;
-MockType mockType = MOCK_AUTHENTICATED;
-
-unsigned long sampleCount = 0;
-unsigned long startTime = 0;
-unsigned long lastSampleMicros = 0;
-
-// Button state tracking
-struct ButtonState {
-  uint8_t pin;
-  bool lastState;
-  bool currentState;
-  unsigned long pressTime;
-  unsigned long releaseTime;
-  bool longPressTriggered;
-};
+// Comms task state; the acquisition task sees it through updateMockSignal()
+volatile Mode currentMode = MODE_IDLE;
+volatile MockType mockType = MOCK_AUTHENTICATED;
+OutputFormat outputFormat = FORMAT_ASCII;
+
+unsigned long sampleCount = 0;           // Samples handed to the TX path since START
+uint32_t sampleIndexNext = 0;            // Index after the last sample drained from the sampler
+unsigned long streamStartUs = 0;
+
+TaskHandle_t commsTaskHandle = nullptr;
+
+// The acquisition task's chain (acquisition.h). Stage state belongs to
+// that task; the comms task only flips the runtime options and asks for
+// a reconfigure or reset, applied on the next tick.
+AcquisitionPipeline acquisition;
+ArtifactStage &artifactStage = acquisition.stage<ArtifactStage>();
+FilterStage &filterStage = acquisition.stage<FilterStage>();
+uint32_t artifactSamples = 0;           // Flagged samples since START (comms task)
+
+// FEATURES mode: runs in the comms task on the filtered sample stream
+BandPowerExtractor bandPower;
+ArtifactWindow featureArtifacts;
+
+// On-device authentication (comms task); authActive while one runs
+AuthSession authSession;
+bool authOnDevice = true;               // Button tests: session (ON) or stream (OFF)
+volatile bool authActive = false;
+
+// Transmit path: samples are batched into blocks, one transport send each
+TxRing txRing;
+// BLOCK and the FEATURES hop as set, in stream time: RATE derives the
+// sample counts from these, so a round trip through another rate keeps them
+uint32_t blockUs = 0;
+uint32_t featureHopUs = 0;
+SerialTransport serialLink(Serial);
+#if WIFI_ENABLED
+UdpTransport udpLink;
+#endif
+Transport *transport = &serialLink;
+
+// BAUD handshake: rates the host may ask for, and the pending switch
+static const uint32_t LINK_BAUDS[] = {115200, 230400, 460800, 921600, 2000000};
+bool baudPending = false;
+uint32_t baudFallback = SERIAL_BAUD;
+unsigned long baudDeadline = 0;
+
+// Binary frame assembly (frame, or zframe in COMPRESSED format)
+SampleFrameEncoder frame;
+CompressedFrameEncoder zframe;
+uint8_t compressOrder = 1;              // Predictor order for COMPRESSED
+bool frameOpen = false;
+bool frameFirst = true;
+uint16_t frameSeq = 0;
+uint32_t frameLastIndex = 0;
+
+// Session log of MODE_AUTH_* sessions (comms task)
+SessionRecorder recorder;
+bool recordEnabled = RECORD_ENABLED;
+
+// Persistent configuration: boot options and what setup() applied
+DeviceConfig bootConfig;
+bool configStored = false;              // bootConfig came from NVS
 
-ButtonState btnValid = {BUTTON_VALID, HIGH, HIGH, 0, 0, false};
-ButtonState btnInvalid = {BUTTON_INVALID, HIGH, HIGH, 0, 0, false};
+// Host clock sync (comms task): the fit, and the exchange whose t4 the
+// host sends with its next SYNC
+ClockSync clockSync;
+bool syncPending = false;
+uint64_t syncT1 = 0;
+int64_t syncT2 = 0;
+int64_t syncT3 = 0;
+
+// PERF: comms loop timing here, acquisition timing in samplerPerf()
+PerfHistogram loopPerf;
+uint32_t commsBusyUs = 0;
+uint32_t perfIntervalSec = 0;           // Periodic PERF telemetry, 0 = off
+unsigned long perfLastMs = 0;
+unsigned long perfWindowUs = 0;         // Start of the TX rate / idle window
+uint32_t perfTxMark = 0;
+uint32_t perfCommsMark = 0;
+uint32_t perfAcqMark = 0;
 
 // ============================================================
-// MOCK DATA GENERATION (5X SLOWER FOR VISIBILITY)
+// SAMPLE SOURCE
 // ============================================================
 
 /**
- * Generate realistic SLOW EEG for an "authenticated" user.
- * Frequencies divided by 5 for better visualization on screen.
- * Strong Alpha (2Hz visible) + moderate Beta (4Hz visible) + low noise.
+ * Point the mock source at the signal the current mode calls for: the
+ * button / MOCK_* choice, and the SVM's training signals while an
+ * on-device session classifies them. Call after any change of
+ * currentMode, mockType or authActive that a running stream should see.
  */
-float generateAuthEEG(float t) {
-  // Alpha rhythm (10Hz → 2Hz for visibility)
-  float alpha = 25.0f * sin(2.0f * PI * 2.0f * t);
-  
-  // Beta rhythm (20Hz → 4Hz for visibility)
-  float beta = 12.0f * sin(2.0f * PI * 4.0f * t);
-  
-  // Theta (6Hz → 1.2Hz for visibility)
-  float theta = 6.0f * sin(2.0f * PI * 1.2f * t);
-  
-  // Delta (2.5Hz → 0.5Hz for visibility)
-  float delta = 4.0f * sin(2.0f * PI * 0.5f * t);
-  
-  // Biological noise (low)
-  float noise = 3.0f * (random(-100, 101) / 100.0f);
-  
-  // Slow amplitude modulation (breathing artifact ~0.06Hz)
-  float modulation = 1.0f + 0.15f * sin(2.0f * PI * 0.06f * t);
-  
-  // Occasional eye blink artifact
-  float blink = 0.0f;
-  if (((int)(t * 1000)) % 5000 < 300) {  // Every 5 seconds, 300ms duration
-    float blinkT = fmod(t * 1000, 5000) / 300.0f;
-    blink = 50.0f * exp(-pow((blinkT - 0.2f), 2) / 0.02f);
+void updateMockSignal() {
+  bool auth = currentMode == MODE_AUTH_VALID ||
+              (currentMode == MODE_STREAMING && mockType == MOCK_AUTHENTICATED);
+  if (authActive) {
+    acquisition.source.setSignal(auth ? MOCK_SIGNAL_MODEL_AUTH : MOCK_SIGNAL_MODEL_IMPOSTOR);
+  } else {
+    acquisition.source.setSignal(auth ? MOCK_SIGNAL_AUTH : MOCK_SIGNAL_IMPOSTOR);
   }
-  
-  return (alpha + beta + theta + delta) * modulation + noise + blink;
 }
 
+/** The sampler's SampleSource: one tick through the acquisition pipeline. */
+uint8_t acquireSample(uint32_t index, float *values, uint8_t &artifact) {
+  return acquisition.acquire(index, values, artifact);
+}
+
+// ============================================================
+// OUTPUT
+// ============================================================
+
 /**
- * Generate SLOW noisy EEG for an "impostor" user.
- * High noise, weak/shifted alpha, muscle artifacts.
+ * Space for len bytes in the TX fill block. If the block is out of room
+ * (wide multi-channel lines) it is sent early instead of dropping data.
  */
-float generateImpostorEEG(float t) {
-  // Shifted/weak alpha (different frequency → 1.5Hz visible)
-  float alpha = 8.0f * sin(2.0f * PI * 1.5f * t + random(0, 100) / 50.0f);
-  
-  // High beta/stress (22Hz → 4.4Hz visible)
-  float beta = 15.0f * sin(2.0f * PI * 4.4f * t + random(0, 100) / 50.0f);
-  
-  // Weak theta
-  float theta = 4.0f * sin(2.0f * PI * 1.1f * t);
-  
-  // High noise
-  float noise = 12.0f * (random(-100, 101) / 100.0f);
-  float whiteNoise = 8.0f * (random(-100, 101) / 100.0f);
-  
-  // Frequent muscle artifacts (30-60Hz → 6-12Hz visible)
-  float muscle = 0.0f;
-  if (random(0, 1000) < 50) {  // 5% chance per sample
-    muscle = 30.0f * sin(2.0f * PI * 9.0f * t);  // 45Hz → 9Hz visible
+uint8_t *reserveTx(size_t len) {
+  if (txRing.room() < len) {
+    txRing.seal();
+    txRing.drainTo(*transport);
   }
-  
-  // Large random spikes (movement)
-  float spike = 0.0f;
-  if (random(0, 1000) < 10) {  // 1% chance
-    spike = 40.0f * (random(-100, 101) / 100.0f);
+  return txRing.reserve(len);   // Still no room: counted in txRing.overflows()
+}
+
+void writeTx(const uint8_t *data, size_t len) {
+  uint8_t *dst = reserveTx(len);
+  if (dst) {
+    memcpy(dst, data, len);
+    txRing.commit(len);
   }
-  
-  return alpha + beta + theta + noise + whiteNoise + muscle + spike;
 }
 
 /**
- * Read EEG from ADC (real sensor) or generate mock data
+ * Close the open binary frame and queue it in the TX block.
  */
-float readEEG() {
-  float value;
-  float timeSeconds = (millis() - startTime) / 1000.0f;
-  
-  if (USE_MOCK_DATA) {
-    // Generate appropriate mock data based on mode
-    if (currentMode == MODE_AUTH_VALID || 
-        (currentMode == MODE_STREAMING && mockType == MOCK_AUTHENTICATED)) {
-      value = generateAuthEEG(timeSeconds);
+void closeFrame() {
+  if (frameOpen) {
+    if (outputFormat == FORMAT_COMPRESSED) {
+      zframe.finish();
+      writeTx(zframe.data(), zframe.size());
     } else {
-      value = generateImpostorEEG(timeSeconds);
+      frame.finish();
+      writeTx(frame.data(), frame.size());
     }
-  } else {
-    // Real sensor: Read from ADC
-    int rawADC = analogRead(EEG_PIN);
-    // Convert to microvolts (assuming 3.3V ref, 12-bit ADC, gain = 1000x)
-    value = ((rawADC / 4095.0f) * 3.3f * 1000.0f) - 1650.0f;  // Center around 0
+    frameOpen = false;
   }
-  
-  return value;
 }
 
-// ============================================================
-// BUTTON HANDLING
-// ============================================================
+/**
+ * Send everything queued so far, including a partial block.
+ */
+void flushFrame() {
+  closeFrame();
+  txRing.seal();
+  txRing.drainTo(*transport);
+}
 
-void updateButton(ButtonState &btn) {
-  btn.currentState = digitalRead(btn.pin);
-  unsigned long now = millis();
-  
-  // Detect press (HIGH → LOW with debounce)
-  if (btn.lastState == HIGH && btn.currentState == LOW) {
-    if (now - btn.releaseTime > BUTTON_DEBOUNCE) {
-      btn.pressTime = now;
-      btn.longPressTriggered = false;
+/**
+ * Reset frame sequencing and TX blocks at the start of a stream.
+ */
+void resetFrames() {
+  frameOpen = false;
+  frameFirst = true;
+  frameSeq = 0;
+  zframe.reset();
+  txRing.reset();
+}
+
+/**
+ * time_us of sample index for a frame header: host time once synced,
+ * device time otherwise. Adds the matching FRAME_FLAG_* bits to flags.
+ */
+uint64_t frameTimeUs(uint32_t index, uint8_t &flags) {
+  int64_t deviceUs = samplerTimeUs(index);
+  flags |= FRAME_FLAG_TIMESTAMP;
+  if (!clockSync.synced()) {
+    return (uint64_t)deviceUs;
+  }
+  flags |= FRAME_FLAG_HOST_TIME;
+  return clockSync.toHost(deviceUs);
+}
+
+/**
+ * Append one sample to the current binary frame. A frame never spans
+ * two TX blocks, so it is closed at the block boundary or when full.
+ * One flagged sample marks the whole frame FRAME_FLAG_ARTIFACT.
+ */
+void encodeBinarySample(const Sample &sample) {
+  const bool compressed = outputFormat == FORMAT_COMPRESSED;
+  if (!frameOpen) {
+    uint32_t dtUs = 0;
+    if (!frameFirst) {
+      dtUs = (sample.index - frameLastIndex) * samplerPeriodUs();
+      if (dtUs > 0xFFFF) dtUs = 0xFFFF;
     }
+    uint8_t flags = (outputFormat == FORMAT_BINARY24) ? FRAME_FLAG_INT24 : 0;
+    if (filterStage.enabled) flags |= FRAME_FLAG_FILTERED;
+    uint64_t timeUs = frameTimeUs(sample.index, flags);
+    if (compressed) {
+      zframe.begin(flags, frameSeq++, dtUs, sample.channels, compressOrder, timeUs);
+    } else {
+      frame.begin(flags, frameSeq++, dtUs, sample.channels, timeUs);
+    }
+    frameLastIndex = sample.index;
+    frameFirst = false;
+    frameOpen = true;
   }
   
-  // Detect release (LOW → HIGH)
-  if (btn.lastState == LOW && btn.currentState == HIGH) {
-    btn.releaseTime = now;
+  for (uint8_t ch = 0; ch < sample.channels; ch++) {
+    if (compressed) {
+      zframe.add(sample.value[ch]);
+    } else {
+      frame.add(sample.value[ch]);
+    }
+  }
+  if (sample.artifact) {
+    if (compressed) {
+      zframe.addFlags(FRAME_FLAG_ARTIFACT);
+    } else {
+      frame.addFlags(FRAME_FLAG_ARTIFACT);
+    }
+  }
+  if ((compressed ? zframe.full() : frame.full()) ||
+      txRing.samplesInBlock() + 1 >= txRing.blockSamples()) {
+    closeFrame();
   }
-  
-  btn.lastState = btn.currentState;
 }
 
-bool isButtonPressed(ButtonState &btn) {
-  return (btn.currentState == LOW);
+/**
+ * Queue a feature frame for the window ending at sample index and send
+ * it without waiting for the block to fill (a few per second at most).
+ */
+void sendFeatures(uint32_t index, uint8_t flags) {
+  uint8_t buf[FRAME_MAX_SIZE];
+  uint32_t dtUs = frameFirst ? 0 : (uint32_t)bandPower.hop() * samplerPeriodUs();
+  if (dtUs > 0xFFFF) dtUs = 0xFFFF;
+  frameFirst = false;
+  uint64_t timeUs = frameTimeUs(index - 1, flags);
+  size_t len = encodeFeatureFrame(buf, frameSeq++, dtUs, index,
+                                  bandPower.features(), FEATURE_COUNT, flags, timeUs);
+  writeTx(buf, len);
+  txRing.seal();
 }
 
-bool isShortPress(ButtonState &btn) {
-  unsigned long now = millis();
-  if (btn.lastState == LOW && btn.currentState == HIGH) {
-    unsigned long pressDuration = btn.releaseTime - btn.pressTime;
-    if (pressDuration > BUTTON_DEBOUNCE && pressDuration < LONG_PRESS_TIME) {
-      return true;
+/**
+ * Queue a stats record (LinkStats) in the stream, in line with the
+ * samples it counts: a STATS: line in ASCII, otherwise a stats frame
+ * after the open sample frame is closed.
+ */
+void sendStats() {
+  LinkStats stats;
+  stats.index = sampleIndexNext;
+  stats.sent = sampleCount;
+  stats.overruns = samplerOverruns();
+  stats.txDrops = txRing.overflows();
+  stats.backlogPeak = samplerBacklogPeak();
+  stats.timeUs = micros() - streamStartUs;
+
+  if (outputFormat == FORMAT_ASCII) {
+    uint8_t *line = reserveTx(STATS_LINE_MAX);
+    if (line) {
+      txRing.commit(formatStatsLine((char *)line, stats));
     }
+  } else {
+    uint8_t buf[FRAME_MAX_SIZE];
+    closeFrame();
+    writeTx(buf, encodeStatsFrame(buf, frameSeq++, stats));
   }
-  return false;
 }
 
-bool isLongPress(ButtonState &btn) {
-  unsigned long now = millis();
-  if (btn.currentState == LOW && !btn.longPressTriggered) {
-    if (now - btn.pressTime > LONG_PRESS_TIME) {
-      btn.longPressTriggered = true;
-      return true;
+/**
+ * Encode one sample in the selected output format into the TX block.
+ * The block is sent by loop() once it holds BLOCK samples.
+ */
+void sendSample(const Sample &sample) {
+  if (outputFormat == FORMAT_ASCII) {
+    uint8_t *line = reserveTx(ASCII_SAMPLE_MAX(sample.channels));
+    if (line) {
+      // Sample time from the index, not millis(): exact at every rate
+      uint32_t timestamp = (uint64_t)sample.index * samplerPeriodUs() / 1000;
+      txRing.commit(formatAsciiSample((char *)line, timestamp, sample.value, sample.channels));
     }
+  } else if (outputFormat == FORMAT_FEATURES) {
+    // Features are computed on channel 0; the host drops flagged windows
+    bool clean = featureArtifacts.push(sample.artifact);
+    if (bandPower.push(sample.value[0])) {
+      sendFeatures(sample.index + 1, clean ? 0 : FRAME_FLAG_ARTIFACT);
+    }
+    return;
+  } else {
+    encodeBinarySample(sample);
+  }
+  txRing.sampleDone();
+}
+
+/**
+ * Switch output format; pending samples are sent first.
+ */
+void setOutputFormat(OutputFormat format) {
+  flushFrame();
+  if (format != outputFormat) {
+    resetFrames();
+  }
+  outputFormat = format;
+}
+
+/**
+ * Open a recorder session for the test or AUTH session about to start;
+ * a dump in progress is cut short, since the new session may overwrite it.
+ */
+void beginRecording() {
+  recorder.endSession();
+  if (recorder.dumping()) {
+    recorder.dumpAbort();
+    Serial.println();
+    Serial.println("ERROR:Dump aborted");
+  }
+  bool test = currentMode == MODE_AUTH_VALID || currentMode == MODE_AUTH_INVALID;
+  if (!test || !recordEnabled) {
+    return;
+  }
+  SessionRecord record;
+  record.session = 0;
+  record.label = currentMode == MODE_AUTH_VALID ? 1 : 0;
+  record.rate = samplerRate();
+  record.channelMask = adcChannelMask();
+  record.filtered = filterStage.enabled;
+  record.synced = clockSync.synced();
+  int64_t offset = clockSync.synced() ? clockSync.offsetUs() : 0;
+  record.hostOffsetLo = (uint32_t)offset;
+  record.hostOffsetHi = (uint32_t)((uint64_t)offset >> 32);
+  recorder.startSession(record, samplerRate() * adcChannelCount() * 3, AUTO_STOP_SEC);
+}
+
+/**
+ * Reset counters, framing and filter state and (re)start the sampler.
+ * currentMode must already be set.
+ */
+void beginStream() {
+  beginRecording();
+  sampleCount = 0;
+  sampleIndexNext = 0;
+  resetFrames();
+  bandPower.reset();
+  featureArtifacts.begin(bandPower.windowSamples());
+  artifactSamples = 0;
+  updateMockSignal();
+  acquisition.requestConfigure();   // Sampler is stopped here; applied on the first tick
+  acquisition.requestReset();
+  bool heavyDsp = filterStage.enabled || authActive || outputFormat == FORMAT_FEATURES ||
+                  outputFormat == FORMAT_COMPRESSED;
+  powerStreamStart(samplerRate() * samplerOversampling() * adcChannelCount(), heavyDsp);
+  streamStartUs = micros();
+  samplerStart();
+}
+
+/**
+ * Start an on-device session instead of a stream; currentMode must
+ * already be MODE_AUTH_VALID or MODE_AUTH_INVALID.
+ */
+bool beginAuthSession() {
+  if (!authSession.begin(samplerRate(), filterStage.notchHz, filterStage.enabled)) {
+    return false;
+  }
+  authActive = true;
+  beginStream();
+  return true;
+}
+
+/** Drop a running session (STOP, START, long press) without a decision. */
+void cancelAuthSession() {
+  if (authActive) {
+    authActive = false;
+    Serial.print("AUTH:Result=CANCELLED,Windows=");
+    Serial.println(authSession.windows());
   }
-  return false;
 }
 
 // ============================================================
 // COMMAND PROCESSING
 // ============================================================
 
-void processCommand(String cmd) {
-  cmd.trim();
-  cmd.toUpperCase();
-  
-  if (cmd == "START") {
-    currentMode = MODE_STREAMING;
-    mockType = MOCK_AUTHENTICATED;
-    sampleCount = 0;
-    startTime = millis();
-    lastSampleMicros = micros();
-    Serial.println("STATUS:Started streaming (authenticated mode)");
-    
-  } else if (cmd == "STOP") {
+void cmdStart(const char *) {
+  cancelAuthSession();
+  currentMode = MODE_STREAMING;
+  mockType = MOCK_AUTHENTICATED;
+  beginStream();
+  Serial.println("STATUS:Started streaming (authenticated mode)");
+}
+
+void cmdStop(const char *) {
+  bool streaming = currentMode != MODE_IDLE && !authActive;
+  currentMode = MODE_IDLE;
+  samplerStop();
+  recorder.endSession();
+  cancelAuthSession();
+  if (streaming) {
+    sendStats();
+  }
+  flushFrame();
+  powerStreamStop();
+  Serial.println("STATUS:Stopped");
+}
+
+void cmdMockAuth(const char *) {
+  mockType = MOCK_AUTHENTICATED;
+  updateMockSignal();
+  Serial.println("STATUS:Switched to authenticated mock data");
+}
+
+void cmdMockImp(const char *) {
+  mockType = MOCK_IMPOSTOR;
+  updateMockSignal();
+  Serial.println("STATUS:Switched to impostor mock data");
+}
+
+void cmdAscii(const char *) {
+  setOutputFormat(FORMAT_ASCII);
+  Serial.println("STATUS:Output format ASCII");
+}
+
+void cmdBinary(const char *) {
+  setOutputFormat(FORMAT_BINARY16);
+  Serial.println("STATUS:Output format BINARY");
+}
+
+void cmdBinary24(const char *) {
+  setOutputFormat(FORMAT_BINARY24);
+  Serial.println("STATUS:Output format BINARY24");
+}
+
+void cmdCompressed(const char *args) {
+  uint32_t order = 1;
+  if (*args && !parseUintArg(args, 1, 2, order)) {
+    Serial.println("ERROR:Usage COMPRESSED [1|2]");
+    return;
+  }
+  setOutputFormat(FORMAT_COMPRESSED);
+  compressOrder = order;          // Frames are closed, so takes effect on the next one
+  Serial.print("STATUS:Output format COMPRESSED, order ");
+  Serial.println(order);
+}
+
+/** Samples of stream time us at the current rate (nearest, at least 1). */
+uint32_t samplesFor(uint32_t us) {
+  uint32_t period = samplerPeriodUs();
+  uint32_t n = (us + period / 2) / period;
+  return n ? n : 1;
+}
+
+void setBlockSamples(uint32_t n) {
+  txRing.setBlockSamples(n);
+  blockUs = n * samplerPeriodUs();
+}
+
+/** False when the extractor can't run at this rate (BandPowerExtractor::supports()). */
+bool configureFeatures(uint32_t hop) {
+  if (!bandPower.configure(samplerRate(), hop)) {
+    return false;
+  }
+  featureHopUs = bandPower.hop() * samplerPeriodUs();
+  return true;
+}
+
+void cmdBlock(const char *args) {
+  uint32_t n;
+  if (!parseUintArg(args, 1, TX_BLOCK_MAX, n)) {
+    Serial.println("ERROR:Block size must be 1-100");
+    return;
+  }
+  closeFrame();
+  setBlockSamples(n);
+  txRing.drainTo(*transport);
+  Serial.print("STATUS:Block size ");
+  Serial.println(n);
+}
+
+void cmdFilter(const char *args) {
+  if (strcmp(args, "ON") == 0) {
+    acquisition.requestConfigure();   // Fresh delay lines
+    filterStage.enabled = true;
+  } else if (strcmp(args, "OFF") == 0) {
+    filterStage.enabled = false;
+  } else {
+    Serial.println("ERROR:Usage FILTER ON|OFF");
+    return;
+  }
+  Serial.print("STATUS:Filter ");
+  Serial.println(filterStage.enabled ? "ON" : "OFF");
+}
+
+void cmdNotch(const char *args) {
+  uint32_t hz;
+  if (strcmp(args, "OFF") == 0) {
+    hz = 0;
+  } else if (!parseUintArg(args, 50, 60, hz) || (hz != 50 && hz != 60)) {
+    Serial.println("ERROR:Usage NOTCH 50|60|OFF");
+    return;
+  }
+  filterStage.notchHz = hz;
+  acquisition.requestConfigure();
+  Serial.print("STATUS:Notch ");
+  if (hz) {
+    Serial.print(hz);
+    Serial.println(" Hz");
+  } else {
+    Serial.println("OFF");
+  }
+}
+
+void cmdFeatures(const char *args) {
+  uint32_t hop = FEATURE_HOP_DEFAULT;
+  if (*args && !parseUintArg(args, 1, samplerRate() * FEATURE_WINDOW_SEC, hop)) {
+    Serial.println("ERROR:Usage FEATURES [hop samples]");
+    return;
+  }
+  if (!configureFeatures(hop)) {
+    Serial.println("ERROR:FEATURES needs a rate of 250 Hz or a multiple");
+    return;
+  }
+  if (!filterStage.enabled) {
+    acquisition.requestConfigure();
+    filterStage.enabled = true;       // Features are defined on the filtered signal
+  }
+  setOutputFormat(FORMAT_FEATURES);
+  Serial.print("STATUS:Output format FEATURES, hop ");
+  Serial.println(bandPower.hop());
+}
+
+void cmdOversample(const char *args) {
+  uint32_t osr;
+  DecimFilter filter = adcDecimFilter();
+  const char *name = nextArg(args);
+  bool nameOk = true;
+  if (strcmp(name, "AVG") == 0) filter = DECIM_AVG;
+  else if (strcmp(name, "CIC") == 0) filter = DECIM_CIC;
+  else if (strcmp(name, "FIR") == 0) filter = DECIM_FIR;
+  else nameOk = (*name == '\0');           // Omitted: keep the current filter
+  if (!nameOk || !parseUintArg(args, 1, DECIM_MAX_OSR, osr) || (osr & (osr - 1))) {
+    Serial.println("ERROR:Usage OVERSAMPLE 1|2|4|8|16 [AVG|CIC|FIR]");
+    return;
+  }
+  if (currentMode != MODE_IDLE) {
+    Serial.println("ERROR:Stop streaming before changing oversampling");
+    return;
+  }
+  if (!samplerSetOversampling(osr)) {
+    Serial.println("ERROR:Rate x OVERSAMPLE above tick limit");
+    return;
+  }
+  adcSetOversampling(osr, filter);
+  Serial.print("STATUS:Oversample ");
+  Serial.print(osr);
+  Serial.print("x ");
+  Serial.println(decimFilterName(filter));
+}
+
+void cmdChannels(const char *args) {
+  uint32_t mask;
+  if (!parseUintArg(args, 1, (1u << EEG_MAX_CHANNELS) - 1, mask)) {
+    Serial.println("ERROR:Usage CHANNELS <mask> (e.g. 0x0F)");
+    return;
+  }
+  if (currentMode != MODE_IDLE) {
+    Serial.println("ERROR:Stop streaming before changing channels");
+    return;
+  }
+  adcSetChannelMask(mask);
+  Serial.print("STATUS:Channels mask=0x");
+  Serial.print(adcChannelMask(), HEX);
+  Serial.print(" count=");
+  Serial.println(adcChannelCount());
+}
+
+void cmdGain(const char *args) {
+  uint32_t ch, gain;
+  if (!parseUintArg(args, 0, EEG_MAX_CHANNELS - 1, ch) ||
+      !parseUintArg(nextArg(args), 1, 100000, gain)) {
+    Serial.println("ERROR:Usage GAIN <channel> <gain>");
+    return;
+  }
+  adcSetGain(ch, gain);
+  Serial.print("STATUS:Channel ");
+  Serial.print(ch);
+  Serial.print(" gain ");
+  Serial.println(gain);
+}
+
+/**
+ * Switch the sample rate and rescale everything defined in samples so it
+ * keeps the same duration: TX block, feature hop, filter and mock tables.
+ */
+bool applyRate(uint32_t hz) {
+  if (!samplerSetRate(hz)) {
+    return false;
+  }
+
+  // Same block and hop duration as set, not a rescale of the last rate's counts
+  if (blockUs) {
+    txRing.setBlockSamples(constrain(samplesFor(blockUs), 1, TX_BLOCK_MAX));
+  }
+  if (bandPower.rate() && featureHopUs) {
+    bandPower.configure(hz, constrain(samplesFor(featureHopUs), 1, hz * FEATURE_WINDOW_SEC));
+  }
+
+  acquisition.source.begin(hz);
+  acquisition.requestConfigure();
+  return true;
+}
+
+void cmdRate(const char *args) {
+  uint32_t hz;
+  if (!parseUintArg(args, 1, SAMPLE_RATE_MAX, hz) || !filterDesignFor(hz) ||
+      1000000 % hz != 0) {
+    Serial.println("ERROR:Usage RATE 250|500|1000|2000");
+    return;
+  }
+  if (currentMode != MODE_IDLE) {
+    Serial.println("ERROR:Stop streaming before changing rate");
+    return;
+  }
+  if (outputFormat == FORMAT_FEATURES && !BandPowerExtractor::supports(hz)) {
+    Serial.println("ERROR:FEATURES needs a rate of 250 Hz or a multiple");
+    return;
+  }
+  if (!applyRate(hz)) {
+    Serial.println("ERROR:Rate x OVERSAMPLE above tick limit");
+    return;
+  }
+  Serial.print("STATUS:Rate ");
+  Serial.print(samplerRate());
+  Serial.println(" Hz");
+}
+
+void cmdAdcCal(const char *args) {
+  if (strcmp(args, "REBUILD") == 0) {
+    if (currentMode != MODE_IDLE) {
+      Serial.println("ERROR:Stop streaming before rebuilding calibration");
+      return;
+    }
+    adcCalRebuild();
+  } else if (*args) {
+    Serial.println("ERROR:Usage ADCCAL [REBUILD]");
+    return;
+  }
+  Serial.print("STATUS:AdcCal ");
+  Serial.print(adcCalSourceName());
+  Serial.println(adcCalFromNvs() ? " (NVS)" : " (built)");
+}
+
+/**
+ * BAUD <rate>: reply "ACK:BAUD <rate>" at the current rate, switch, then
+ * wait BAUD_CONFIRM_MS for the host's "BAUD CONFIRM" at the new one. If
+ * it never arrives the old rate comes back (see handleBaudTimeout()).
+ */
+void cmdBaud(const char *args) {
+  if (strcmp(args, "CONFIRM") == 0) {
+    baudPending = false;
+    Serial.print("STATUS:Baud ");
+    Serial.println(serialLink.baud());
+    return;
+  }
+
+  uint32_t baud;
+  bool known = false;
+  if (parseUintArg(args, 1, 0xFFFFFFFF, baud)) {
+    for (uint32_t rate : LINK_BAUDS) {
+      known |= rate == baud;
+    }
+  }
+  if (!known) {
+    Serial.println("ERROR:Usage BAUD 115200|230400|460800|921600|2000000|CONFIRM");
+    return;
+  }
+  if (currentMode != MODE_IDLE) {
+    Serial.println("ERROR:Stop streaming before changing baud");
+    return;
+  }
+
+  Serial.print("ACK:BAUD ");
+  Serial.println(baud);
+  if (!baudPending) {
+    baudFallback = serialLink.baud();
+  }
+  serialLink.setBaud(baud);
+  baudPending = true;
+  baudDeadline = millis() + BAUD_CONFIRM_MS;
+}
+
+/**
+ * Send sample blocks over link from now on; pending data goes out on the
+ * old one first.
+ */
+void setTransport(Transport &link) {
+  flushFrame();
+  transport = &link;
+  txRing.setBlockBytes(link.maxBlockBytes());
+}
+
+void cmdLink(const char *args) {
+  if (strcmp(args, "SERIAL") == 0) {
+    setTransport(serialLink);
+#if WIFI_ENABLED
+  } else if (strcmp(args, "UDP") == 0) {
+    if (!udpLink.ready()) {
+      Serial.println("ERROR:Wi-Fi not connected");
+      return;
+    }
+    setTransport(udpLink);
+#endif
+  } else {
+    Serial.println(WIFI_ENABLED ? "ERROR:Usage LINK SERIAL|UDP"
+                                : "ERROR:Usage LINK SERIAL (built without WIFI_ENABLED)");
+    return;
+  }
+  Serial.print("STATUS:Link ");
+  Serial.println(transport->name());
+}
+
+void cmdStatus(const char *) {
+  Serial.print("STATUS:");
+  Serial.print("Mode=");
+  switch(currentMode) {
+    case MODE_IDLE: Serial.print("IDLE"); break;
+    case MODE_STREAMING: Serial.print("STREAMING"); break;
+    case MODE_AUTH_VALID: Serial.print("AUTH_VALID"); break;
+    case MODE_AUTH_INVALID: Serial.print("AUTH_INVALID"); break;
+  }
+  Serial.print(",MockType=");
+  Serial.print(mockType == MOCK_AUTHENTICATED ? "AUTH" : "IMP");
+  Serial.print(",Format=");
+  switch(outputFormat) {
+    case FORMAT_ASCII: Serial.print("ASCII"); break;
+    case FORMAT_BINARY16: Serial.print("BINARY"); break;
+    case FORMAT_BINARY24: Serial.print("BINARY24"); break;
+    case FORMAT_FEATURES: Serial.print("FEATURES"); break;
+    case FORMAT_COMPRESSED: Serial.print("COMPRESSED"); Serial.print(compressOrder); break;
+  }
+  Serial.print(",Rate=");
+  Serial.print(samplerRate());
+  Serial.print(",Oversample=");
+  Serial.print(samplerOversampling());
+  Serial.print("x");
+  Serial.print(decimFilterName(adcDecimFilter()));
+  Serial.print(",Block=");
+  Serial.print(txRing.blockSamples());
+  Serial.print(",Link=");
+  Serial.print(transport->name());
+  Serial.print(",Baud=");
+  Serial.print(serialLink.baud());
+#if WIFI_ENABLED
+  Serial.print(",WiFi=");
+  Serial.print(udpLink.ready() ? "UP" : "DOWN");
+  Serial.print(",Device=");
+  Serial.print(udpLink.deviceId(), HEX);
+  Serial.print(",Datagrams=");
+  Serial.print(udpLink.datagrams());
+  Serial.print(",UdpErrors=");
+  Serial.print(udpLink.sendErrors());
+#endif
+  Serial.print(",Channels=0x");
+  Serial.print(adcChannelMask(), HEX);
+  Serial.print(",AdcCal=");
+  Serial.print(adcCalSourceName());
+  Serial.print(",Filter=");
+  Serial.print(filterStage.enabled ? "ON" : "OFF");
+  Serial.print(",Notch=");
+  Serial.print(filterStage.notchHz);
+  Serial.print(",Samples=");
+  Serial.print(sampleCount);
+  Serial.print(",Overruns=");
+  Serial.print(samplerOverruns());
+  Serial.print(",TxDrops=");
+  Serial.print(txRing.overflows());
+  Serial.print(",Backlog=");
+  Serial.print(samplerBacklogPeak());
+  Serial.print(",Power=");
+  Serial.print(powerPolicyName());
+  Serial.print(",Cpu=");
+  Serial.print(powerCpuMhz());
+  Serial.print("MHz");
+  Serial.print(",Auth=");
+  Serial.print(authOnDevice ? "ON" : "OFF");
+  Serial.print(",Model=");
+  Serial.print(authModelVersion());
+  Serial.print(",Artifact=");
+  Serial.print(artifactStage.enabled ? "ON" : "OFF");
+  Serial.print(",ArtifactSamples=");
+  Serial.print(artifactSamples);
+  Serial.print(",Sync=");
+  Serial.print(clockSync.synced() ? "ON" : "OFF");
+  Serial.print(",Config=");
+  Serial.print(configStored ? "NVS" : "DEFAULT");
+  Serial.print(",Record=");
+  Serial.print(recordEnabled ? recorder.mediumName() : "OFF");
+  Serial.print(",Recorded=");
+  Serial.print(recorder.bytes());
+  Serial.print(",Uptime=");
+  Serial.print(millis() / 1000);
+  Serial.println("s");
+}
+
+/**
+ * Snapshot every PERF counter. Rates and idle time cover the window since
+ * the previous report, which starts a new one.
+ */
+void buildPerfReport(PerfReport &r) {
+  const SamplerPerf &acq = samplerPerf();
+  r.loopMinUs = loopPerf.min();
+  r.loopAvgUs = loopPerf.avg();
+  r.loopP99Us = loopPerf.percentile(99);
+  r.loopMaxUs = loopPerf.max();
+  r.acqMinUs = acq.work.min();
+  r.acqAvgUs = acq.work.avg();
+  r.acqP99Us = acq.work.percentile(99);
+  r.acqMaxUs = acq.work.max();
+  r.jitterAvgUs = acq.jitter.avg();
+  r.jitterP99Us = acq.jitter.percentile(99);
+  r.jitterMaxUs = acq.jitter.max();
+  for (uint8_t b = 0; b < PERF_BUCKETS; b++) {
+    r.jitterHist[b] = acq.jitter.bucket(b);
+  }
+  r.sampleRingPeak = samplerPerfBacklogPeak();
+  r.txBlockPeak = txRing.peakBytes();
+  r.freeHeap = ESP.getFreeHeap();
+  r.minFreeHeap = ESP.getMinFreeHeap();
+
+  unsigned long now = micros();
+  uint32_t windowUs = now - perfWindowUs;
+  uint32_t tx = txRing.bytesSent();
+  uint32_t comms = commsBusyUs;
+  uint32_t acqBusy = acq.busyUs.load(std::memory_order_relaxed);
+  if (windowUs == 0) windowUs = 1;
+  r.txBytesPerSec = (uint64_t)(tx - perfTxMark) * 1000000 / windowUs;
+  uint32_t busy0 = (uint64_t)(comms - perfCommsMark) * 1000 / windowUs;
+  uint32_t busy1 = (uint64_t)(acqBusy - perfAcqMark) * 1000 / windowUs;
+  r.idle0 = busy0 < 1000 ? 1000 - busy0 : 0;
+  r.idle1 = busy1 < 1000 ? 1000 - busy1 : 0;
+  perfWindowUs = now;
+  perfTxMark = tx;
+  perfCommsMark = comms;
+  perfAcqMark = acqBusy;
+}
+
+static void printTimings(const char *name, uint32_t lo, uint32_t avg, uint32_t p99, uint32_t hi) {
+  Serial.print(name);
+  Serial.print(lo);
+  Serial.print('/');
+  Serial.print(avg);
+  Serial.print('/');
+  Serial.print(p99);
+  Serial.print('/');
+  Serial.print(hi);
+}
+
+static void printPermille(const char *name, uint32_t v) {
+  Serial.print(name);
+  Serial.print(v / 10);
+  Serial.print('.');
+  Serial.print(v % 10);
+  Serial.print('%');
+}
+
+/** One "PERF:..." line; timings are min/avg/p99/max microseconds. */
+void printPerf(const PerfReport &r) {
+  printTimings("PERF:Loop=", r.loopMinUs, r.loopAvgUs, r.loopP99Us, r.loopMaxUs);
+  printTimings(",Acq=", r.acqMinUs, r.acqAvgUs, r.acqP99Us, r.acqMaxUs);
+  Serial.print(",Jitter=");
+  Serial.print(r.jitterAvgUs);
+  Serial.print('/');
+  Serial.print(r.jitterP99Us);
+  Serial.print('/');
+  Serial.print(r.jitterMaxUs);
+  Serial.print(",JitterHist=");
+  for (uint8_t b = 0; b < PERF_BUCKETS; b++) {
+    if (b) Serial.print('/');
+    Serial.print(r.jitterHist[b]);
+  }
+  Serial.print(",TxBps=");
+  Serial.print(r.txBytesPerSec);
+  Serial.print(",SampleRing=");
+  Serial.print(r.sampleRingPeak);
+  Serial.print('/');
+  Serial.print(SAMPLE_RING_SIZE);
+  Serial.print(",TxBlock=");
+  Serial.print(r.txBlockPeak);
+  Serial.print('/');
+  Serial.print(txRing.blockBytes());
+  Serial.print(",Heap=");
+  Serial.print(r.freeHeap);
+  Serial.print('/');
+  Serial.print(r.minFreeHeap);
+  printPermille(",Idle0=", r.idle0);
+  printPermille(",Idle1=", r.idle1);
+  Serial.println();
+}
+
+/**
+ * Periodic PERF telemetry: a PERF frame in the sample stream (binary
+ * formats) or a PERF: line on Serial (ASCII).
+ */
+void handlePerfTelemetry() {
+  if (!perfIntervalSec || millis() - perfLastMs < perfIntervalSec * 1000UL) {
+    return;
+  }
+  perfLastMs = millis();
+  PerfReport report;
+  buildPerfReport(report);
+  if (outputFormat == FORMAT_ASCII) {
+    printPerf(report);
+    return;
+  }
+  uint8_t buf[FRAME_MAX_SIZE];
+  closeFrame();                 // Keep frame seq in stream order
+  writeTx(buf, encodePerfFrame(buf, frameSeq++, report));
+  txRing.seal();
+}
+
+void cmdPerf(const char *args) {
+  uint32_t sec;
+  if (strcmp(args, "RESET") == 0) {
+    loopPerf.reset();
+    samplerPerfReset();
+    txRing.clearPeak();
+    Serial.println("STATUS:Perf counters reset");
+    return;
+  }
+  if (*args) {
+    if (!parseUintArg(args, 0, 3600, sec)) {
+      Serial.println("ERROR:Usage PERF [RESET|<seconds>]");
+      return;
+    }
+    perfIntervalSec = sec;
+    perfLastMs = millis();
+    Serial.print("STATUS:Perf telemetry every ");
+    Serial.print(sec);
+    Serial.println(" s");
+    return;
+  }
+  PerfReport report;
+  buildPerfReport(report);
+  printPerf(report);
+}
+
+void cmdBench(const char *args) {
+  uint32_t calls = BENCH_DEFAULT_CALLS;
+  const char *name = args;
+  if (*args >= '0' && *args <= '9') {
+    if (!parseUintArg(args, 1, BENCH_MAX_CALLS, calls)) {
+      Serial.println("ERROR:Usage BENCH [calls] [kernel]");
+      return;
+    }
+    name = nextArg(args);
+  }
+  if (currentMode != MODE_IDLE) {
+    Serial.println("ERROR:Stop streaming before running BENCH");
+    return;
+  }
+  unsigned long start = millis();
+  powerBoost(true);             // Cycle counts at the full clock, whatever the policy
+  int ran = benchRun(Serial, calls, name);
+  powerBoost(false);
+  if (ran < 0) {
+    Serial.println("ERROR:Not enough heap for BENCH");
+  } else if (ran == 0) {
+    Serial.println("ERROR:Unknown BENCH kernel");
+  } else {
+    Serial.print("STATUS:Bench done, ");
+    Serial.print(ran);
+    Serial.print(" kernels in ");
+    Serial.print(millis() - start);
+    Serial.println(" ms");
+  }
+}
+
+void cmdPower(const char *args) {
+  if (strcmp(args, "ECO") == 0 || strcmp(args, "MAX") == 0) {
+    powerSetPolicy(strcmp(args, "MAX") == 0 ? POWER_MAX : POWER_ECO);
+    if (currentMode == MODE_IDLE) {
+      powerStreamStop();        // Idle clock of the new policy now; a stream picks up at START
+    }
+  } else if (*args) {
+    Serial.println("ERROR:Usage POWER [ECO|MAX]");
+    return;
+  }
+  Serial.print("STATUS:Power=");
+  Serial.print(powerPolicyName());
+  Serial.print(",Cpu=");
+  Serial.print(powerCpuMhz());
+  Serial.print("MHz,Sleeps=");
+  Serial.print(powerSleepCount());
+  Serial.print(",SleptMs=");
+  Serial.println(powerSleptMs());
+}
+
+void cmdAuth(const char *args) {
+  if (strcmp(args, "ON") == 0 || strcmp(args, "OFF") == 0) {
+    authOnDevice = strcmp(args, "ON") == 0;
+    Serial.print("STATUS:Auth on device ");
+    Serial.println(authOnDevice ? "ON" : "OFF");
+    return;
+  }
+  if (*args) {
+    Serial.println("ERROR:Usage AUTH [ON|OFF]");
+    return;
+  }
+  if (currentMode != MODE_IDLE) {
+    Serial.println("ERROR:Stop streaming before AUTH");
+    return;
+  }
+  currentMode = mockType == MOCK_AUTHENTICATED ? MODE_AUTH_VALID : MODE_AUTH_INVALID;
+  if (!beginAuthSession()) {
     currentMode = MODE_IDLE;
-    Serial.println("STATUS:Stopped");
-    
-  } else if (cmd == "MOCK_AUTH") {
-    mockType = MOCK_AUTHENTICATED;
-    Serial.println("STATUS:Switched to authenticated mock data");
-    
-  } else if (cmd == "MOCK_IMP") {
-    mockType = MOCK_IMPOSTOR;
-    Serial.println("STATUS:Switched to impostor mock data");
-    
-  } else if (cmd == "STATUS") {
-    Serial.print("STATUS:");
-    Serial.print("Mode=");
-    switch(currentMode) {
-      case MODE_IDLE: Serial.print("IDLE"); break;
-      case MODE_STREAMING: Serial.print("STREAMING"); break;
-      case MODE_AUTH_VALID: Serial.print("AUTH_VALID"); break;
-      case MODE_AUTH_INVALID: Serial.print("AUTH_INVALID"); break;
+    Serial.println("ERROR:No feature window at this rate");
+    return;
+  }
+  Serial.println("STATUS:Auth session started");
+  digitalWrite(LED_PIN, HIGH);
+}
+
+void cmdArtifact(const char *args) {
+  if (strcmp(args, "ON") == 0) {
+    if (!artifactStage.enabled) {
+      acquisition.requestConfigure(); // Detectors restart from the next sample
     }
-    Serial.print(",MockType=");
-    Serial.print(mockType == MOCK_AUTHENTICATED ? "AUTH" : "IMP");
-    Serial.print(",Samples=");
-    Serial.print(sampleCount);
-    Serial.print(",Uptime=");
-    Serial.print(millis() / 1000);
-    Serial.println("s");
-    
+    artifactStage.enabled = true;
+  } else if (strcmp(args, "OFF") == 0) {
+    artifactStage.enabled = false;
   } else {
-    Serial.println("ERROR:Unknown command");
+    Serial.println("ERROR:Usage ARTIFACT ON|OFF");
+    return;
   }
+  Serial.print("STATUS:Artifact detection ");
+  Serial.println(artifactStage.enabled ? "ON" : "OFF");
 }
 
+void cmdRecord(const char *args) {
+  if (strcmp(args, "ON") == 0 || strcmp(args, "OFF") == 0) {
+    recordEnabled = strcmp(args, "ON") == 0;
+  } else if (strcmp(args, "CLEAR") == 0) {
+    if (recorder.recording()) {
+      Serial.println("ERROR:Stop the test before RECORD CLEAR");
+      return;
+    }
+    recorder.clear();
+  } else if (*args) {
+    Serial.println("ERROR:Usage RECORD [ON|OFF|CLEAR]");
+    return;
+  }
+  Serial.print("STATUS:Record=");
+  Serial.print(recordEnabled ? "ON" : "OFF");
+  Serial.print(",Storage=");
+  Serial.print(recorder.mediumName());
+  Serial.print(",Bytes=");
+  Serial.print(recorder.bytes());
+  Serial.print(",Capacity=");
+  Serial.print(recorder.capacity());
+  Serial.print(",Sessions=");
+  Serial.println(recorder.sessions());
+}
+
+void cmdDump(const char *) {
+  if (currentMode != MODE_IDLE) {
+    Serial.println("ERROR:Stop streaming before DUMP");
+    return;
+  }
+  if (recorder.medium() == RECORD_NONE) {
+    Serial.println("ERROR:No recorder storage");
+    return;
+  }
+  Serial.print("STATUS:Dump,Bytes=");
+  Serial.print(recorder.dumpBegin());
+  Serial.print(",Sessions=");
+  Serial.println(recorder.sessions());
+  if (!recorder.dumping()) {
+    Serial.println("STATUS:Dump done");
+  }
+}
+
+/** ",Offset=...,Rtt=...,Drift=...,Exchanges=..." of the current fit. */
+void printSyncFit() {
+  Serial.print(",Offset=");
+  Serial.print(clockSync.offsetUs());
+  Serial.print(",Rtt=");
+  Serial.print(clockSync.rttUs());
+  Serial.print(",Drift=");
+  Serial.print(clockSync.driftPpm(), 3);
+  Serial.print(",Exchanges=");
+  Serial.print(clockSync.exchanges());
+}
+
+/**
+ * One NTP-style exchange. t2 is taken on entry and t3 right before the
+ * reply, so parsing stays out of the round trip; the reply is the only
+ * output, so the host can subtract its transmit time from t4.
+ */
+void cmdSync(const char *args) {
+  int64_t t2 = esp_timer_get_time();
+  if (strcmp(args, "RESET") == 0) {
+    clockSync.reset();
+    syncPending = false;
+    Serial.println("STATUS:Clock sync reset");
+    return;
+  }
+  if (*args == '\0') {
+    Serial.print("STATUS:Sync=");
+    Serial.print(clockSync.synced() ? "ON" : "OFF");
+    if (clockSync.synced()) {
+      printSyncFit();
+    }
+    Serial.println();
+    return;
+  }
+  uint64_t t1, t4;
+  const char *t4Arg = nextArg(args);
+  if (!parseUint64Arg(args, t1) || (*t4Arg && !parseUint64Arg(t4Arg, t4))) {
+    Serial.println("ERROR:Usage SYNC [<t1_us> [<t4_us>]|RESET]");
+    return;
+  }
+  bool added = false;
+  if (*t4Arg && syncPending) {
+    added = clockSync.add(syncT1, syncT2, syncT3, t4);
+  }
+
+  syncT1 = t1;
+  syncT2 = t2;
+  syncPending = true;
+  syncT3 = esp_timer_get_time();
+  Serial.print("SYNC:T1=");
+  Serial.print(t1);
+  Serial.print(",T2=");
+  Serial.print(t2);
+  Serial.print(",T3=");
+  Serial.print(syncT3);
+  if (added) {
+    printSyncFit();
+  }
+  Serial.println();
+}
+
+/** The running configuration, with bootConfig's boot options. */
+void captureConfig(DeviceConfig &cfg) {
+  cfg = bootConfig;
+  cfg.version = CONFIG_VERSION;
+  cfg.rate = samplerRate();
+  cfg.oversample = samplerOversampling();
+  cfg.decimFilter = adcDecimFilter();
+  cfg.channelMask = adcChannelMask();
+  cfg.format = outputFormat;
+  cfg.compressOrder = compressOrder;
+  cfg.blockSamples = txRing.blockSamples();
+  cfg.featureHop = bandPower.hop();
+  cfg.filter = filterStage.enabled;
+  cfg.notchHz = filterStage.notchHz;
+  cfg.artifact = artifactStage.enabled;
+  cfg.mock = mockType == MOCK_IMPOSTOR;
+  cfg.baud = baudPending ? baudFallback : serialLink.baud();
+  for (uint8_t ch = 0; ch < EEG_MAX_CHANNELS; ch++) {
+    cfg.gain[ch] = (uint32_t)adcChannelConfig(ch).gain;
+  }
+}
+
+/** Every field within what its own command accepts. */
+bool configValid(const DeviceConfig &cfg) {
+  bool baudOk = false;
+  for (uint32_t rate : LINK_BAUDS) {
+    baudOk |= rate == cfg.baud;
+  }
+  bool gainOk = true;
+  for (uint8_t ch = 0; ch < EEG_MAX_CHANNELS; ch++) {
+    gainOk &= cfg.gain[ch] >= 1 && cfg.gain[ch] <= 100000;
+  }
+  uint32_t tick = cfg.rate * cfg.oversample;
+  return cfg.version == CONFIG_VERSION && baudOk && gainOk &&
+         cfg.rate >= 1 && cfg.rate <= SAMPLE_RATE_MAX && filterDesignFor(cfg.rate) &&
+         cfg.oversample >= 1 && cfg.oversample <= DECIM_MAX_OSR &&
+         (cfg.oversample & (cfg.oversample - 1)) == 0 &&
+         tick <= SAMPLER_TICK_MAX && 1000000 % tick == 0 &&
+         cfg.decimFilter <= DECIM_FIR &&
+         cfg.channelMask >= 1 && cfg.channelMask < (1u << EEG_MAX_CHANNELS) &&
+         cfg.format <= FORMAT_COMPRESSED &&
+         (cfg.compressOrder == 1 || cfg.compressOrder == 2) &&
+         cfg.blockSamples >= 1 && cfg.blockSamples <= TX_BLOCK_MAX &&
+         cfg.featureHop >= 1 && cfg.featureHop <= cfg.rate * FEATURE_WINDOW_SEC &&
+         (cfg.format != FORMAT_FEATURES || BandPowerExtractor::supports(cfg.rate)) &&
+         cfg.filter <= 1 && (cfg.notchHz == 0 || cfg.notchHz == 50 || cfg.notchHz == 60) &&
+         cfg.artifact <= 1 && cfg.mock <= 1 && cfg.autostart <= 1 && cfg.quietBoot <= 1;
+}
+
+/**
+ * Run a configuration that passed configValid(); idle only. The baud is
+ * the boot rate - a live switch still goes through the BAUD handshake.
+ */
+bool applyConfig(const DeviceConfig &cfg) {
+  if (!samplerSetOversampling(1) || !applyRate(cfg.rate) ||
+      !samplerSetOversampling(cfg.oversample)) {
+    return false;
+  }
+  adcSetOversampling(cfg.oversample, (DecimFilter)cfg.decimFilter);
+  adcSetChannelMask(cfg.channelMask);
+  for (uint8_t ch = 0; ch < EEG_MAX_CHANNELS; ch++) {
+    adcSetGain(ch, cfg.gain[ch]);
+  }
+  setBlockSamples(cfg.blockSamples);          // After applyRate(), which rescales it
+  if (cfg.format == FORMAT_FEATURES && !configureFeatures(cfg.featureHop)) {
+    return false;
+  }
+  compressOrder = cfg.compressOrder;
+  setOutputFormat((OutputFormat)cfg.format);
+  filterStage.enabled = cfg.filter || cfg.format == FORMAT_FEATURES;
+  filterStage.notchHz = cfg.notchHz;
+  artifactStage.enabled = cfg.artifact;
+  mockType = cfg.mock ? MOCK_IMPOSTOR : MOCK_AUTHENTICATED;
+  acquisition.requestConfigure();
+  return true;
+}
+
+/**
+ * CONFIG frame on Serial: a reply on the command link, outside the
+ * stream's frame seq (seq 0).
+ */
+void sendConfigFrame(const DeviceConfig &cfg) {
+  uint8_t buf[FRAME_MAX_SIZE];
+  Serial.write(buf, encodeConfigFrame(buf, 0, cfg));
+}
+
+/** Store cfg for the next boot; reports like CONFIG SAVE. */
+void saveConfig(const DeviceConfig &cfg) {
+  if (!configSave(cfg)) {
+    Serial.println("ERROR:Config not saved (NVS)");
+    return;
+  }
+  bootConfig = cfg;
+  configStored = true;
+  Serial.print("STATUS:Config saved,Autostart=");
+  Serial.print(cfg.autostart ? "ON" : "OFF");
+  Serial.print(",Quiet=");
+  Serial.println(cfg.quietBoot ? "ON" : "OFF");
+}
+
+void cmdConfig(const char *args) {
+  DeviceConfig cfg;
+  if (*args == '\0') {
+    captureConfig(cfg);
+    sendConfigFrame(cfg);
+    return;
+  }
+  if (strcmp(args, "ERASE") == 0) {
+    configErase();
+    configStored = false;
+    Serial.println("STATUS:Config erased, defaults from the next boot");
+    return;
+  }
+  const char *value = nextArg(args);
+  bool on = strcmp(value, "ON") == 0;
+  bool onOff = on || strcmp(value, "OFF") == 0;
+  if (strncmp(args, "AUTOSTART ", 10) == 0 && onOff) {
+    bootConfig.autostart = on;
+  } else if (strncmp(args, "QUIET ", 6) == 0 && onOff) {
+    bootConfig.quietBoot = on;
+  } else if (strcmp(args, "SAVE") != 0) {
+    Serial.println("ERROR:Usage CONFIG [SAVE|ERASE|AUTOSTART ON|OFF|QUIET ON|OFF]");
+    return;
+  }
+  captureConfig(cfg);
+  saveConfig(cfg);
+}
+
+/**
+ * A CONFIG frame from the host: apply the whole configuration, store it
+ * and answer with the configuration now running.
+ */
+void handleConfigFrame(const uint8_t *data, size_t len) {
+  DeviceConfig cfg;
+  if (!decodeConfigFrame(data, len, cfg)) {
+    Serial.println("ERROR:Bad CONFIG frame");
+    return;
+  }
+  if (!configValid(cfg)) {
+    Serial.println("ERROR:CONFIG field out of range");
+    return;
+  }
+  if (currentMode != MODE_IDLE) {
+    Serial.println("ERROR:Stop streaming before CONFIG");
+    return;
+  }
+  DeviceConfig running;
+  captureConfig(running);
+  if (!applyConfig(cfg)) {
+    applyConfig(running);       // Not half of cfg: nothing is captured or saved
+    Serial.println("ERROR:CONFIG not applied, running config kept");
+    return;
+  }
+  uint32_t bootBaud = cfg.baud;
+  bootConfig.autostart = cfg.autostart;
+  bootConfig.quietBoot = cfg.quietBoot;
+  captureConfig(cfg);
+  cfg.baud = bootBaud;          // From the next boot; the link stays at its rate
+  saveConfig(cfg);
+  sendConfigFrame(cfg);
+}
+
+static const CommandEntry COMMANDS[] = {
+  {"START",     cmdStart},
+  {"STOP",      cmdStop},
+  {"MOCK_AUTH", cmdMockAuth},
+  {"MOCK_IMP",  cmdMockImp},
+  {"ASCII",     cmdAscii},
+  {"BINARY",    cmdBinary},
+  {"BINARY24",  cmdBinary24},
+  {"COMPRESSED", cmdCompressed},
+  {"BLOCK",     cmdBlock},
+  {"FILTER",    cmdFilter},
+  {"NOTCH",     cmdNotch},
+  {"FEATURES",  cmdFeatures},
+  {"RATE",      cmdRate},
+  {"OVERSAMPLE", cmdOversample},
+  {"CHANNELS",  cmdChannels},
+  {"GAIN",      cmdGain},
+  {"ADCCAL",    cmdAdcCal},
+  {"BAUD",      cmdBaud},
+  {"LINK",      cmdLink},
+  {"PERF",      cmdPerf},
+  {"BENCH",     cmdBench},
+  {"POWER",     cmdPower},
+  {"AUTH",      cmdAuth},
+  {"ARTIFACT",  cmdArtifact},
+  {"SYNC",      cmdSync},
+  {"CONFIG",    cmdConfig},
+  {"RECORD",    cmdRecord},
+  {"DUMP",      cmdDump},
+  {"STATUS",    cmdStatus},
+};
+
+CommandParser commandParser(COMMANDS);
+
 // ============================================================
 // SETUP
 // ============================================================
 
-void setup() {
-  Serial.begin(SERIAL_BAUD);
-  while (!Serial) { delay(10); }
-  
-  // Configure pins
-  pinMode(EEG_PIN, INPUT);
-  pinMode(BUTTON_VALID, INPUT_PULLUP);
-  pinMode(BUTTON_INVALID, INPUT_PULLUP);
-  pinMode(LED_PIN, OUTPUT);
-  
-  // Configure ADC
-  analogReadResolution(12);
-  analogSetAttenuation(ADC_11db);  // 0-3.3V range
-  
-  // Seed random number generator
-  randomSeed(analogRead(0) + analogRead(EEG_PIN));
-  
-  delay(500);
-  
-  // Startup banner
+void commsTask(void *);
+
+/** Startup banner (skipped by a quiet boot). */
+void printBanner() {
   Serial.println("\n========================================");
   Serial.println("  CortexKey ESP32 Authentication v2.0");
   Serial.println("  with Button-Triggered Testing");
@@ -307,9 +1491,17 @@ void setup() {
   Serial.println("");
   Serial.print("Mock Mode: ");
   Serial.println(USE_MOCK_DATA ? "ENABLED" : "DISABLED");
+  Serial.print("ADC Calibration: ");
+  Serial.print(adcCalSourceName());
+  Serial.println(adcCalFromNvs() ? " (NVS)" : " (built)");
   Serial.print("Sample Rate: ");
-  Serial.print(SAMPLE_RATE);
+  Serial.print(samplerRate());
   Serial.println(" Hz");
+  Serial.print("Recorder: ");
+  Serial.print(recorder.mediumName());
+  Serial.print(", ");
+  Serial.print(recorder.sessions());
+  Serial.println(" sessions");
   Serial.println("");
   Serial.println("Button Controls:");
   Serial.println("  Press GPIO18 → Start VALID user test");
@@ -318,108 +1510,346 @@ void setup() {
   Serial.println("");
   Serial.println("Serial Commands:");
   Serial.println("  START, STOP, MOCK_AUTH, MOCK_IMP, STATUS");
+  Serial.println("  ASCII, BINARY, BINARY24, COMPRESSED [1|2], BLOCK <n>");
+  Serial.println("  FILTER ON|OFF, NOTCH 50|60|OFF, FEATURES [hop]");
+  Serial.println("  RATE <hz>, OVERSAMPLE <n> [AVG|CIC|FIR], BAUD <rate>|CONFIRM");
+  Serial.println("  LINK SERIAL|UDP, PERF [RESET|<s>], BENCH [n] [name], POWER [ECO|MAX]");
+  Serial.println("  AUTH [ON|OFF], ARTIFACT ON|OFF, SYNC [<t1> [<t4>]|RESET]");
+  Serial.println("  CONFIG [SAVE|ERASE|AUTOSTART ON|OFF|QUIET ON|OFF]");
+  Serial.println("  RECORD [ON|OFF|CLEAR], DUMP");
+  Serial.println("  CHANNELS <mask>, GAIN <ch> <gain>, ADCCAL [REBUILD]");
   Serial.println("========================================");
   Serial.println("CORTEXKEY_READY");
   Serial.println("");
-  
-  digitalWrite(LED_PIN, LOW);
 }
 
-// ============================================================
-// MAIN LOOP
-// ============================================================
+void setup() {
+  // Stored configuration first: it picks the UART rate and the boot path
+  configStored = configLoad(bootConfig) && configValid(bootConfig);
+  if (!configStored) {
+    configDefaults(bootConfig);
+  }
+  const bool quiet = bootConfig.quietBoot;
+  Serial.begin(bootConfig.baud);
+  serialLink.setBaud(bootConfig.baud);
+  baudFallback = bootConfig.baud;
+  if (!quiet) {
+    while (!Serial) { delay(10); }
+  }
+  commandParser.setFrameHandler(handleConfigFrame);
+  recorder.begin();
+  
+  // Configure pins; buttons are edge interrupts from here on
+  buttonsBegin();
+  pinMode(LED_PIN, OUTPUT);
+  
+  // Configure ADC (12-bit, 0-3.3V on every ADC1 channel in the table)
+  analogReadResolution(12);
+  analogSetAttenuation(ADC_11db);
+  adcScanBegin();
 
-void loop() {
-  unsigned long currentMicros = micros();
+#if WIFI_ENABLED
+  // Joins in the background; LINK UDP once STATUS shows WiFi=UP
+  udpLink.begin();
+#endif
+  
+  // Seed random number generator
+  randomSeed(analogRead(0) + analogRead(EEG_PIN));
+  
+  // Mock synthesizer tables (LUTs built once, no libm per sample)
+  mockTablesInit();
+  acquisition.source.begin(SAMPLE_RATE);
   
-  // Update button states
-  updateButton(btnValid);
-  updateButton(btnInvalid);
+  // Cycle counter -> microseconds for PERF
+  perfBegin();
   
-  // ===== Button Event Handling =====
+  // Hardware-timed acquisition on SAMPLER_CORE (idle until samplerStart())
+  samplerBegin(acquireSample);
   
-  // GPIO18: Valid User Button (short press)
-  if (isShortPress(btnValid)) {
-    if (currentMode == MODE_IDLE || currentMode == MODE_STREAMING) {
-      currentMode = MODE_AUTH_VALID;
-      mockType = MOCK_AUTHENTICATED;
-      sampleCount = 0;
-      startTime = millis();
-      lastSampleMicros = currentMicros;
-      Serial.println("\n========== VALID USER TEST STARTED ==========");
-      Serial.println("STATUS:Button 18 pressed - Starting valid user authentication");
-      digitalWrite(LED_PIN, HIGH);  // LED on during test
+  if (!applyConfig(bootConfig)) {
+    // Passed configValid() but not the sampler: boot on defaults, at the UART rate already set
+    uint32_t baud = bootConfig.baud;
+    configDefaults(bootConfig);
+    bootConfig.baud = baud;
+    applyConfig(bootConfig);
+    if (!quiet) {
+      Serial.println("ERROR:Stored config not applied, running defaults");
     }
   }
   
-  // GPIO19: Invalid User Button (short press)
-  if (isShortPress(btnInvalid)) {
-    if (currentMode == MODE_IDLE || currentMode == MODE_STREAMING) {
-      currentMode = MODE_AUTH_INVALID;
-      mockType = MOCK_IMPOSTOR;
-      sampleCount = 0;
-      startTime = millis();
-      lastSampleMicros = currentMicros;
-      Serial.println("\n========== INVALID USER TEST STARTED ==========");
-      Serial.println("STATUS:Button 19 pressed - Starting invalid user authentication");
-      digitalWrite(LED_PIN, HIGH);  // LED on during test
-    }
+  if (quiet) {
+    Serial.println("CORTEXKEY_READY");    // The one line a quiet boot prints
+  } else {
+    delay(500);
+    printBanner();
   }
   
-  // Long press either button: Stop
-  if (isLongPress(btnValid) || isLongPress(btnInvalid)) {
-    if (currentMode != MODE_IDLE) {
+  if (BENCH_AT_BOOT) {
+    // pio run -e esp32dev-bench: one full suite before anything else runs
+    benchRun(Serial, BENCH_DEFAULT_CALLS, "");
+    Serial.println("STATUS:Bench done");
+  }
+  
+  digitalWrite(LED_PIN, LOW);
+  
+  // Idle clock (and light sleep) until a stream starts
+  powerBegin();
+  
+  // Everything else runs in the comms task; woken per sample by the sampler
+  xTaskCreatePinnedToCore(commsTask, "comms", COMMS_TASK_STACK, nullptr,
+                          COMMS_TASK_PRIORITY, &commsTaskHandle, COMMS_CORE);
+  samplerSetConsumer(commsTaskHandle);
+  buttonsSetConsumer(commsTaskHandle);
+  
+  if (bootConfig.autostart) {
+    // Stream in the stored configuration without waiting for the host
+    currentMode = MODE_STREAMING;
+    beginStream();
+    Serial.println("STATUS:Started streaming (autostart)");
+  }
+}
+
+// ============================================================
+// COMMS TASK
+// ============================================================
+
+/**
+ * Where sample 0 falls relative to the press: the host can place the
+ * session start mark from the ISR edge time rather than from sample 0.
+ */
+void printPressMark(const ButtonEvent &ev) {
+  Serial.print("STATUS:PressMarkUs=-");
+  Serial.println((uint32_t)(streamStartUs - ev.pressUs));
+}
+
+void startButtonTest(const ButtonEvent &ev) {
+  if (currentMode != MODE_IDLE && currentMode != MODE_STREAMING) {
+    return;
+  }
+  bool valid = ev.pin == BUTTON_VALID;
+  currentMode = valid ? MODE_AUTH_VALID : MODE_AUTH_INVALID;
+  mockType = valid ? MOCK_AUTHENTICATED : MOCK_IMPOSTOR;
+  bool onDevice = authOnDevice && beginAuthSession();
+  if (!onDevice) {
+    beginStream();
+  }
+  if (valid) {
+    Serial.println("\n========== VALID USER TEST STARTED ==========");
+    Serial.println("STATUS:Button 18 pressed - Starting valid user authentication");
+  } else {
+    Serial.println("\n========== INVALID USER TEST STARTED ==========");
+    Serial.println("STATUS:Button 19 pressed - Starting invalid user authentication");
+  }
+  if (!onDevice) {
+    printPressMark(ev);         // Only a stream has a sample 0 for the host to place
+  }
+  digitalWrite(LED_PIN, HIGH);  // LED on during test
+}
+
+void handleButtons() {
+  // Events are queued by buttons.cpp; usually there are none
+  ButtonEvent ev;
+  while (buttonsRead(ev)) {
+    powerActivity();
+    if (ev.type == BUTTON_SHORT_PRESS) {
+      // GPIO18: valid user test, GPIO19: invalid user test
+      startButtonTest(ev);
+    } else if (currentMode != MODE_IDLE) {
+      // Long press either button: Stop
       currentMode = MODE_IDLE;
+      samplerStop();
+      recorder.endSession();
+      if (!authActive) {
+        sendStats();
+      }
+      cancelAuthSession();
+      flushFrame();
+      powerStreamStop();
       Serial.println("\n========== TEST STOPPED ==========");
       Serial.println("STATUS:Long press detected - Returned to idle");
       digitalWrite(LED_PIN, LOW);  // LED off
     }
   }
-  
-  // ===== Serial Command Processing =====
-  if (Serial.available()) {
-    String command = Serial.readStringUntil('\n');
-    processCommand(command);
+}
+
+void handleSerialInput() {
+  // Only consumes bytes already received; a partial line waits for more.
+  // During a DUMP replies would land in the binary burst: they wait.
+  if (Serial.available() > 0 && !recorder.dumping()) {
+    powerActivity();
+    commandParser.poll(Serial);
   }
-  
-  // ===== EEG Sampling =====
-  if (currentMode != MODE_IDLE) {
-    // Check if it's time for next sample (250 Hz = 4000 µs interval)
-    if (currentMicros - lastSampleMicros >= SAMPLE_INTERVAL) {
-      lastSampleMicros += SAMPLE_INTERVAL;
-      
-      // Read EEG sample
-      float eegValue = readEEG();
-      
-      // Send data over serial
-      unsigned long timestamp = millis() - startTime;
-      Serial.print("DATA,");
-      Serial.print(timestamp);
-      Serial.print(",");
-      Serial.println(eegValue, 3);  // 3 decimal places
-      
-      sampleCount++;
-      
-      // Blink LED to show activity
-      if (sampleCount % 250 == 0) {  // Every second
-        digitalWrite(LED_PIN, !digitalRead(LED_PIN));
+}
+
+void handleBaudTimeout() {
+  // Host never confirmed the new rate: go back so it can still reach us
+  if (baudPending && (long)(millis() - baudDeadline) >= 0) {
+    baudPending = false;
+    serialLink.setBaud(baudFallback);
+    Serial.print("STATUS:Baud reverted to ");
+    Serial.println(baudFallback);
+  }
+}
+
+/**
+ * DUMP in progress: write the next RECORD_DUMP_SLICE bytes. Serial.write()
+ * blocks once the UART buffer is full, so this paces itself at the baud.
+ */
+void handleDump() {
+  if (!recorder.dumping()) {
+    return;
+  }
+  powerActivity();
+  uint8_t buf[RECORD_PAGE_BYTES];
+  for (size_t sent = 0; sent < RECORD_DUMP_SLICE; ) {
+    size_t n = recorder.dumpRead(buf, sizeof(buf));
+    if (!n) {
+      break;
+    }
+    Serial.write(buf, n);
+    sent += n;
+  }
+  if (!recorder.dumping()) {
+    Serial.println();
+    Serial.println("STATUS:Dump done");
+  }
+}
+
+/** One AUTH: line per classified window (a few per second). */
+void printAuthWindow() {
+  Serial.print("AUTH:Window=");
+  Serial.print(authSession.windows());
+  Serial.print(",P=");
+  Serial.print(authSession.lastProbability(), 3);
+  Serial.print(",Mean=");
+  Serial.println(authSession.meanProbability(), 3);
+}
+
+/**
+ * End the session with its decision: early once confident, otherwise at
+ * AUTO_STOP_SEC. Ms is stream time to the decision.
+ */
+void endAuthSession() {
+  samplerStop();
+  recorder.endSession();
+  powerStreamStop();
+  authActive = false;
+  AuthDecision decision = authSession.finish();
+  uint32_t ms = (uint64_t)authSession.samples() * 1000 / samplerRate();
+
+  Serial.print(decision == AUTH_ACCEPT ? "\n========== ACCESS GRANTED (" : "\n========== ACCESS DENIED (");
+  Serial.print(ms / 1000.0, 1);
+  Serial.println("s) ==========");
+  Serial.print("AUTH:Result=");
+  Serial.print(authDecisionName(decision));
+  Serial.print(",Test=");
+  Serial.print(currentMode == MODE_AUTH_VALID ? "VALID" : "INVALID");
+  Serial.print(",Mean=");
+  Serial.print(authSession.meanProbability(), 3);
+  Serial.print(",Windows=");
+  Serial.print(authSession.windows());
+  Serial.print(",Skipped=");
+  Serial.print(authSession.skipped());
+  Serial.print(",Ms=");
+  Serial.print(ms);
+  Serial.print(",Early=");
+  Serial.println(authSession.early() ? 1 : 0);
+  currentMode = MODE_IDLE;
+  digitalWrite(LED_PIN, LOW);
+}
+
+void handleSamples() {
+  // Samples are taken on the other core; here we only drain and send.
+  Sample sample;
+  while (currentMode != MODE_IDLE && samplerRead(sample)) {
+    recorder.add(sample);       // Only while a recorder session is open
+    if (authActive) {
+      // On-device session: classified here, nothing streamed
+      if (authSession.push(sample.value[0], sample.artifact)) {
+        printAuthWindow();
       }
-      
-      // Auto-stop after 10 seconds for button-triggered tests
-      if ((currentMode == MODE_AUTH_VALID || currentMode == MODE_AUTH_INVALID) && 
-          (millis() - startTime > 10000)) {
-        Serial.println("\n========== TEST COMPLETE (10s) ==========");
-        Serial.print("STATUS:Completed ");
-        Serial.print(currentMode == MODE_AUTH_VALID ? "VALID" : "INVALID");
-        Serial.print(" user test - ");
-        Serial.print(sampleCount);
-        Serial.println(" samples collected");
-        currentMode = MODE_IDLE;
-        digitalWrite(LED_PIN, LOW);
+    } else {
+      // Queue into the current TX block
+      sendSample(sample);
+    }
+    
+    sampleCount++;
+    sampleIndexNext = sample.index + 1;
+    if (sample.artifact) {
+      artifactSamples++;
+    }
+    if (!authActive && sampleCount % (samplerRate() * STATS_INTERVAL_SEC) == 0) {
+      sendStats();
+    }
+    
+    // Blink LED to show activity
+    if (sampleCount % samplerRate() == 0) {  // Every second
+      digitalWrite(LED_PIN, !digitalRead(LED_PIN));
+    }
+    
+    bool timeUp = sample.index + 1 >= samplerRate() * AUTO_STOP_SEC;
+    if (authActive) {
+      if (authSession.decision() != AUTH_PENDING || timeUp) {
+        endAuthSession();
       }
+      continue;
+    }
+    
+    // Auto-stop after AUTO_STOP_SEC of samples for button-triggered tests
+    if ((currentMode == MODE_AUTH_VALID || currentMode == MODE_AUTH_INVALID) && timeUp) {
+      samplerStop();
+      recorder.endSession();
+      sendStats();
+      flushFrame();
+      powerStreamStop();
+      Serial.print("\n========== TEST COMPLETE (");
+      Serial.print(AUTO_STOP_SEC);
+      Serial.println("s) ==========");
+      Serial.print("STATUS:Completed ");
+      Serial.print(currentMode == MODE_AUTH_VALID ? "VALID" : "INVALID");
+      Serial.print(" user test - ");
+      Serial.print(sampleCount);
+      Serial.println(" samples collected");
+      currentMode = MODE_IDLE;
+      digitalWrite(LED_PIN, LOW);
     }
   }
   
-  // Small delay to prevent watchdog issues
-  yield();
+  // One Serial.write per completed block
+  txRing.drainTo(*transport);
+}
+
+void commsTask(void *) {
+  for (;;) {
+    // Wake on a new sample or button event, or at least every
+    // COMMS_POLL_MS for commands. Blocking here also lets IDLE0 feed the
+    // watchdog; a DUMP skips the wait and blocks in Serial.write() instead.
+    ulTaskNotifyTake(pdTRUE, recorder.dumping() ? 0 : pdMS_TO_TICKS(COMMS_POLL_MS));
+    uint32_t start = perfCycles();
+    
+    handleButtons();
+    handleSerialInput();
+    handleBaudTimeout();
+    handleDump();
+    handleSamples();
+    handlePerfTelemetry();
+
+    uint32_t us = perfElapsedUs(start);
+    loopPerf.add(us);
+    commsBusyUs += us;
+
+    // Nothing to stream or wait for: light sleep until RX, a button or the timer
+    if (currentMode == MODE_IDLE && !baudPending && !perfIntervalSec && !recorder.dumping()) {
+      powerIdleSleep();
+    }
+  }
+}
+
+// ============================================================
+// MAIN LOOP
+// ============================================================
+
+void loop() {
+  // Arduino's loopTask has nothing left to do
+  vTaskDelete(NULL);
 }
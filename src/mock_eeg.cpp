@@ -0,0 +1,125 @@
+/*
+ * CortexKey firmware - fast mock EEG synthesizer
+ */
+#include "mock_eeg.h"
+
+// ============================================================
+// TABLES
+// ============================================================
+static float sineLut[SINE_LUT_SIZE + 1];     // +1 guard for interpolation
+static float blinkLut[BLINK_LUT_SIZE + 1];
+
+#define SINE_FRAC_BITS   (32 - SINE_LUT_BITS)
+
+// random(0, 100) / 50 rad of phase jitter, as a fraction of 2^32
+static const uint32_t IMPOSTOR_JITTER_SPAN = (uint32_t)(1.98 / (2.0 * PI) * 4294967296.0);
+
+void mockTablesInit() {
+  for (int i = 0; i <= SINE_LUT_SIZE; i++) {
+    sineLut[i] = sinf(2.0f * PI * i / SINE_LUT_SIZE);
+  }
+  // 50 uV Gaussian bump over the 300 ms blink: exp(-(u - 0.2)^2 / 0.02)
+  for (int i = 0; i <= BLINK_LUT_SIZE; i++) {
+    float u = (float)i / BLINK_LUT_SIZE;
+    blinkLut[i] = 50.0f * expf(-(u - 0.2f) * (u - 0.2f) / 0.02f);
+  }
+}
+
+float sineFromPhase(uint32_t phase) {
+  uint32_t i = phase >> SINE_FRAC_BITS;
+  float frac = (phase & ((1u << SINE_FRAC_BITS) - 1)) * (1.0f / (1u << SINE_FRAC_BITS));
+  float a = sineLut[i];
+  return a + (sineLut[i + 1] - a) * frac;
+}
+
+// ============================================================
+// MOCK CHANNEL
+// ============================================================
+
+void MockEeg::begin(uint32_t rate, uint32_t seed) {
+  sampleRate = rate;
+  seedValue = seed;
+
+  alpha.setFrequency(2.0f, rate);       // 10 Hz  / 5
+  beta.setFrequency(4.0f, rate);        // 20 Hz  / 5
+  theta.setFrequency(1.2f, rate);       // 6 Hz   / 5
+  delta.setFrequency(0.5f, rate);       // 2.5 Hz / 5
+  modulation.setFrequency(0.06f, rate); // Breathing
+
+  impAlpha.setFrequency(1.5f, rate);    // Shifted alpha
+  impBeta.setFrequency(4.4f, rate);     // 22 Hz / 5
+  impTheta.setFrequency(1.1f, rate);
+  muscle.setFrequency(9.0f, rate);      // 45 Hz / 5
+
+  modelAlpha.setFrequency(10.0f, rate);
+  modelBeta.setFrequency(20.0f, rate);
+  modelTheta.setFrequency(6.0f, rate);
+
+  blinkCycle = rate * 5;                // Every 5 s ...
+  blinkLength = rate * 3 / 10;          // ... for 300 ms
+  reset();
+}
+
+void MockEeg::reset() {
+  PhaseOscillator *oscs[] = {&alpha, &beta, &theta, &delta, &modulation,
+                             &impAlpha, &impBeta, &impTheta, &muscle,
+                             &modelAlpha, &modelBeta, &modelTheta};
+  for (PhaseOscillator *o : oscs) {
+    o->phase = 0;
+  }
+  blinkPos = 0;
+  rng.seed(seedValue);
+}
+
+float MockEeg::nextAuth() {
+  float rhythm = 25.0f * alpha.next()
+               + 12.0f * beta.next()
+               + 6.0f * theta.next()
+               + 4.0f * delta.next();
+  float mod = 1.0f + 0.15f * modulation.next();
+  float noise = 3.0f * rng.bipolar();
+
+  float blink = 0.0f;
+  if (blinkPos < blinkLength) {
+    float x = blinkPos * ((float)BLINK_LUT_SIZE / blinkLength);
+    uint32_t i = (uint32_t)x;
+    blink = blinkLut[i] + (blinkLut[i + 1] - blinkLut[i]) * (x - i);
+  }
+  if (++blinkPos >= blinkCycle) {
+    blinkPos = 0;
+  }
+
+  return rhythm * mod + noise + blink;
+}
+
+float MockEeg::nextImpostor() {
+  uint32_t jitterA = ((uint64_t)rng.next() * IMPOSTOR_JITTER_SPAN) >> 32;
+  uint32_t jitterB = ((uint64_t)rng.next() * IMPOSTOR_JITTER_SPAN) >> 32;
+  float a = 8.0f * impAlpha.nextWithOffset(jitterA);
+  float b = 15.0f * impBeta.nextWithOffset(jitterB);
+  float t = 4.0f * impTheta.next();
+
+  float noise = 12.0f * rng.bipolar();
+  float whiteNoise = 8.0f * rng.bipolar();
+
+  // Frequent muscle artifacts (5 % of samples); the oscillator keeps
+  // running so bursts stay phase-continuous with t
+  float m = muscle.next();
+  float musc = rng.chance(50) ? 30.0f * m : 0.0f;
+
+  // Large random spikes (movement, 1 %)
+  float spike = rng.chance(10) ? 40.0f * rng.bipolar() : 0.0f;
+
+  return a + b + t + noise + whiteNoise + musc + spike;
+}
+
+float MockEeg::nextModelAuth() {
+  return 2.5f * modelAlpha.next()
+       + 1.2f * modelBeta.next()
+       + 0.6f * modelTheta.next()
+       + 0.3f * rng.gaussian();
+}
+
+float MockEeg::nextModelImpostor() {
+  return 1.5f * rng.gaussian();
+}
@@ -0,0 +1,115 @@
+/*
+ * CortexKey firmware - fast mock EEG synthesizer
+ *
+ * Same signals as the original generateAuthEEG() / generateImpostorEEG()
+ * (frequencies divided by 5 for on-screen visibility), but built from
+ * 32-bit phase accumulators over an interpolated sine LUT, a xorshift32
+ * PRNG and a precomputed blink envelope. No libm call per sample, so mock
+ * mode can run multi-channel or at kHz rates for backend load testing.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#define SINE_LUT_BITS    9                      // 512 entries + guard
+#define SINE_LUT_SIZE    (1 << SINE_LUT_BITS)
+#define BLINK_LUT_SIZE   64
+
+/** Fill the shared sine and blink tables. Call once before any MockEeg use. */
+void mockTablesInit();
+
+/** sin(2 pi * phase / 2^32) by table lookup with linear interpolation. */
+float sineFromPhase(uint32_t phase);
+
+/** Marsaglia xorshift32: 3 shifts + 3 xors per draw. */
+struct XorShift32 {
+  uint32_t state = 2463534242u;
+
+  void seed(uint32_t s) { state = s ? s : 2463534242u; }
+
+  inline uint32_t next() {
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return state = x;
+  }
+
+  /** Uniform in [-1, 1). */
+  inline float bipolar() { return (int32_t)next() * (1.0f / 2147483648.0f); }
+
+  /** Uniform in [0, 1). */
+  inline float unit() { return (next() >> 8) * (1.0f / 16777216.0f); }
+
+  /** Approximately standard normal: Irwin-Hall sum of four uniforms. */
+  inline float gaussian() { return (bipolar() + bipolar() + bipolar() + bipolar()) * 0.8660254f; }
+
+  /** True with probability permille / 1000. */
+  inline bool chance(uint32_t permille) { return (next() % 1000) < permille; }
+};
+
+/** Sine oscillator: one add per sample. */
+struct PhaseOscillator {
+  uint32_t phase = 0;
+  uint32_t step = 0;
+
+  void setFrequency(float hz, uint32_t rate) {
+    step = (uint32_t)((double)hz / rate * 4294967296.0);
+  }
+
+  inline float next() {
+    float v = sineFromPhase(phase);
+    phase += step;
+    return v;
+  }
+
+  /** Current sample with an extra phase offset, then advance. */
+  inline float nextWithOffset(uint32_t offset) {
+    float v = sineFromPhase(phase + offset);
+    phase += step;
+    return v;
+  }
+};
+
+/**
+ * One synthetic EEG channel. next*() must be called once per sample
+ * period; reset() restarts both signal timelines at t = 0.
+ */
+class MockEeg {
+public:
+  void begin(uint32_t rate, uint32_t seed);
+  void reset();
+
+  /** Strong alpha + moderate beta, low noise, eye blink every 5 s. */
+  float nextAuth();
+
+  /** Weak jittered alpha, high beta and noise, muscle and movement artifacts. */
+  float nextImpostor();
+
+  /**
+   * The SVM's training signals, generate_auth_user() / generate_impostor()
+   * in backend/eeg_pipeline.py: real-speed bands in model units. Used for
+   * on-device sessions, which stream nothing to look at.
+   */
+  float nextModelAuth();
+  float nextModelImpostor();
+
+private:
+  uint32_t sampleRate = SAMPLE_RATE;
+  uint32_t seedValue = 1;
+  XorShift32 rng;
+
+  // Authenticated
+  PhaseOscillator alpha, beta, theta, delta, modulation;
+  uint32_t blinkPos = 0;          // Samples into the current 5 s blink cycle
+  uint32_t blinkCycle = 0;        // Samples per blink cycle
+  uint32_t blinkLength = 0;       // Samples per blink
+
+  // Impostor
+  PhaseOscillator impAlpha, impBeta, impTheta, muscle;
+
+  // Training signal
+  PhaseOscillator modelAlpha, modelBeta, modelTheta;
+};
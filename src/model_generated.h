@@ -0,0 +1,73 @@
+/*
+ * CortexKey firmware - authentication model tables
+ *
+ * GENERATED by tools/export_model.py from backend/models/svm_model.pkl
+ * and scaler.pkl - do not edit by hand; train_model.py re-runs it.
+ * RBF SVM, 8 support vectors, gamma = 0.166666667.
+ * Features: theta, alpha, beta, alpha/theta, alpha/beta, total.
+ */
+#pragma once
+
+#include "svm.h"
+
+#define MODEL_VERSION          "a39e4021"
+#define MODEL_SAMPLE_RATE      250
+#define MODEL_FEATURES         6
+#define MODEL_SUPPORT_VECTORS  8
+#define MODEL_KERNEL           SVM_RBF
+
+// StandardScaler
+constexpr float MODEL_SCALER_MEAN[MODEL_FEATURES] = {
+  0.0907962048f,    // theta
+  1.54539553f,      // alpha
+  0.484720072f,     // beta
+  11.920395f,       // alpha/theta
+  2.24055019f,      // alpha/beta
+  2.12091181f,      // total
+};
+constexpr float MODEL_SCALER_SCALE[MODEL_FEATURES] = {
+  0.0530165653f,    // theta
+  1.47423323f,      // alpha
+  0.246761363f,     // beta
+  9.79236348f,      // alpha/theta
+  1.93407536f,      // alpha/beta
+  1.76656716f,      // total
+};
+
+// SVC decision_function: positive = authenticated
+constexpr float MODEL_DUAL_COEF[MODEL_SUPPORT_VECTORS] = {
+  -0.136953796f,
+  -0.547360598f,
+  -0.0411152585f,
+  -0.230916671f,
+  -0.525526559f,
+  0.0593047822f,
+  0.740740667f,
+  0.681827433f,
+};
+constexpr float MODEL_SUPPORT[MODEL_SUPPORT_VECTORS][MODEL_FEATURES] = {
+  {     0.385108281f,    -0.982961123f,    -0.259747883f,     -1.12890593f,     -1.04010869f,    -0.845024523f },
+  {     -1.47838556f,    -0.911493133f,    -0.844934876f,     0.440999978f,    -0.781020375f,    -0.923049917f },
+  {     -1.53088768f,     -1.02036158f,     -1.37620162f,     -0.78117368f,      -1.0118748f,     -1.08968783f },
+  {     -1.27219377f,     -1.00170862f,   0.00217793682f,    -0.917091298f,     -1.08532095f,    -0.873820185f },
+  {     0.733127137f,    -0.999397183f,     -1.17144046f,     -1.16056974f,    -0.968055695f,    -0.975645272f },
+  {      1.35011014f,     0.964979431f,      0.64143247f,     0.649317127f,      1.22813594f,     0.935409495f },
+  {      0.26650921f,     0.952935589f,      1.00965197f,       1.6540538f,     0.920132907f,     0.944273077f },
+  {      1.62576938f,      0.99416097f,      1.13975548f,       0.5200059f,     0.874036264f,      1.03764267f },
+};
+
+// Inference specialized on this model (svm.h)
+typedef SvmModel<MODEL_FEATURES, MODEL_SUPPORT_VECTORS, MODEL_KERNEL> AuthModel;
+
+constexpr AuthModel AUTH_MODEL = {
+  MODEL_SCALER_MEAN,
+  MODEL_SCALER_SCALE,
+  MODEL_SUPPORT,
+  MODEL_DUAL_COEF,
+  -0.133049166f,    // intercept
+  0.166666667f,     // gamma
+  0.0f,             // coef0
+  3.0f,             // degree
+  -5.25181257f,     // Platt A
+  -0.0132575264f,   // Platt B
+};
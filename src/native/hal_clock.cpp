@@ -0,0 +1,570 @@
+/*
+ * CortexKey firmware - host-native clock, tasks and hardware timer
+ *
+ * One mutex guards the whole simulated kernel. Every firmware task and
+ * the Arduino loop thread count as runnable unless blocked in a delay or
+ * a notification wait; the clock thread advances virtual time to the next
+ * event (timer alarm, software timer or task timeout), either paced
+ * against the host clock or, unthrottled, only once nothing is runnable.
+ */
+#include <Arduino.h>
+#include <freertos/queue.h>
+#include <freertos/timers.h>
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "hal_native.h"
+
+#define APB_MHZ        80        // Timer input clock: divider 80 = 1 us per count
+#define NEVER          UINT64_MAX
+#define PACE_STEP_US   1000      // Paced mode: millis() advances at least this often
+
+struct NativeTask {
+  const char *name = "";
+  std::condition_variable cv;
+  uint32_t notify = 0;
+  bool blocked = false;
+  bool notifiable = false;      // A notification (not just the timeout) ends the wait
+  uint64_t wakeUs = NEVER;
+};
+
+struct hw_timer_t {
+  uint16_t divider = APB_MHZ;
+  uint64_t alarm = 0;
+  bool autoreload = false;
+  bool armed = false;
+  uint64_t baseUs = 0;          // Virtual time at which the counter read 0
+  uint64_t nextUs = NEVER;
+  void (*isr)() = nullptr;
+};
+
+struct NativeTimer {
+  const char *name = "";
+  uint64_t periodUs = 0;
+  bool autoReload = false;
+  void *id = nullptr;
+  TimerCallbackFunction_t callback = nullptr;
+  bool armed = false;
+  bool due = false;             // Expired, callback not yet run by the service task
+  uint64_t expiryUs = NEVER;
+};
+
+struct NativeQueue {
+  size_t length = 0;
+  size_t itemSize = 0;
+  std::deque<std::vector<uint8_t>> items;
+  std::vector<NativeTask *> receivers;
+};
+
+typedef std::chrono::steady_clock HostClock;
+
+// ============================================================
+// STATE
+// ============================================================
+static std::mutex kernel;
+static std::condition_variable clockCv;
+static std::vector<NativeTask *> tasks;
+static std::vector<hw_timer_t *> timers;
+static std::vector<NativeTimer *> softTimers;
+static NativeTask *timerServiceTask = nullptr;
+static std::atomic<uint64_t> nowUs{0};
+static int runnable = 0;
+static double speed = 1.0;
+static uint64_t runLimitUs = 0;
+static HostClock::time_point hostStart;
+
+static thread_local NativeTask *self = nullptr;
+
+// ============================================================
+// KERNEL (kernel mutex held)
+// ============================================================
+
+static void changed() {
+  clockCv.notify_one();
+}
+
+static void wake(NativeTask *t) {
+  if (t->blocked) {
+    t->blocked = false;
+    t->wakeUs = NEVER;
+    runnable++;                 // Counted now, so the clock cannot run ahead of it
+    t->cv.notify_one();
+  }
+}
+
+/** Block the calling task until deadline, or a notification if notifiable. */
+static void block(std::unique_lock<std::mutex> &lock, uint64_t deadline, bool notifiable) {
+  NativeTask *t = self;
+  t->blocked = true;
+  t->notifiable = notifiable;
+  t->wakeUs = deadline;
+  runnable--;
+  changed();
+  t->cv.wait(lock, [t] { return !t->blocked; });
+}
+
+static void notify(NativeTask *t) {
+  t->notify++;
+  if (t->notifiable) {
+    wake(t);
+  }
+}
+
+static uint64_t deadlineAfter(TickType_t ticks) {
+  return ticks == portMAX_DELAY ? NEVER : nowUs.load() + (uint64_t)ticks * 1000;
+}
+
+static uint64_t timerPeriodUs(const hw_timer_t *t) {
+  uint64_t us = t->alarm * t->divider / APB_MHZ;
+  return us ? us : 1;
+}
+
+static bool timerRunning() {
+  for (hw_timer_t *t : timers) {
+    if (t->armed) return true;
+  }
+  return false;
+}
+
+static uint64_t nextEventUs() {
+  uint64_t next = NEVER;
+  for (hw_timer_t *t : timers) {
+    if (t->armed && t->nextUs < next) next = t->nextUs;
+  }
+  for (NativeTimer *t : softTimers) {
+    if (t->armed && t->expiryUs < next) next = t->expiryUs;
+  }
+  for (NativeTask *t : tasks) {
+    if (t->blocked && t->wakeUs < next) next = t->wakeUs;
+  }
+  return next;
+}
+
+// ============================================================
+// CLOCK THREAD
+// ============================================================
+
+static void clockThread() {
+  std::unique_lock<std::mutex> lock(kernel);
+  double rate = -1.0;
+  HostClock::time_point hostBase;
+  uint64_t virtBase = 0;
+
+  for (;;) {
+    double want = timerRunning() ? speed : 1.0;
+    if (want != rate) {
+      rate = want;              // Re-anchor on every start/stop or speed change
+      hostBase = HostClock::now();
+      virtBase = nowUs.load();
+    }
+
+    uint64_t now = nowUs.load();
+    uint64_t next = nextEventUs();
+    if (rate == 0.0) {
+      if (runnable > 0 || next == NEVER) {
+        clockCv.wait(lock);
+        continue;
+      }
+    } else {
+      if (next > now + PACE_STEP_US) next = now + PACE_STEP_US;
+      auto due = hostBase + std::chrono::microseconds((int64_t)((next - virtBase) / rate));
+      if (HostClock::now() < due) {
+        clockCv.wait_until(lock, due);
+        continue;               // Timers or deadlines may have moved meanwhile
+      }
+    }
+
+    nowUs.store(next);
+    for (NativeTask *t : tasks) {
+      if (t->blocked && t->wakeUs <= next) wake(t);
+    }
+    bool softDue = false;
+    for (NativeTimer *t : softTimers) {
+      if (t->armed && t->expiryUs <= next) {
+        t->due = softDue = true;
+        if (t->autoReload) {
+          t->expiryUs += t->periodUs;
+        } else {
+          t->armed = false;
+        }
+      }
+    }
+    if (softDue) {
+      notify(timerServiceTask);
+    }
+    void (*isr)() = nullptr;
+    for (hw_timer_t *t : timers) {
+      if (t->armed && t->nextUs <= next) {
+        isr = t->isr;
+        if (t->autoreload) {
+          t->nextUs += timerPeriodUs(t);
+        } else {
+          t->armed = false;
+        }
+      }
+    }
+
+    if (runLimitUs && next >= runLimitUs) {
+      fflush(stdout);
+      std::_Exit(0);
+    }
+    if (isr) {
+      lock.unlock();            // The ISR takes the kernel lock to notify
+      isr();
+      lock.lock();
+    }
+  }
+}
+
+// ============================================================
+// HOST CONTROLS
+// ============================================================
+
+void nativeBegin() {
+  hostStart = HostClock::now();
+  self = new NativeTask();
+  self->name = "loopTask";
+  {
+    std::lock_guard<std::mutex> lock(kernel);
+    tasks.push_back(self);
+    runnable++;
+  }
+  std::thread(clockThread).detach();
+}
+
+void nativeSetSpeed(double factor) {
+  std::lock_guard<std::mutex> lock(kernel);
+  speed = factor < 0.0 ? 0.0 : factor;
+  changed();
+}
+
+void nativeSetRunLimitUs(uint64_t us) {
+  std::lock_guard<std::mutex> lock(kernel);
+  runLimitUs = us;
+}
+
+uint64_t nativeNowUs() {
+  return nowUs.load();
+}
+
+// ============================================================
+// ARDUINO TIME
+// ============================================================
+
+unsigned long millis() {
+  return (unsigned long)(nowUs.load() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)nowUs.load();
+}
+
+extern "C" int64_t esp_timer_get_time(void) {
+  return (int64_t)nowUs.load();
+}
+
+void delay(uint32_t ms) {
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+  std::unique_lock<std::mutex> lock(kernel);
+  block(lock, nowUs.load() + us, false);
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(HostClock::now() - hostStart).count();
+}
+
+uint32_t EspClass::getCpuFreqMHz() {
+  return NATIVE_CPU_MHZ;
+}
+
+// ============================================================
+// FREERTOS TASKS
+// ============================================================
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core) {
+  NativeTask *t = new NativeTask();
+  t->name = name;
+  {
+    std::lock_guard<std::mutex> lock(kernel);
+    tasks.push_back(t);
+    runnable++;
+  }
+  if (created) {
+    *created = t;
+  }
+  std::thread([t, fn, param] {
+    self = t;
+    fn(param);
+    vTaskDelete(nullptr);
+  }).detach();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task != nullptr && task != self) {
+    return;                     // Only self-deletion is used by the firmware
+  }
+  std::unique_lock<std::mutex> lock(kernel);
+  block(lock, NEVER, false);    // Parked for good: nothing ever wakes it
+}
+
+void vTaskDelay(TickType_t ticks) {
+  if (ticks == 0) {
+    std::this_thread::yield();
+    return;
+  }
+  std::unique_lock<std::mutex> lock(kernel);
+  block(lock, deadlineAfter(ticks), false);
+}
+
+TickType_t xTaskGetTickCount() {
+  return (TickType_t)(nowUs.load() / 1000);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(kernel);
+  NativeTask *t = self;
+  if (t->notify == 0 && ticksToWait != 0) {
+    block(lock, deadlineAfter(ticksToWait), true);
+  }
+  uint32_t value = t->notify;
+  if (clearOnExit) {
+    t->notify = 0;
+  } else if (value) {
+    t->notify--;
+  }
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> lock(kernel);
+  notify(task);
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken) {
+  xTaskNotifyGive(task);
+  if (higherPriorityTaskWoken) {
+    *higherPriorityTaskWoken = pdFALSE;
+  }
+}
+
+// ============================================================
+// HARDWARE TIMER
+// ============================================================
+
+hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool countUp) {
+  hw_timer_t *t = new hw_timer_t();
+  t->divider = divider;
+  std::lock_guard<std::mutex> lock(kernel);
+  t->baseUs = nowUs.load();
+  timers.push_back(t);
+  return t;
+}
+
+void timerEnd(hw_timer_t *timer) {
+  std::lock_guard<std::mutex> lock(kernel);
+  timer->armed = false;
+  changed();
+}
+
+void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(void), bool edge) {
+  std::lock_guard<std::mutex> lock(kernel);
+  timer->isr = fn;
+}
+
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarmValue, bool autoreload) {
+  std::lock_guard<std::mutex> lock(kernel);
+  timer->alarm = alarmValue;
+  timer->autoreload = autoreload;
+  if (timer->armed) {
+    timer->nextUs = timer->baseUs + timerPeriodUs(timer);
+    changed();
+  }
+}
+
+void timerAlarmEnable(hw_timer_t *timer) {
+  std::lock_guard<std::mutex> lock(kernel);
+  uint64_t period = timerPeriodUs(timer);
+  timer->nextUs = timer->baseUs + period;
+  while (timer->nextUs <= nowUs.load()) {
+    timer->nextUs += period;
+  }
+  timer->armed = true;
+  changed();
+}
+
+void timerAlarmDisable(hw_timer_t *timer) {
+  std::lock_guard<std::mutex> lock(kernel);
+  timer->armed = false;
+  changed();
+}
+
+void timerWrite(hw_timer_t *timer, uint64_t value) {
+  std::lock_guard<std::mutex> lock(kernel);
+  timer->baseUs = nowUs.load() - value * timer->divider / APB_MHZ;
+  if (timer->armed) {
+    timer->nextUs = timer->baseUs + timerPeriodUs(timer);
+    changed();
+  }
+}
+
+// ============================================================
+// QUEUES
+// ============================================================
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  NativeQueue *q = new NativeQueue();
+  q->length = length;
+  q->itemSize = itemSize;
+  return q;
+}
+
+/** Never blocks: a full queue fails at once, whatever ticksToWait says. */
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait) {
+  std::lock_guard<std::mutex> lock(kernel);
+  if (queue->items.size() >= queue->length) {
+    return pdFAIL;
+  }
+  const uint8_t *bytes = (const uint8_t *)item;
+  queue->items.emplace_back(bytes, bytes + queue->itemSize);
+  for (NativeTask *t : queue->receivers) {
+    wake(t);
+  }
+  return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken) {
+  if (higherPriorityTaskWoken) {
+    *higherPriorityTaskWoken = pdFALSE;
+  }
+  return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait) {
+  std::unique_lock<std::mutex> lock(kernel);
+  if (queue->items.empty() && ticksToWait != 0) {
+    queue->receivers.push_back(self);
+    block(lock, deadlineAfter(ticksToWait), false);
+    queue->receivers.erase(std::find(queue->receivers.begin(), queue->receivers.end(), self));
+  }
+  if (queue->items.empty()) {
+    return pdFAIL;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> lock(kernel);
+  return (UBaseType_t)queue->items.size();
+}
+
+// ============================================================
+// SOFTWARE TIMERS
+// ============================================================
+
+/** Runs expired timer callbacks in order; the FreeRTOS daemon task's job. */
+static void timerService(void *) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    for (;;) {
+      NativeTimer *fire = nullptr;
+      {
+        std::lock_guard<std::mutex> lock(kernel);
+        for (NativeTimer *t : softTimers) {
+          if (t->due) {
+            t->due = false;
+            fire = t;
+            break;
+          }
+        }
+      }
+      if (!fire) {
+        break;
+      }
+      fire->callback(fire);
+    }
+  }
+}
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *id,
+                           TimerCallbackFunction_t callback) {
+  if (!timerServiceTask) {
+    xTaskCreatePinnedToCore(timerService, "Tmr Svc", 0, nullptr, 1, &timerServiceTask, 0);
+  }
+  NativeTimer *t = new NativeTimer();
+  t->name = name;
+  t->periodUs = (uint64_t)period * 1000;
+  t->autoReload = autoReload != pdFALSE;
+  t->id = id;
+  t->callback = callback;
+  std::lock_guard<std::mutex> lock(kernel);
+  softTimers.push_back(t);
+  return t;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer) {
+  return timer->id;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait) {
+  std::lock_guard<std::mutex> lock(kernel);
+  timer->expiryUs = nowUs.load() + timer->periodUs;
+  timer->armed = true;
+  changed();
+  return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait) {
+  std::lock_guard<std::mutex> lock(kernel);
+  timer->armed = false;
+  timer->due = false;
+  return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait) {
+  return xTimerStart(timer, ticksToWait);
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticksToWait) {
+  {
+    std::lock_guard<std::mutex> lock(kernel);
+    timer->periodUs = (uint64_t)period * 1000;
+  }
+  return xTimerStart(timer, ticksToWait);
+}
+
+BaseType_t xTimerStartFromISR(TimerHandle_t timer, BaseType_t *higherPriorityTaskWoken) {
+  if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+  return xTimerStart(timer, 0);
+}
+
+BaseType_t xTimerStopFromISR(TimerHandle_t timer, BaseType_t *higherPriorityTaskWoken) {
+  if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+  return xTimerStop(timer, 0);
+}
+
+BaseType_t xTimerResetFromISR(TimerHandle_t timer, BaseType_t *higherPriorityTaskWoken) {
+  if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+  return xTimerReset(timer, 0);
+}
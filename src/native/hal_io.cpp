@@ -0,0 +1,578 @@
+/*
+ * CortexKey firmware - host-native console, GPIO, ADC, sleep, NVS and flash
+ */
+#include <Arduino.h>
+#include <Preferences.h>
+#include <driver/adc.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include <esp_adc_cal.h>
+#include <esp_partition.h>
+#include <esp_sleep.h>
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hal_native.h"
+
+#define NATIVE_GPIO_COUNT   40
+#define NATIVE_EFUSE_MAC    0x0000A4CFC0FFEE42ULL
+
+// Synthetic ADC: BioAmp bias near VCC / 2 plus a small alpha tone and noise
+#define SYNTH_BIAS_RAW      1864      // ~1.65 V with the default-Vref model below
+#define SYNTH_TONE_HZ       10.0
+#define SYNTH_TONE_RAW      12.0
+#define SYNTH_NOISE_RAW     3
+
+// Default-Vref linear model, 11 dB / 12 bit: ~0.81 mV per code + 142 mV
+#define CAL_COEFF_A         53047
+#define CAL_COEFF_B         142
+
+// Default partition table (default.csv): spiffs data partition
+#define FLASH_SPIFFS_ADDR   0x290000
+#define FLASH_SPIFFS_SIZE   0x160000
+#define FLASH_SECTOR_SIZE   4096
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// ============================================================
+// PRINT
+// ============================================================
+
+size_t Print::write(const uint8_t *data, size_t len) {
+  size_t n = 0;
+  while (len--) {
+    n += write(*data++);
+  }
+  return n;
+}
+
+size_t Print::printNumber(unsigned long long n, int base) {
+  char buf[8 * sizeof(n) + 1];
+  char *p = &buf[sizeof(buf) - 1];
+  *p = '\0';
+  if (base < 2) base = 10;
+  do {
+    unsigned digit = (unsigned)(n % base);
+    *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    n /= base;
+  } while (n);
+  return write(p);
+}
+
+size_t Print::print(long n, int base) {
+  return print((long long)n, base);
+}
+
+size_t Print::print(long long n, int base) {
+  if (base == DEC && n < 0) {
+    return print('-') + printNumber(0ULL - (unsigned long long)n, DEC);
+  }
+  // Other bases print the 32-bit two's complement, as on the ESP32
+  return printNumber(n < 0 && n >= INT32_MIN ? (uint32_t)n : (unsigned long long)n, base);
+}
+
+size_t Print::print(double n, int digits) {
+  if (isnan(n)) return print("nan");
+  if (isinf(n)) return print("inf");
+  if (n > 4294967040.0 || n < -4294967040.0) return print("ovf");
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, n);
+  return write(buf);
+}
+
+size_t Print::printf(const char *format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  if ((size_t)len < sizeof(buf)) {
+    return write((const uint8_t *)buf, len);
+  }
+  std::vector<char> big(len + 1);
+  va_start(args, format);
+  vsnprintf(big.data(), big.size(), format, args);
+  va_end(args);
+  return write((const uint8_t *)big.data(), len);
+}
+
+// ============================================================
+// SERIAL
+// ============================================================
+static int consoleIn = STDIN_FILENO;
+static int consoleOut = STDOUT_FILENO;
+static std::mutex rxLock;
+static std::deque<uint8_t> rx;
+static std::mutex txLock;
+
+/** Reader thread: stops at EOF; a pty master reports EIO until a client opens the slave. */
+static void readerThread() {
+  uint8_t buf[256];
+  for (;;) {
+    ssize_t n = read(consoleIn, buf, sizeof(buf));
+    if (n > 0) {
+      std::lock_guard<std::mutex> lock(rxLock);
+      rx.insert(rx.end(), buf, buf + n);
+    } else if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EIO)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    } else {
+      return;
+    }
+  }
+}
+
+void nativeSerialOpen(int inFd, int outFd) {
+  consoleIn = inFd;
+  consoleOut = outFd;
+  std::thread(readerThread).detach();
+}
+
+void nativeSerialInject(const char *text) {
+  std::lock_guard<std::mutex> lock(rxLock);
+  rx.insert(rx.end(), text, text + strlen(text));
+}
+
+int HardwareSerial::available() {
+  std::lock_guard<std::mutex> lock(rxLock);
+  return (int)rx.size();
+}
+
+int HardwareSerial::read() {
+  std::lock_guard<std::mutex> lock(rxLock);
+  if (rx.empty()) {
+    return -1;
+  }
+  int c = rx.front();
+  rx.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek() {
+  std::lock_guard<std::mutex> lock(rxLock);
+  return rx.empty() ? -1 : rx.front();
+}
+
+void HardwareSerial::flush() {
+  // write() returns only once the bytes are with the OS: nothing is queued here
+}
+
+/** Blocking write: a slow reader throttles the firmware like a full UART FIFO. */
+size_t HardwareSerial::write(const uint8_t *data, size_t len) {
+  std::lock_guard<std::mutex> lock(txLock);
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = ::write(consoleOut, data + done, len - done);
+    if (n > 0) {
+      done += n;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else {
+      break;                    // Nobody listening: dropped, as on an open UART line
+    }
+  }
+  return len;
+}
+
+// ============================================================
+// GPIO + ANALOG
+// ============================================================
+struct PinInterrupt {
+  void (*fn)(void *) = nullptr;
+  void *arg = nullptr;
+  void (*plain)() = nullptr;
+  int mode = 0;
+  bool enabled = true;
+  bool wake = false;            // gpio_wakeup_enable(): level wakes a light sleep
+  uint8_t wakeLevel = LOW;
+};
+
+static uint8_t pinLevel[NATIVE_GPIO_COUNT];
+static PinInterrupt pinIrq[NATIVE_GPIO_COUNT];
+static std::mutex gpioLock;
+static std::mt19937 rng;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin < NATIVE_GPIO_COUNT && mode == INPUT_PULLUP) {
+    pinLevel[pin] = HIGH;       // Buttons read as released
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < NATIVE_GPIO_COUNT ? pinLevel[pin] : LOW;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < NATIVE_GPIO_COUNT) {
+    pinLevel[pin] = value ? HIGH : LOW;
+  }
+}
+
+void attachInterruptArg(uint8_t pin, void (*fn)(void *), void *arg, int mode) {
+  if (pin < NATIVE_GPIO_COUNT) {
+    std::lock_guard<std::mutex> lock(gpioLock);
+    pinIrq[pin] = PinInterrupt();
+    pinIrq[pin].fn = fn;
+    pinIrq[pin].arg = arg;
+    pinIrq[pin].mode = mode;
+  }
+}
+
+void attachInterrupt(uint8_t pin, void (*fn)(void), int mode) {
+  if (pin < NATIVE_GPIO_COUNT) {
+    std::lock_guard<std::mutex> lock(gpioLock);
+    pinIrq[pin] = PinInterrupt();
+    pinIrq[pin].plain = fn;
+    pinIrq[pin].mode = mode;
+  }
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < NATIVE_GPIO_COUNT) {
+    std::lock_guard<std::mutex> lock(gpioLock);
+    pinIrq[pin] = PinInterrupt();
+  }
+}
+
+void nativeGpioWrite(uint8_t pin, uint8_t level) {
+  if (pin >= NATIVE_GPIO_COUNT) {
+    return;
+  }
+  PinInterrupt irq;
+  {
+    std::lock_guard<std::mutex> lock(gpioLock);
+    uint8_t old = pinLevel[pin];
+    pinLevel[pin] = level ? HIGH : LOW;
+    int edge = old == pinLevel[pin] ? 0 : (pinLevel[pin] == HIGH ? RISING : FALLING);
+    if (!pinIrq[pin].enabled || !(edge & pinIrq[pin].mode)) {
+      return;
+    }
+    irq = pinIrq[pin];
+  }
+  if (irq.fn) {
+    irq.fn(irq.arg);
+  } else if (irq.plain) {
+    irq.plain();
+  }
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type) {
+  if (pin >= NATIVE_GPIO_COUNT) return ESP_ERR_INVALID_ARG;
+  static const int MODES[] = {0, RISING, FALLING, CHANGE, 0, 0};
+  std::lock_guard<std::mutex> lock(gpioLock);
+  pinIrq[pin].mode = MODES[type];
+  return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t pin) {
+  if (pin >= NATIVE_GPIO_COUNT) return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> lock(gpioLock);
+  pinIrq[pin].enabled = true;
+  return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t pin) {
+  if (pin >= NATIVE_GPIO_COUNT) return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> lock(gpioLock);
+  pinIrq[pin].enabled = false;
+  return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) {
+  if (pin >= NATIVE_GPIO_COUNT || (type != GPIO_INTR_LOW_LEVEL && type != GPIO_INTR_HIGH_LEVEL)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::lock_guard<std::mutex> lock(gpioLock);
+  pinIrq[pin].wake = true;
+  pinIrq[pin].wakeLevel = type == GPIO_INTR_HIGH_LEVEL ? HIGH : LOW;
+  pinIrq[pin].mode = 0;         // As on the chip: the pin's interrupt type is now the level
+  return ESP_OK;
+}
+
+esp_err_t gpio_wakeup_disable(gpio_num_t pin) {
+  if (pin >= NATIVE_GPIO_COUNT) return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> lock(gpioLock);
+  pinIrq[pin].wake = false;
+  return ESP_OK;
+}
+
+uint16_t analogRead(uint8_t pin) {
+  return (uint16_t)adc1_get_raw(ADC1_CHANNEL_0);
+}
+
+void analogReadResolution(uint8_t bits) {}
+
+void analogSetAttenuation(adc_attenuation_t attenuation) {}
+
+long random(long howbig) {
+  return howbig > 0 ? (long)(rng() % (unsigned long)howbig) : 0;
+}
+
+long random(long howsmall, long howbig) {
+  return howsmall < howbig ? howsmall + random(howbig - howsmall) : howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed) {
+    rng.seed((uint32_t)seed);
+  }
+}
+
+uint64_t EspClass::getEfuseMac() {
+  return NATIVE_EFUSE_MAC;
+}
+
+static uint32_t cpuMhz = 240;
+
+bool setCpuFrequencyMhz(uint32_t mhz) {
+  if (mhz != 240 && mhz != 160 && mhz != 80 && mhz != 40 && mhz != 20 && mhz != 10) {
+    return false;
+  }
+  cpuMhz = mhz;
+  return true;
+}
+
+uint32_t getCpuFrequencyMhz() {
+  return cpuMhz;
+}
+
+void EspClass::restart() {
+  fflush(stdout);
+  std::_Exit(0);
+}
+
+// ============================================================
+// LIGHT SLEEP
+// ============================================================
+static uint64_t sleepTimerUs = 0;
+static bool sleepOnGpio = false;
+static bool sleepOnUart = false;
+static esp_sleep_wakeup_cause_t wakeCause = ESP_SLEEP_WAKEUP_UNDEFINED;
+
+static bool gpioWakePending() {
+  std::lock_guard<std::mutex> lock(gpioLock);
+  for (uint8_t pin = 0; pin < NATIVE_GPIO_COUNT; pin++) {
+    if (pinIrq[pin].wake && pinLevel[pin] == pinIrq[pin].wakeLevel) return true;
+  }
+  return false;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us) {
+  sleepTimerUs = us;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_gpio_wakeup() {
+  sleepOnGpio = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_uart_wakeup(int uart) {
+  sleepOnUart = uart == UART_NUM_0;
+  return sleepOnUart ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_wakeup_threshold(uart_port_t port, int edges) {
+  return port == UART_NUM_0 && edges >= 3 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/** Sleeps in 1 ms steps of virtual time; the chip would be clock-gated instead. */
+esp_err_t esp_light_sleep_start() {
+  uint64_t deadline = sleepTimerUs ? nativeNowUs() + sleepTimerUs : UINT64_MAX;
+  for (;;) {
+    if (sleepOnUart && Serial.available() > 0) {
+      Serial.read();            // The waking character never reaches the UART FIFO
+      wakeCause = ESP_SLEEP_WAKEUP_UART;
+      break;
+    }
+    if (sleepOnGpio && gpioWakePending()) {
+      wakeCause = ESP_SLEEP_WAKEUP_GPIO;
+      break;
+    }
+    if (nativeNowUs() >= deadline) {
+      wakeCause = ESP_SLEEP_WAKEUP_TIMER;
+      break;
+    }
+    delay(1);
+  }
+  return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+  return wakeCause;
+}
+
+// ============================================================
+// ADC DRIVER + CALIBRATION
+// ============================================================
+
+esp_err_t adc1_config_width(adc_bits_width_t width) {
+  return ESP_OK;
+}
+
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten) {
+  return channel < ADC1_CHANNEL_MAX ? ESP_OK : ESP_FAIL;
+}
+
+int adc1_get_raw(adc1_channel_t channel) {
+  static thread_local std::minstd_rand noise(1 + channel);
+  double t = nativeNowUs() * 1e-6;
+  double tone = SYNTH_TONE_RAW * sin(2.0 * PI * SYNTH_TONE_HZ * t + channel);
+  int raw = SYNTH_BIAS_RAW + (int)lround(tone) + (int)(noise() % (2 * SYNTH_NOISE_RAW + 1)) - SYNTH_NOISE_RAW;
+  return constrain(raw, 0, 4095);
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t unit, adc_atten_t atten, adc_bits_width_t width,
+                                             uint32_t defaultVref, esp_adc_cal_characteristics_t *chars) {
+  memset(chars, 0, sizeof(*chars));
+  chars->adc_num = unit;
+  chars->atten = atten;
+  chars->bit_width = width;
+  chars->coeff_a = CAL_COEFF_A;
+  chars->coeff_b = CAL_COEFF_B;
+  chars->vref = defaultVref;
+  return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t raw, const esp_adc_cal_characteristics_t *chars) {
+  return (uint32_t)(((uint64_t)chars->coeff_a * raw + 32768) >> 16) + chars->coeff_b;
+}
+
+// ============================================================
+// PREFERENCES
+// ============================================================
+#define NVS_KEY_MAX  15
+
+typedef std::map<std::string, std::vector<uint8_t>> NvsNamespace;
+static std::mutex nvsLock;
+static std::map<std::string, NvsNamespace> nvs;
+
+bool Preferences::begin(const char *name, bool ro) {
+  if (!name || strlen(name) > NVS_KEY_MAX) {
+    return false;
+  }
+  ns = name;
+  readOnly = ro;
+  return true;
+}
+
+void Preferences::end() {
+  ns = nullptr;
+}
+
+bool Preferences::clear() {
+  if (!ns || readOnly) return false;
+  std::lock_guard<std::mutex> lock(nvsLock);
+  nvs[ns].clear();
+  return true;
+}
+
+bool Preferences::remove(const char *key) {
+  if (!ns || readOnly) return false;
+  std::lock_guard<std::mutex> lock(nvsLock);
+  return nvs[ns].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key) {
+  return getBytesLength(key) > 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  if (!ns || readOnly || !key || strlen(key) > NVS_KEY_MAX) return 0;
+  std::lock_guard<std::mutex> lock(nvsLock);
+  const uint8_t *bytes = (const uint8_t *)value;
+  nvs[ns][key].assign(bytes, bytes + len);
+  return len;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  if (!ns || !key) return 0;
+  std::lock_guard<std::mutex> lock(nvsLock);
+  auto space = nvs.find(ns);
+  if (space == nvs.end()) return 0;
+  auto entry = space->second.find(key);
+  if (entry == space->second.end() || entry->second.size() > maxLen) {
+    return 0;                   // Like NVS: a short buffer reads nothing
+  }
+  memcpy(buf, entry->second.data(), entry->second.size());
+  return entry->second.size();
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  if (!ns || !key) return 0;
+  std::lock_guard<std::mutex> lock(nvsLock);
+  auto space = nvs.find(ns);
+  if (space == nvs.end()) return 0;
+  auto entry = space->second.find(key);
+  return entry == space->second.end() ? 0 : entry->second.size();
+}
+
+// ============================================================
+// FLASH PARTITION + PSRAM
+// ============================================================
+
+static const esp_partition_t spiffsPartition = {
+  ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS,
+  FLASH_SPIFFS_ADDR, FLASH_SPIFFS_SIZE, "spiffs"
+};
+static std::mutex flashLock;
+static std::vector<uint8_t> flash(FLASH_SPIFFS_SIZE, 0xFF);
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype, const char *label) {
+  if (type != spiffsPartition.type ||
+      (subtype != ESP_PARTITION_SUBTYPE_ANY && subtype != spiffsPartition.subtype) ||
+      (label && strcmp(label, spiffsPartition.label) != 0)) {
+    return nullptr;
+  }
+  return &spiffsPartition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size) {
+  if (partition != &spiffsPartition || offset + size > partition->size) return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> lock(flashLock);
+  memcpy(dst, flash.data() + offset, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size) {
+  if (partition != &spiffsPartition || offset + size > partition->size) return ESP_ERR_INVALID_ARG;
+  std::lock_guard<std::mutex> lock(flashLock);
+  const uint8_t *bytes = (const uint8_t *)src;
+  for (size_t i = 0; i < size; i++) {
+    flash[offset + i] &= bytes[i];      // Programming only clears bits
+  }
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+  if (partition != &spiffsPartition || offset + size > partition->size ||
+      offset % FLASH_SECTOR_SIZE || size % FLASH_SECTOR_SIZE) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  std::lock_guard<std::mutex> lock(flashLock);
+  memset(flash.data() + offset, 0xFF, size);
+  return ESP_OK;
+}
+
+bool psramFound() {
+  return false;                 // The ESP32 DevKit V1 has none: the recorder uses flash
+}
+
+void *ps_malloc(size_t size) {
+  return nullptr;
+}
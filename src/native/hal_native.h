@@ -0,0 +1,40 @@
+/*
+ * CortexKey firmware - host-native port controls
+ *
+ * The simulated clock. While the sample timer runs, virtual time advances
+ * at nativeSetSpeed() times real time; with speed 0 it instead jumps from
+ * event to event as soon as every task is blocked, so a stream is
+ * generated as fast as the firmware code can produce it (and never
+ * overruns for lack of host CPU). With the timer stopped the clock always
+ * runs at real time, so command handshakes and timeouts behave as on
+ * hardware.
+ *
+ * Timings that the firmware takes from ESP.getCycleCount() (PERF, BENCH)
+ * are host wall-clock nanoseconds, not virtual time.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define NATIVE_CPU_MHZ  1000     // getCycleCount() counts nanoseconds
+
+/** Start the clock thread and register the calling thread as a task. */
+void nativeBegin();
+
+/** Streaming time factor: 1 = real time, 100 = 100x, 0 = unthrottled. */
+void nativeSetSpeed(double speed);
+
+/** Terminate the process once this much virtual time has passed (0 = never). */
+void nativeSetRunLimitUs(uint64_t us);
+
+/** Virtual microseconds since nativeBegin(). */
+uint64_t nativeNowUs();
+
+/** Console on inFd/outFd (stdin/stdout, or the master side of a pty). */
+void nativeSerialOpen(int inFd, int outFd);
+
+/** Queue bytes as if the host had sent them on the console. */
+void nativeSerialInject(const char *text);
+
+/** Drive an input pin as the outside world would; fires its edge interrupt. */
+void nativeGpioWrite(uint8_t pin, uint8_t level);
@@ -0,0 +1,184 @@
+/*
+ * CortexKey firmware - host-native Arduino core subset
+ *
+ * Just the part of the ESP32 Arduino core the firmware uses, implemented
+ * on POSIX threads in src/native/ so the unmodified sources build as
+ * `pio run -e native`. Time is virtual (hal_native.h): millis(), micros(),
+ * delays and the sample timer all follow the simulated clock, which can
+ * run faster than real time.
+ */
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define HIGH          1
+#define LOW           0
+#define INPUT         0x01
+#define OUTPUT        0x03
+#define INPUT_PULLUP  0x05
+
+#define RISING   0x01
+#define FALLING  0x02
+#define CHANGE   0x03
+
+#define DEC  10
+#define HEX  16
+#define OCT  8
+#define BIN  2
+
+#define PI       3.1415926535897932384626433832795
+#define HALF_PI  1.5707963267948966192313216916398
+#define TWO_PI   6.283185307179586476925286766559
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+enum adc_attenuation_t { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db };
+
+// ============================================================
+// PRINT / STREAM / SERIAL
+// ============================================================
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *data, size_t len);
+  size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+  size_t print(long long n, int base = DEC);
+  size_t print(unsigned long long n, int base = DEC) { return printNumber(n, base); }
+  size_t print(double n, int digits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(T value) { return print(value) + println(); }
+  template <typename T> size_t println(T value, int format) { return print(value, format) + println(); }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  size_t printNumber(unsigned long long n, int base);
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+};
+
+/** The console: stdin/stdout or a pseudo-terminal (nativeSerialOpen()). */
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baud, uint32_t config = 0, int8_t rxPin = -1, int8_t txPin = -1) { rate = baud; }
+  void end() {}
+  void updateBaudRate(unsigned long baud) { rate = baud; }
+  uint32_t baudRate() const { return rate; }
+  size_t setRxBufferSize(size_t size) { return size; }
+  size_t setTxBufferSize(size_t size) { return size; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override;
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *data, size_t len) override;
+  using Print::write;
+
+  operator bool() const { return true; }
+
+private:
+  uint32_t rate = 0;
+};
+
+extern HardwareSerial Serial;
+
+// ============================================================
+// CORE FUNCTIONS
+// ============================================================
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+/** Runs on whichever thread calls nativeGpioWrite(). */
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t pin, void (*fn)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*fn)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+uint16_t analogRead(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+void analogSetAttenuation(adc_attenuation_t attenuation);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// ============================================================
+// HARDWARE TIMER
+// ============================================================
+
+/** One alarm on the virtual clock; the "ISR" runs on the clock thread. */
+struct hw_timer_t;
+
+hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool countUp);
+void timerEnd(hw_timer_t *timer);
+void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(void), bool edge);
+void timerAlarmWrite(hw_timer_t *timer, uint64_t alarmValue, bool autoreload);
+void timerAlarmEnable(hw_timer_t *timer);
+void timerAlarmDisable(hw_timer_t *timer);
+void timerWrite(hw_timer_t *timer, uint64_t value);
+
+// ============================================================
+// ESP
+// ============================================================
+
+class EspClass {
+public:
+  /** Host nanoseconds (wall clock, not virtual): one cycle at NATIVE_CPU_MHZ. */
+  uint32_t getCycleCount();
+  uint32_t getCpuFreqMHz();
+  uint64_t getEfuseMac();
+  uint32_t getFreeHeap() { return 0; }      // No heap accounting on the host
+  uint32_t getMinFreeHeap() { return 0; }
+  void restart();
+};
+
+extern EspClass ESP;
+
+/** No PSRAM on the host (esp32-hal-psram.h). */
+bool psramFound();
+void *ps_malloc(size_t size);
+
+/** Recorded for STATUS only: host code does not get slower. */
+bool setCpuFrequencyMhz(uint32_t mhz);
+uint32_t getCpuFrequencyMhz();
@@ -0,0 +1,39 @@
+/*
+ * CortexKey firmware - host-native NVS (Preferences) subset
+ *
+ * Namespaces live in process memory, so every run boots with empty NVS.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false);
+  void end();
+
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+
+  size_t putBytes(const char *key, const void *value, size_t len);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+  size_t getBytesLength(const char *key);
+
+  size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return getValue(key, defaultValue); }
+  size_t putUChar(const char *key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+  uint8_t getUChar(const char *key, uint8_t defaultValue = 0) { return getValue(key, defaultValue); }
+  size_t putBool(const char *key, bool value) { return putUChar(key, value ? 1 : 0); }
+  bool getBool(const char *key, bool defaultValue = false) { return getUChar(key, defaultValue ? 1 : 0) != 0; }
+
+private:
+  template <typename T> T getValue(const char *key, T defaultValue) {
+    T value;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+  }
+
+  const char *ns = nullptr;
+  bool readOnly = false;
+};
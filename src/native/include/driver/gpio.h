@@ -0,0 +1,30 @@
+/*
+ * CortexKey firmware - host-native GPIO driver subset
+ *
+ * Interrupt type and enable act on the handlers attachInterrupt() set up;
+ * wake-up levels are checked by esp_light_sleep_start().
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum {
+  GPIO_NUM_0 = 0, GPIO_NUM_18 = 18, GPIO_NUM_19 = 19, GPIO_NUM_34 = 34, GPIO_NUM_MAX = 40,
+} gpio_num_t;
+
+typedef enum {
+  GPIO_INTR_DISABLE,
+  GPIO_INTR_POSEDGE,
+  GPIO_INTR_NEGEDGE,
+  GPIO_INTR_ANYEDGE,
+  GPIO_INTR_LOW_LEVEL,
+  GPIO_INTR_HIGH_LEVEL,
+} gpio_int_type_t;
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type);
+esp_err_t gpio_intr_enable(gpio_num_t pin);
+esp_err_t gpio_intr_disable(gpio_num_t pin);
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type);
+esp_err_t gpio_wakeup_disable(gpio_num_t pin);
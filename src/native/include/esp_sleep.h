@@ -0,0 +1,27 @@
+/*
+ * CortexKey firmware - host-native light sleep subset
+ *
+ * esp_light_sleep_start() blocks the caller on the virtual clock until an
+ * enabled source fires. As on the chip, the console byte that wakes it
+ * is swallowed.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef enum {
+  ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+  ESP_SLEEP_WAKEUP_TIMER = 4,
+  ESP_SLEEP_WAKEUP_GPIO = 7,
+  ESP_SLEEP_WAKEUP_UART = 8,
+} esp_sleep_source_t;
+
+typedef esp_sleep_source_t esp_sleep_wakeup_cause_t;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us);
+esp_err_t esp_sleep_enable_gpio_wakeup();
+esp_err_t esp_sleep_enable_uart_wakeup(int uart);
+esp_err_t esp_light_sleep_start();
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
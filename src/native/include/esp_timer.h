@@ -0,0 +1,19 @@
+/*
+ * CortexKey firmware - host-native esp_timer subset
+ *
+ * esp_timer_get_time() reads the virtual clock (hal_native.h): the
+ * 64-bit microseconds since boot that the chip keeps across light sleep.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int64_t esp_timer_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
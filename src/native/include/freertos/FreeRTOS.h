@@ -0,0 +1,24 @@
+/*
+ * CortexKey firmware - host-native FreeRTOS subset (types and macros)
+ *
+ * One tick is 1 ms of virtual time, as with CONFIG_FREERTOS_HZ=1000.
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE  0
+#define pdTRUE   1
+#define pdPASS   pdTRUE
+#define pdFAIL   pdFALSE
+
+#define portMAX_DELAY        ((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS   1
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(ms))
+#define configMAX_PRIORITIES 25
+
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
@@ -0,0 +1,18 @@
+/*
+ * CortexKey firmware - host-native FreeRTOS queue subset
+ *
+ * Fixed-size items copied in and out under the kernel lock; a blocking
+ * receive waits on the virtual clock like any other timeout.
+ */
+#pragma once
+
+#include "FreeRTOS.h"
+
+struct NativeQueue;
+typedef NativeQueue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait);
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
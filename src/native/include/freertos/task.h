@@ -0,0 +1,23 @@
+/*
+ * CortexKey firmware - host-native FreeRTOS task subset
+ *
+ * Tasks are threads; priorities and core affinity are accepted and
+ * ignored. Notifications, delays and timeouts use the virtual clock.
+ */
+#pragma once
+
+#include "FreeRTOS.h"
+
+struct NativeTask;
+typedef NativeTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken);
@@ -0,0 +1,27 @@
+/*
+ * CortexKey firmware - host-native FreeRTOS software timer subset
+ *
+ * Callbacks run one after another on a timer service task, as with the
+ * FreeRTOS daemon task. Commands take effect at once, so the block time
+ * arguments are ignored.
+ */
+#pragma once
+
+#include "FreeRTOS.h"
+
+struct NativeTimer;
+typedef NativeTimer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *id,
+                           TimerCallbackFunction_t callback);
+void *pvTimerGetTimerID(TimerHandle_t timer);
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticksToWait);
+
+BaseType_t xTimerStartFromISR(TimerHandle_t timer, BaseType_t *higherPriorityTaskWoken);
+BaseType_t xTimerStopFromISR(TimerHandle_t timer, BaseType_t *higherPriorityTaskWoken);
+BaseType_t xTimerResetFromISR(TimerHandle_t timer, BaseType_t *higherPriorityTaskWoken);
@@ -0,0 +1,147 @@
+/*
+ * CortexKey firmware - host-native entry point
+ *
+ * Runs the unmodified firmware (setup() then loop(), as Arduino's
+ * loopTask does) on the console given on the command line:
+ *
+ *   .pio/build/native/program                      stdin/stdout
+ *   .pio/build/native/program --pty                pseudo-terminal; the slave
+ *                                                  path goes to stderr, for
+ *                                                  POST /api/serial/connect
+ *   .pio/build/native/program --speed 100 --pty    stream at 100x real time
+ *   .pio/build/native/program --speed 0 --exec "BINARY" --exec "START"
+ *                             --seconds 600 > stream.bin
+ *                                                  10 simulated minutes as
+ *                                                  fast as the host allows
+ *
+ *   --speed X     virtual-time factor while streaming (1; 0 = unthrottled)
+ *   --exec CMD    feed CMD as a console line at boot (repeatable)
+ *   --seconds N   exit after N virtual seconds
+ *   --press PIN@SEC[+MS]
+ *                 press a button at SEC virtual seconds for MS ms (100),
+ *                 with contact bounce (repeatable; 18 = valid, 19 = invalid)
+ */
+#include <Arduino.h>
+
+#include <pty.h>
+#include <stdio.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "hal_native.h"
+
+#define PRESS_MAX       8
+#define PRESS_HOLD_MS   100
+#define BOUNCE_EDGES    4         // Extra edges, 1 ms apart, after each transition
+
+void setup();
+void loop();
+
+struct Press {
+  uint8_t pin;
+  uint32_t atMs;
+  uint32_t holdMs;
+};
+
+static Press presses[PRESS_MAX];
+static uint8_t pressCount = 0;
+
+/** Settles at level after BOUNCE_EDGES (even) chatter edges. */
+static void bounce(uint8_t pin, uint8_t level) {
+  nativeGpioWrite(pin, level);
+  for (uint8_t i = 0; i < BOUNCE_EDGES; i++) {
+    delay(1);
+    nativeGpioWrite(pin, (i & 1) ? level : !level);
+  }
+}
+
+/** Plays one scripted press on the virtual clock. */
+static void pressTask(void *arg) {
+  const Press &p = *(const Press *)arg;
+  delay(p.atMs);
+  bounce(p.pin, LOW);
+  delay(p.holdMs);
+  bounce(p.pin, HIGH);
+}
+
+static bool parsePress(const char *text) {
+  Press p = {0, 0, PRESS_HOLD_MS};
+  char *end;
+  p.pin = (uint8_t)strtoul(text, &end, 10);
+  if (*end != '@' || pressCount >= PRESS_MAX) return false;
+  p.atMs = (uint32_t)(strtod(end + 1, &end) * 1000);
+  if (*end == '+') p.holdMs = (uint32_t)strtoul(end + 1, &end, 10);
+  if (*end != '\0') return false;
+  presses[pressCount++] = p;
+  return true;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "usage: %s [--pty] [--speed X] [--exec CMD]... [--seconds N] [--press PIN@SEC[+MS]]...\n",
+          argv0);
+  exit(2);
+}
+
+/** Raw pty, so binary frames pass through the line discipline untouched. */
+static bool openPty() {
+  int master, slave;
+  char name[64];
+  if (openpty(&master, &slave, name, nullptr, nullptr) < 0) {
+    perror("openpty");
+    return false;
+  }
+  struct termios tio;
+  tcgetattr(slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+  // The slave fd stays open, so output queues (and then blocks) instead of
+  // failing while no client is attached
+  fprintf(stderr, "[native] Serial on %s\n", name);
+  nativeSerialOpen(master, master);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  bool usePty = false;
+  double speed = 1.0;
+  double seconds = 0.0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (strcmp(arg, "--pty") == 0) {
+      usePty = true;
+    } else if (strcmp(arg, "--speed") == 0 && hasValue) {
+      speed = atof(argv[++i]);
+    } else if (strcmp(arg, "--seconds") == 0 && hasValue) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(arg, "--exec") == 0 && hasValue) {
+      nativeSerialInject(argv[++i]);
+      nativeSerialInject("\n");
+    } else if (strcmp(arg, "--press") == 0 && hasValue) {
+      if (!parsePress(argv[++i])) usage(argv[0]);
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  if (usePty) {
+    if (!openPty()) return 1;
+  } else {
+    nativeSerialOpen(STDIN_FILENO, STDOUT_FILENO);
+  }
+
+  nativeSetSpeed(speed);
+  if (seconds > 0.0) {
+    nativeSetRunLimitUs((uint64_t)(seconds * 1e6));
+  }
+  nativeBegin();
+
+  setup();
+  for (uint8_t i = 0; i < pressCount; i++) {
+    xTaskCreatePinnedToCore(pressTask, "press", 0, &presses[i], 1, nullptr, 0);
+  }
+  for (;;) {
+    loop();
+  }
+}
@@ -0,0 +1,53 @@
+/*
+ * CortexKey firmware - runtime performance counters
+ */
+#include "perf.h"
+
+static uint32_t cyclesPerUs = 240;
+
+void perfBegin() {
+  cyclesPerUs = ESP.getCpuFreqMHz();
+}
+
+uint32_t perfCyclesToUs(uint32_t cycles) {
+  return cycles / cyclesPerUs;
+}
+
+void PerfHistogram::reset() {
+  memset(buckets, 0, sizeof(buckets));
+  n = 0;
+  lo = 0;
+  hi = 0;
+  sum = 0;
+}
+
+void PerfHistogram::add(uint32_t us) {
+  uint8_t b = us ? 32 - __builtin_clz(us) : 0;
+  if (b >= PERF_BUCKETS) b = PERF_BUCKETS - 1;
+  buckets[b]++;
+  if (n == 0 || us < lo) lo = us;
+  if (us > hi) hi = us;
+  sum += us;
+  n++;
+}
+
+uint32_t PerfHistogram::percentile(uint8_t pct) const {
+  if (n == 0) {
+    return 0;
+  }
+  uint32_t target = ((uint64_t)n * pct + 99) / 100;
+  uint32_t below = 0;
+  for (uint8_t b = 0; b < PERF_BUCKETS; b++) {
+    if (below + buckets[b] < target) {
+      below += buckets[b];
+      continue;
+    }
+    // Bucket edges narrowed to the observed range
+    uint32_t lower = b ? 1u << (b - 1) : 0;
+    uint32_t upper = (b == PERF_BUCKETS - 1) ? hi : (1u << b) - 1;
+    if (lower < lo) lower = lo;
+    if (upper > hi) upper = hi;
+    return lower + (uint64_t)(upper - lower) * (target - below) / buckets[b];
+  }
+  return hi;
+}
@@ -0,0 +1,53 @@
+/*
+ * CortexKey firmware - runtime performance counters
+ *
+ * Sections are timed with the per-core cycle counter (ESP.getCycleCount()),
+ * so a measurement is two register reads and one divide. Each counter is
+ * written by exactly one task; a reader on the other core may see an
+ * update half-applied, which is harmless for telemetry. Resets are
+ * requested, not performed, across cores (samplerPerfReset()).
+ *
+ * Histogram buckets are log2 microseconds: bucket 0 is [0, 1) us, bucket
+ * i is [2^(i-1), 2^i) us and the last one is open-ended.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define PERF_BUCKETS  16
+
+/** Cache the CPU clock used to convert cycles. Call again after a clock change. */
+void perfBegin();
+
+uint32_t perfCyclesToUs(uint32_t cycles);
+
+/** Cycles since start (same core) in microseconds. */
+static inline uint32_t perfElapsedUs(uint32_t startCycles) {
+  return perfCyclesToUs(ESP.getCycleCount() - startCycles);
+}
+
+static inline uint32_t perfCycles() { return ESP.getCycleCount(); }
+
+/** Min / avg / max and a log2 histogram of microsecond durations. */
+class PerfHistogram {
+public:
+  void reset();
+  void add(uint32_t us);
+
+  uint32_t count() const { return n; }
+  uint32_t min() const { return n ? lo : 0; }
+  uint32_t max() const { return hi; }
+  uint32_t avg() const { return n ? (uint32_t)(sum / n) : 0; }
+
+  /** Value below which pct % of the samples fall, interpolated in its bucket. */
+  uint32_t percentile(uint8_t pct) const;
+
+  uint32_t bucket(uint8_t i) const { return buckets[i]; }
+
+private:
+  uint32_t buckets[PERF_BUCKETS] = {};
+  uint32_t n = 0;
+  uint32_t lo = 0;
+  uint32_t hi = 0;
+  uint64_t sum = 0;
+};
@@ -0,0 +1,114 @@
+/*
+ * CortexKey firmware - compile-time acquisition pipeline
+ *
+ * Pipeline<Source, Stages...> is the acquisition task's per-tick chain,
+ * composed by type: the source produces one sample set, then every
+ * stage runs on it in order. Each call is resolved at compile time and
+ * inlined into acquire(), so a tick costs one call from the sampler (its
+ * SampleSource pointer) and no virtual dispatch.
+ *
+ * A Source provides
+ *   void begin(uint32_t rate)               new rate; sampler stopped
+ *   void reset()                            stream start, on its first tick
+ *   uint8_t read(float *values)             channels produced, 0 on a
+ *                                           tick that completes no sample
+ * and a stage
+ *   void reset()                            stream start
+ *   void configure(uint32_t rate)           (re)design for rate, fresh state
+ *   void process(float *values, uint8_t channels, uint8_t &artifact)
+ *
+ * Runtime options of a stage (FILTER ON|OFF) stay fields of the stage,
+ * reached through stage<T>(). The comms task never touches stage state
+ * directly: requestReset() and requestConfigure() are applied by the
+ * acquisition task on its next tick (atomic flags: a request that
+ * arrives while the previous one is being applied is not lost).
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+#include "sampler.h"
+
+template <typename... Stages>
+class StageChain;
+
+template <>
+class StageChain<> {
+public:
+  void reset() {}
+  void configure(uint32_t) {}
+  inline void process(float *, uint8_t, uint8_t &) {}
+};
+
+template <typename First, typename... Rest>
+class StageChain<First, Rest...> {
+public:
+  void reset() {
+    first.reset();
+    rest.reset();
+  }
+
+  void configure(uint32_t rate) {
+    first.configure(rate);
+    rest.configure(rate);
+  }
+
+  inline void process(float *values, uint8_t channels, uint8_t &artifact) {
+    first.process(values, channels, artifact);
+    rest.process(values, channels, artifact);
+  }
+
+  First first;
+  StageChain<Rest...> rest;
+};
+
+/** Stage of type T in a chain (the first one, if it appears twice). */
+template <typename T, typename Chain>
+struct StageGet;
+
+template <typename T, typename... Rest>
+struct StageGet<T, StageChain<T, Rest...> > {
+  static T &get(StageChain<T, Rest...> &chain) { return chain.first; }
+};
+
+template <typename T, typename First, typename... Rest>
+struct StageGet<T, StageChain<First, Rest...> > {
+  static T &get(StageChain<First, Rest...> &chain) {
+    return StageGet<T, StageChain<Rest...> >::get(chain.rest);
+  }
+};
+
+template <typename Source, typename... Stages>
+class Pipeline {
+public:
+  template <typename T>
+  T &stage() { return StageGet<T, StageChain<Stages...> >::get(stages); }
+
+  /** Restart source and stages on the next tick (beginStream()). */
+  void requestReset() { resetPending.store(true); }
+
+  /** Reconfigure every stage for samplerRate() on the next tick. */
+  void requestConfigure() { configPending.store(true); }
+
+  /** One sampler tick; the SampleSource contract (sampler.h). */
+  inline uint8_t acquire(uint32_t, float *values, uint8_t &artifact) {
+    if (resetPending.exchange(false)) {
+      source.reset();
+      stages.reset();
+    }
+    if (configPending.exchange(false)) {
+      stages.configure(samplerRate());
+    }
+    uint8_t channels = source.read(values);
+    stages.process(values, channels, artifact);
+    return channels;
+  }
+
+  Source source;
+  StageChain<Stages...> stages;
+
+private:
+  std::atomic<bool> resetPending{true};
+  std::atomic<bool> configPending{true};
+};
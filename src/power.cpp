@@ -0,0 +1,126 @@
+/*
+ * CortexKey firmware - power manager
+ */
+#include "power.h"
+
+#include <driver/uart.h>
+#include <esp_sleep.h>
+
+#include "buttons.h"
+#include "perf.h"
+
+// ============================================================
+// STATE
+// ============================================================
+static PowerPolicy policy = POWER_ECO;
+static uint32_t cpuMhz = 0;
+static uint32_t lastActivityMs = 0;
+static uint32_t sleeps = 0;
+static uint32_t sleptMs = 0;
+
+// ============================================================
+// CLOCK
+// ============================================================
+
+static void setClock(uint32_t mhz) {
+  if (mhz != cpuMhz && setCpuFrequencyMhz(mhz)) {
+    cpuMhz = getCpuFrequencyMhz();
+    perfBegin();                    // Cycles per microsecond changed
+  }
+}
+
+static uint32_t idleMhz() {
+  return policy == POWER_MAX ? POWER_MAX_MHZ : POWER_MIN_MHZ;
+}
+
+static uint32_t streamMhz(uint32_t conversionsPerSec, bool heavyDsp) {
+  if (policy == POWER_MAX || conversionsPerSec > POWER_LOAD_160MHZ) {
+    return POWER_MAX_MHZ;
+  }
+  if (conversionsPerSec > POWER_LOAD_MIN_MHZ || heavyDsp) {
+    return 160;
+  }
+  return POWER_MIN_MHZ;
+}
+
+// ============================================================
+// PUBLIC API
+// ============================================================
+
+void powerBegin() {
+  cpuMhz = getCpuFrequencyMhz();
+  setClock(idleMhz());
+  powerActivity();
+}
+
+void powerSetPolicy(PowerPolicy p) {
+  policy = p;
+}
+
+PowerPolicy powerPolicy() {
+  return policy;
+}
+
+const char *powerPolicyName() {
+  return policy == POWER_MAX ? "MAX" : "ECO";
+}
+
+uint32_t powerCpuMhz() {
+  return cpuMhz;
+}
+
+void powerStreamStart(uint32_t conversionsPerSec, bool heavyDsp) {
+  setClock(streamMhz(conversionsPerSec, heavyDsp));
+}
+
+void powerStreamStop() {
+  setClock(idleMhz());
+  powerActivity();
+}
+
+void powerBoost(bool on) {
+  setClock(on ? POWER_MAX_MHZ : idleMhz());
+}
+
+void powerActivity() {
+  lastActivityMs = millis();
+}
+
+bool powerIdleSleep() {
+  if (policy != POWER_ECO || millis() - lastActivityMs < POWER_SLEEP_AFTER_MS) {
+    return false;
+  }
+  if (Serial.available() > 0 || !buttonsIdle()) {
+    powerActivity();
+    return false;
+  }
+#if WIFI_ENABLED
+  return false;                     // Light sleep would drop the Wi-Fi association
+#else
+  Serial.flush();                   // The UART stops mid-byte otherwise
+  buttonsSleepArm();
+  esp_sleep_enable_timer_wakeup((uint64_t)POWER_SLEEP_MAX_MS * 1000);
+  esp_sleep_enable_gpio_wakeup();
+  uart_set_wakeup_threshold(UART_NUM_0, POWER_UART_WAKE_EDGES);
+  esp_sleep_enable_uart_wakeup(UART_NUM_0);
+
+  uint32_t start = millis();        // esp_timer (and millis()) is corrected after light sleep
+  esp_light_sleep_start();
+  sleptMs += millis() - start;
+  sleeps++;
+
+  buttonsSleepDone();
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER) {
+    powerActivity();                // Stay awake for the command or press that woke us
+  }
+  return true;
+#endif
+}
+
+uint32_t powerSleepCount() {
+  return sleeps;
+}
+
+uint32_t powerSleptMs() {
+  return sleptMs;
+}
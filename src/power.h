@@ -0,0 +1,59 @@
+/*
+ * CortexKey firmware - power manager
+ *
+ * Dynamic frequency scaling plus light sleep while idle. In MODE_IDLE the
+ * CPU runs at POWER_MIN_MHZ, and once nothing has happened for
+ * POWER_SLEEP_AFTER_MS the comms task puts the chip into light sleep
+ * until UART RX, a GPIO18/19 press or the POWER_SLEEP_MAX_MS timer wakes
+ * it. The character that wakes the UART is lost, so a host sends a
+ * newline first and waits a few milliseconds (blank lines are ignored).
+ *
+ * A stream runs at the lowest clock its load allows: the ADC conversion
+ * rate (rate x oversampling x channels) and whether the comms task does
+ * heavy DSP (filter, features, compression).
+ *
+ * The clock changes only while the sampler is stopped, and every change
+ * re-reads the cycle counter rate for perf.h.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+enum PowerPolicy : uint8_t {
+  POWER_ECO,    // DFS + idle light sleep (default)
+  POWER_MAX,    // POWER_MAX_MHZ always, never sleeps
+};
+
+/** Drop to the idle clock. Call from setup() once Serial is up. */
+void powerBegin();
+
+void powerSetPolicy(PowerPolicy policy);
+PowerPolicy powerPolicy();
+const char *powerPolicyName();
+
+/** Current CPU clock in MHz. */
+uint32_t powerCpuMhz();
+
+/** Pick the stream clock; call before samplerStart(). */
+void powerStreamStart(uint32_t conversionsPerSec, bool heavyDsp);
+
+/** Back to the idle clock; the idle timeout restarts. */
+void powerStreamStop();
+
+/** POWER_MAX_MHZ while on (BENCH), policy clock after. Idle only. */
+void powerBoost(bool on);
+
+/** A command or button event: postpones the next light sleep. */
+void powerActivity();
+
+/**
+ * Light-sleep now if the policy allows and the idle timeout has passed.
+ * Idle only; the caller checks for pending work. Returns true after a sleep.
+ */
+bool powerIdleSleep();
+
+/** Light sleeps since boot and the time spent in them. */
+uint32_t powerSleepCount();
+uint32_t powerSleptMs();
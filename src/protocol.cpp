@@ -0,0 +1,366 @@
+/*
+ * CortexKey firmware - binary sample framing
+ */
+#include "protocol.h"
+
+// ============================================================
+// ASCII
+// ============================================================
+
+static char *formatUnsigned(char *out, uint32_t v) {
+  char tmp[10];
+  int n = 0;
+  do {
+    tmp[n++] = '0' + (v % 10);
+    v /= 10;
+  } while (v);
+  while (n) {
+    *out++ = tmp[--n];
+  }
+  return out;
+}
+
+static char *formatMilli(char *p, float value) {
+  float scaled = value * 1000.0f;
+  if (scaled > 8388607.0f) scaled = 8388607.0f;
+  if (scaled < -8388607.0f) scaled = -8388607.0f;
+  int32_t milli = (int32_t)(scaled + (scaled >= 0 ? 0.5f : -0.5f));
+  if (milli < 0) {
+    *p++ = '-';
+    milli = -milli;
+  }
+  p = formatUnsigned(p, milli / 1000);
+  *p++ = '.';
+  uint32_t frac = milli % 1000;
+  *p++ = '0' + frac / 100;
+  *p++ = '0' + (frac / 10) % 10;
+  *p++ = '0' + frac % 10;
+  return p;
+}
+
+size_t formatAsciiSample(char *out, uint32_t timestampMs, const float *values, uint8_t channels) {
+  char *p = out;
+  memcpy(p, "DATA,", 5);
+  p += 5;
+  p = formatUnsigned(p, timestampMs);
+  for (uint8_t ch = 0; ch < channels; ch++) {
+    *p++ = ',';
+    p = formatMilli(p, values[ch]);
+  }
+  *p++ = '\r';
+  *p++ = '\n';
+  return p - out;
+}
+
+size_t formatStatsLine(char *out, const LinkStats &stats) {
+  const uint32_t fields[STATS_FIELDS] = {stats.index, stats.sent, stats.overruns,
+                                         stats.txDrops, stats.backlogPeak, stats.timeUs};
+  char *p = out;
+  memcpy(p, "STATS:", 6);
+  p += 6;
+  for (uint8_t i = 0; i < STATS_FIELDS; i++) {
+    if (i) *p++ = ',';
+    p = formatUnsigned(p, fields[i]);
+  }
+  *p++ = '\r';
+  *p++ = '\n';
+  return p - out;
+}
+
+// ============================================================
+// CRC
+// ============================================================
+
+// Nibble table for poly 0x1021: 32 bytes of flash instead of 512.
+static const uint16_t CRC16_NIBBLE[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc) {
+  while (len--) {
+    uint8_t b = *data++;
+    crc = (crc << 4) ^ CRC16_NIBBLE[(crc >> 12) ^ (b >> 4)];
+    crc = (crc << 4) ^ CRC16_NIBBLE[(crc >> 12) ^ (b & 0x0F)];
+  }
+  return crc;
+}
+
+// ============================================================
+// HEADER
+// ============================================================
+
+/**
+ * Write the 10-byte header (count 0) and, with FRAME_FLAG_TIMESTAMP, the
+ * time_us field. Returns the payload offset.
+ */
+static size_t writeHeader(uint8_t *out, uint8_t type, uint8_t flags, uint16_t seq,
+                          uint16_t dtUs, uint8_t channels, uint64_t timeUs) {
+  out[0] = FRAME_SYNC0;
+  out[1] = FRAME_SYNC1;
+  out[2] = type;
+  out[3] = flags;
+  out[4] = seq & 0xFF;
+  out[5] = seq >> 8;
+  out[6] = dtUs & 0xFF;
+  out[7] = dtUs >> 8;
+  out[8] = 0;
+  out[9] = channels;
+  if (!(flags & FRAME_FLAG_TIMESTAMP)) {
+    return FRAME_HEADER_SIZE;
+  }
+  memcpy(out + FRAME_HEADER_SIZE, &timeUs, FRAME_TIME_SIZE);   // Xtensa is little-endian
+  return FRAME_HEADER_SIZE + FRAME_TIME_SIZE;
+}
+
+// ============================================================
+// SAMPLE FRAME ENCODER
+// ============================================================
+
+/** Scale, round to nearest and saturate to [-limit - 1, limit]. */
+static inline int32_t quantize(float value, float scale, int32_t limit) {
+  float scaled = value * scale;
+  if (scaled >= (float)limit) return limit;
+  if (scaled <= (float)(-limit - 1)) return -limit - 1;
+  return (int32_t)(scaled + (scaled >= 0 ? 0.5f : -0.5f));
+}
+
+void SampleFrameEncoder::begin(uint8_t flags, uint16_t seq, uint16_t dtUs, uint8_t channels,
+                               uint64_t timeUs) {
+  sampleBytes = (flags & FRAME_FLAG_INT24) ? 3 : 2;
+  chans = channels ? channels : 1;
+  inSet = 0;
+  sets = 0;
+  len = writeHeader(buf, FRAME_TYPE_SAMPLES, flags, seq, dtUs, chans, timeUs);
+}
+
+uint8_t SampleFrameEncoder::capacity() const {
+  size_t sets = FRAME_MAX_PAYLOAD / (sampleBytes * chans);
+  return sets > 255 ? 255 : sets;
+}
+
+bool SampleFrameEncoder::add(float value) {
+  if (inSet == 0 && sets >= capacity()) {
+    return false;
+  }
+
+  if (sampleBytes == 2) {
+    int32_t q = quantize(value, 10.0f, 32767);
+    buf[len++] = q & 0xFF;
+    buf[len++] = (q >> 8) & 0xFF;
+  } else {
+    int32_t q = quantize(value, 1000.0f, 8388607);
+    buf[len++] = q & 0xFF;
+    buf[len++] = (q >> 8) & 0xFF;
+    buf[len++] = (q >> 16) & 0xFF;
+  }
+
+  if (++inSet == chans) {
+    inSet = 0;
+    sets++;
+  }
+  return true;
+}
+
+size_t SampleFrameEncoder::finish() {
+  buf[8] = sets;
+  uint16_t crc = crc16(buf + 2, len - 2);
+  buf[len++] = crc & 0xFF;
+  buf[len++] = crc >> 8;
+  return len;
+}
+
+// ============================================================
+// COMPRESSED FRAMES
+// ============================================================
+
+void CompressedFrameEncoder::reset() {
+  for (uint8_t ch = 0; ch < EEG_MAX_CHANNELS; ch++) {
+    riceK[ch] = RICE_DEFAULT_K;
+  }
+}
+
+void CompressedFrameEncoder::begin(uint8_t flags, uint16_t seq, uint16_t dtUs, uint8_t channels,
+                                   uint8_t order, uint64_t timeUs) {
+  sampleBytes = (flags & FRAME_FLAG_INT24) ? 3 : 2;
+  chans = (channels && channels <= EEG_MAX_CHANNELS) ? channels : 1;
+  predictor = (order == 2) ? 2 : 1;
+  if (predictor == 2) flags |= FRAME_FLAG_DELTA2;
+  inSet = 0;
+  sets = 0;
+  bitAcc = 0;
+  bitCount = 0;
+  residuals = 0;
+
+  payloadStart = writeHeader(buf, FRAME_TYPE_COMPRESSED, flags, seq, dtUs, chans, timeUs);
+  len = payloadStart;
+  buf[len++] = 0;                     // Payload length, set by finish()
+  for (uint8_t ch = 0; ch < chans; ch++) {
+    buf[len++] = riceK[ch];
+    sumU[ch] = 0;
+  }
+}
+
+void CompressedFrameEncoder::putBits(uint32_t value, uint8_t bits) {
+  while (bits) {
+    uint8_t n = bits > 8 ? 8 : bits;
+    bits -= n;
+    bitAcc = (bitAcc << n) | ((value >> bits) & ((1u << n) - 1));
+    bitCount += n;
+    if (bitCount >= 8) {
+      bitCount -= 8;
+      buf[len++] = bitAcc >> bitCount;
+    }
+  }
+}
+
+void CompressedFrameEncoder::putResidual(int32_t residual, uint8_t k) {
+  uint32_t u = ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);   // Zig-zag
+  uint32_t q = u >> k;
+  if (q >= RICE_ESCAPE) {
+    putBits(0xFFFFFFFF, RICE_ESCAPE);
+    putBits(u, 32);
+  } else {
+    putBits(0xFFFFFFFF, q);
+    putBits(0, 1);
+    putBits(u, k);
+  }
+}
+
+bool CompressedFrameEncoder::full() const {
+  // Worst case per residual: escape run + raw 32 bits
+  size_t usedBits = (len - payloadStart) * 8 + bitCount;
+  size_t worstSet = (size_t)chans * (RICE_ESCAPE + 32);
+  return sets == 255 || usedBits + worstSet > FRAME_MAX_PAYLOAD * 8;
+}
+
+bool CompressedFrameEncoder::add(float value) {
+  if (inSet == 0 && full()) {
+    return false;
+  }
+
+  int32_t x = (sampleBytes == 2) ? quantize(value, 10.0f, 32767)
+                                 : quantize(value, 1000.0f, 8388607);
+  const uint8_t ch = inSet;
+  if (sets == 0) {
+    // Seed at full width
+    buf[len++] = x & 0xFF;
+    buf[len++] = (x >> 8) & 0xFF;
+    if (sampleBytes == 3) {
+      buf[len++] = (x >> 16) & 0xFF;
+    }
+    prev2[ch] = x;
+  } else {
+    int32_t predicted = (predictor == 2 && sets > 1) ? 2 * prev1[ch] - prev2[ch] : prev1[ch];
+    int32_t residual = x - predicted;
+    putResidual(residual, riceK[ch]);
+    sumU[ch] += ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);
+    prev2[ch] = prev1[ch];
+  }
+  prev1[ch] = x;
+
+  if (++inSet == chans) {
+    inSet = 0;
+    if (sets > 0) residuals++;
+    sets++;
+  }
+  return true;
+}
+
+size_t CompressedFrameEncoder::finish() {
+  if (bitCount) {
+    putBits(0, 8 - bitCount);
+  }
+  buf[payloadStart] = len - payloadStart;
+  buf[8] = sets;
+
+  // Next frame's k: floor(log2(mean u)), the usual Rice estimate
+  if (residuals) {
+    for (uint8_t ch = 0; ch < chans; ch++) {
+      uint8_t k = 0;
+      while (k < RICE_MAX_K && ((uint64_t)residuals << (k + 1)) <= sumU[ch]) k++;
+      riceK[ch] = k;
+    }
+  }
+
+  uint16_t crc = crc16(buf + 2, len - 2);
+  buf[len++] = crc & 0xFF;
+  buf[len++] = crc >> 8;
+  return len;
+}
+
+// ============================================================
+// FEATURE FRAMES
+// ============================================================
+
+size_t encodeFeatureFrame(uint8_t *out, uint16_t seq, uint16_t dtUs, uint32_t index,
+                          const float *features, uint8_t count, uint8_t flags,
+                          uint64_t timeUs) {
+  size_t len = writeHeader(out, FRAME_TYPE_FEATURES, flags, seq, dtUs, count, timeUs);
+  out[8] = 1;
+
+  memcpy(out + len, &index, sizeof(index));      // Xtensa is little-endian
+  len += sizeof(index);
+  memcpy(out + len, features, count * sizeof(float));
+  len += count * sizeof(float);
+
+  uint16_t crc = crc16(out + 2, len - 2);
+  out[len++] = crc & 0xFF;
+  out[len++] = crc >> 8;
+  return len;
+}
+
+/** Header (count 1, dt_us 0) + fields uint32 words + CRC: stats and perf records. */
+static size_t encodeRecordFrame(uint8_t *out, uint8_t type, uint16_t seq,
+                                const void *fields, uint8_t words) {
+  size_t len = writeHeader(out, type, 0, seq, 0, words, 0);
+  out[8] = 1;
+
+  memcpy(out + len, fields, words * sizeof(uint32_t));      // Xtensa is little-endian
+  len += words * sizeof(uint32_t);
+
+  uint16_t crc = crc16(out + 2, len - 2);
+  out[len++] = crc & 0xFF;
+  out[len++] = crc >> 8;
+  return len;
+}
+
+size_t encodeStatsFrame(uint8_t *out, uint16_t seq, const LinkStats &stats) {
+  static_assert(sizeof(LinkStats) == STATS_FIELDS * sizeof(uint32_t), "LinkStats is packed uint32");
+  return encodeRecordFrame(out, FRAME_TYPE_STATS, seq, &stats, STATS_FIELDS);
+}
+
+size_t encodePerfFrame(uint8_t *out, uint16_t seq, const PerfReport &report) {
+  static_assert(sizeof(PerfReport) == PERF_FIELDS * sizeof(uint32_t), "PerfReport is packed uint32");
+  static_assert(sizeof(PerfReport) <= FRAME_MAX_PAYLOAD, "PerfReport fits one frame");
+  return encodeRecordFrame(out, FRAME_TYPE_PERF, seq, &report, PERF_FIELDS);
+}
+
+size_t encodeConfigFrame(uint8_t *out, uint16_t seq, const DeviceConfig &config) {
+  static_assert(sizeof(DeviceConfig) == CONFIG_FIELDS * sizeof(uint32_t), "DeviceConfig is packed uint32");
+  static_assert(sizeof(DeviceConfig) <= FRAME_MAX_PAYLOAD, "DeviceConfig fits one frame");
+  return encodeRecordFrame(out, FRAME_TYPE_CONFIG, seq, &config, CONFIG_FIELDS);
+}
+
+size_t encodeSessionFrame(uint8_t *out, uint16_t seq, const SessionRecord &record) {
+  static_assert(sizeof(SessionRecord) == SESSION_FIELDS * sizeof(uint32_t), "SessionRecord is packed uint32");
+  return encodeRecordFrame(out, FRAME_TYPE_SESSION, seq, &record, SESSION_FIELDS);
+}
+
+size_t recordFrameSize(const uint8_t *header) {
+  return FRAME_HEADER_SIZE + (size_t)header[8] * header[9] * sizeof(uint32_t) + FRAME_CRC_SIZE;
+}
+
+bool decodeConfigFrame(const uint8_t *frame, size_t len, DeviceConfig &config) {
+  if (len != FRAME_HEADER_SIZE + sizeof(DeviceConfig) + FRAME_CRC_SIZE ||
+      frame[0] != FRAME_SYNC0 || frame[1] != FRAME_SYNC1 || frame[2] != FRAME_TYPE_CONFIG ||
+      frame[3] != 0 || frame[8] != 1 || frame[9] != CONFIG_FIELDS) {
+    return false;
+  }
+  uint16_t crc = frame[len - 2] | (frame[len - 1] << 8);
+  if (crc16(frame + 2, len - 4) != crc) {
+    return false;
+  }
+  memcpy(&config, frame + FRAME_HEADER_SIZE, sizeof(DeviceConfig));   // Xtensa is little-endian
+  return true;
+}
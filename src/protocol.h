@@ -0,0 +1,355 @@
+/*
+ * CortexKey firmware - binary sample framing
+ *
+ * Frame layout (all multi-byte fields little-endian):
+ *
+ *   off  size  field
+ *   0    2     sync       0xA5 0x5A
+ *   2    1     type       FRAME_TYPE_*
+ *   3    1     flags      FRAME_FLAG_*
+ *   4    2     seq        frame sequence number (wraps at 65536)
+ *   6    2     dt_us      time from the previous frame's first sample to this
+ *                         frame's first sample, saturating; 0 after START
+ *   8    1     count      sample sets in the payload
+ *   9    1     channels   samples per set (interleaved)
+ *   10   8     time_us    only with FRAME_FLAG_TIMESTAMP: uint64 time of
+ *                         the first sample (feature frames: window end)
+ *   10/18 ...  payload    count * channels signed samples
+ *   end  2     crc        CRC-16/CCITT-FALSE over bytes [2, end)
+ *
+ * Sample encoding: int16 in 0.1 uV steps (+/-3276.7 uV), or with
+ * FRAME_FLAG_INT24 int24 in 0.001 uV steps (+/-8388.607 uV).
+ *
+ * FRAME_FLAG_ARTIFACT marks a sample or feature frame that holds (or
+ * whose window covers) samples the artifact detector flagged (artifact.h):
+ * blinks, movement spikes, muscle bursts. The samples are still sent, so
+ * the stream stays gap-free; receivers skip classifying those windows.
+ *
+ * FRAME_FLAG_TIMESTAMP stamps sample, compressed and feature frames with
+ * the sampling timer's time of their first sample (samplerTimeUs()), in
+ * microseconds: device time since boot, or with FRAME_FLAG_HOST_TIME the
+ * host clock after SYNC (clock_sync.h), drift-corrected. Streams from
+ * several devices then line up sample by sample without resampling;
+ * dt_us remains for receivers that ignore the stamp.
+ *
+ * FRAME_TYPE_COMPRESSED frames carry the same samples losslessly (after
+ * quantization) as predicted residuals:
+ *
+ *   payload[0]              payload length in bytes, including this byte
+ *   channels x 1            Rice parameter k per channel
+ *   channels x 2 (or 3)     seed: the first sample set, as in a plain frame
+ *   bitstream               residuals of sets 1 .. count-1, interleaved by
+ *                           set, MSB first, zero-padded to a byte
+ *
+ * Prediction is x[n-1], or with FRAME_FLAG_DELTA2 2*x[n-1] - x[n-2]
+ * (x[0] for set 1). Each residual is zig-zag mapped to u and Rice coded:
+ * (u >> k) one bits, a zero, then the low k bits of u. If u >> k would be
+ * RICE_ESCAPE or more, RICE_ESCAPE one bits are followed by u in 32 bits.
+ * k adapts per channel from the previous frame's residuals.
+ *
+ * FRAME_TYPE_FEATURES frames (FEATURES mode) reuse the header with
+ * count = 1, channels = FEATURE_COUNT; the payload is a uint32 sample
+ * index (window end, samples since START) followed by the float32
+ * feature vector. dt_us saturates at 65535 for hops over 65 ms.
+ *
+ * FRAME_TYPE_STATS frames (every STATS_INTERVAL_SEC while streaming and
+ * once at stop) have count = 1, channels = STATS_FIELDS and dt_us = 0;
+ * the payload is the LinkStats fields as uint32, in declaration order.
+ * They take a seq like any frame, so the host sees lost frames as gaps in
+ * seq and lost samples as sent minus received. ASCII streams carry the
+ * same record as a "STATS:index,sent,overruns,txdrops,backlog,time_us"
+ * line.
+ *
+ * FRAME_TYPE_PERF frames (PERF <seconds> telemetry in binary formats) have
+ * count = 1, channels = PERF_FIELDS and dt_us = 0; the payload is the
+ * PerfReport fields as uint32, in declaration order.
+ *
+ * FRAME_TYPE_CONFIG frames (CONFIG) have count = 1, channels =
+ * CONFIG_FIELDS and dt_us = 0; the payload is the DeviceConfig fields as
+ * uint32, in declaration order. It is the one frame that also travels
+ * host -> device: sent at the start of a command line, it sets the whole
+ * configuration at once (config_store.h).
+ *
+ * FRAME_TYPE_SESSION frames open each session in the recorder's log
+ * (recorder.h, read back with DUMP) with count = 1, channels =
+ * SESSION_FIELDS and dt_us = 0; the payload is the SessionRecord fields
+ * as uint32 and seq 0; the session's int24 sample frames follow it, seq
+ * counting on from 1.
+ *
+ * Frames may be interleaved with the normal "STATUS:..." text lines; the
+ * sync byte 0xA5 never occurs in the ASCII output.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "perf.h"
+
+#define FRAME_SYNC0          0xA5
+#define FRAME_SYNC1          0x5A
+#define FRAME_HEADER_SIZE    10
+#define FRAME_CRC_SIZE       2
+
+#define FRAME_TYPE_SAMPLES   0x01
+#define FRAME_TYPE_FEATURES  0x02
+#define FRAME_TYPE_COMPRESSED 0x03
+#define FRAME_TYPE_STATS     0x04
+#define FRAME_TYPE_PERF      0x05
+#define FRAME_TYPE_CONFIG    0x06
+#define FRAME_TYPE_SESSION   0x07
+
+#define FRAME_FLAG_INT24     0x01
+#define FRAME_FLAG_FILTERED  0x02    // Samples already notch + bandpass filtered
+#define FRAME_FLAG_DELTA2    0x04    // Compressed frame uses the second-order predictor
+#define FRAME_FLAG_ARTIFACT  0x08    // Frame contains artifact-flagged samples
+#define FRAME_FLAG_TIMESTAMP 0x10    // time_us follows the header
+#define FRAME_FLAG_HOST_TIME 0x20    // time_us is host time (SYNC), not device time
+
+#define FRAME_TIME_SIZE      8
+
+#define RICE_ESCAPE          16      // Unary run that switches to a raw 32-bit value
+#define RICE_MAX_K           24
+#define RICE_DEFAULT_K       4       // First frame of a stream
+
+#define FRAME_MAX_PAYLOAD    240     // bytes
+#define FRAME_MAX_SIZE       (FRAME_HEADER_SIZE + FRAME_TIME_SIZE + FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE)
+
+// "DATA,4294967295" + ",-8388.607" per channel + "\r\n"
+#define ASCII_SAMPLE_MAX(channels)  (17 + 10 * (channels))
+
+// "STATS:" + ",4294967295" per field + "\r\n"
+#define STATS_FIELDS         6
+#define STATS_LINE_MAX       (8 + 11 * STATS_FIELDS)
+
+enum OutputFormat {
+  FORMAT_ASCII,      // DATA,timestamp,value lines
+  FORMAT_BINARY16,   // Sample frames, int16 payload
+  FORMAT_BINARY24,   // Sample frames, int24 payload
+  FORMAT_FEATURES,   // Band-power feature frames instead of samples
+  FORMAT_COMPRESSED  // Delta + Rice coded sample frames (0.1 uV steps)
+};
+
+/**
+ * Format one "DATA,timestamp,v0[,v1...]\r\n" line (3 decimals, same text
+ * as Serial.print(value, 3)) without float printing. Returns its length.
+ */
+size_t formatAsciiSample(char *out, uint32_t timestampMs, const float *values, uint8_t channels);
+
+/** Stream health counters, all since START. */
+struct LinkStats {
+  uint32_t index;         // Samples taken (next sample index)
+  uint32_t sent;          // Samples queued for the transport
+  uint32_t overruns;      // Samples lost to a full sampler ring
+  uint32_t txDrops;       // Frames or lines lost to a full TX block
+  uint32_t backlogPeak;   // Most samples ever waiting in the sampler ring
+  uint32_t timeUs;        // Time since START when the record was made
+};
+
+#define PERF_FIELDS          (18 + PERF_BUCKETS)
+
+/** PERF telemetry: timings in microseconds, counters since PERF RESET. */
+struct PerfReport {
+  uint32_t loopMinUs;             // Comms task: one iteration (wake-up excluded)
+  uint32_t loopAvgUs;
+  uint32_t loopP99Us;
+  uint32_t loopMaxUs;
+  uint32_t acqMinUs;              // Acquisition task: one timer wake-up
+  uint32_t acqAvgUs;
+  uint32_t acqP99Us;
+  uint32_t acqMaxUs;
+  uint32_t jitterAvgUs;           // |sample interval - tick period|
+  uint32_t jitterP99Us;
+  uint32_t jitterMaxUs;
+  uint32_t txBytesPerSec;         // Since the previous report
+  uint32_t sampleRingPeak;        // Samples
+  uint32_t txBlockPeak;           // Bytes
+  uint32_t freeHeap;
+  uint32_t minFreeHeap;           // Low-water mark since boot
+  uint32_t idle0;                 // Per mille of core 0 outside the comms task, since the previous report
+  uint32_t idle1;                 // Per mille of core 1 outside the acquisition task
+  uint32_t jitterHist[PERF_BUCKETS];
+};
+
+/**
+ * Encode a FRAME_TYPE_PERF frame into out (at least FRAME_MAX_SIZE
+ * bytes). Returns the frame size.
+ */
+size_t encodePerfFrame(uint8_t *out, uint16_t seq, const PerfReport &report);
+
+#define CONFIG_FIELDS        (16 + EEG_MAX_CHANNELS)
+
+/**
+ * Persistent configuration (config_store.h): what a boot restores, and
+ * the CONFIG frame payload.
+ */
+struct DeviceConfig {
+  uint32_t version;               // CONFIG_VERSION; any other value is rejected
+  uint32_t rate;                  // Hz (RATE)
+  uint32_t oversample;            // OVERSAMPLE ratio
+  uint32_t decimFilter;           // DecimFilter
+  uint32_t channelMask;           // CHANNELS
+  uint32_t format;                // OutputFormat
+  uint32_t compressOrder;         // COMPRESSED predictor, 1 or 2
+  uint32_t blockSamples;          // BLOCK
+  uint32_t featureHop;            // FEATURES hop in samples
+  uint32_t filter;                // FILTER ON = 1
+  uint32_t notchHz;               // 50, 60 or 0 (OFF)
+  uint32_t artifact;              // ARTIFACT ON = 1
+  uint32_t mock;                  // MOCK_AUTH = 0, MOCK_IMP = 1
+  uint32_t baud;                  // UART rate from boot on
+  uint32_t autostart;             // 1: START at boot
+  uint32_t quietBoot;             // 1: no banner and no startup delay
+  uint32_t gain[EEG_MAX_CHANNELS];    // GAIN per channel (front-end calibration)
+};
+
+/**
+ * Encode a FRAME_TYPE_CONFIG frame into out (at least FRAME_MAX_SIZE
+ * bytes). Returns the frame size.
+ */
+size_t encodeConfigFrame(uint8_t *out, uint16_t seq, const DeviceConfig &config);
+
+/**
+ * Check a received FRAME_TYPE_CONFIG frame (layout, CRC) and copy its
+ * payload into config. Field values are not validated here.
+ */
+bool decodeConfigFrame(const uint8_t *frame, size_t len, DeviceConfig &config);
+
+#define SESSION_FIELDS       8
+
+/** Start of one recorded session (recorder.h): what its samples are. */
+struct SessionRecord {
+  uint32_t session;               // Sessions recorded since RECORD CLEAR
+  uint32_t label;                 // 1: VALID test (authenticated), 0: INVALID (impostor)
+  uint32_t rate;                  // Hz
+  uint32_t channelMask;           // CHANNELS: ADC1 channels in the sample sets
+  uint32_t filtered;              // 1: samples went through FILTER (FRAME_FLAG_FILTERED)
+  uint32_t synced;                // 1: hostOffset is valid (SYNC had run)
+  uint32_t hostOffsetLo;          // Host - device time at the start, us (int64)
+  uint32_t hostOffsetHi;
+};
+
+/**
+ * Encode a FRAME_TYPE_SESSION frame into out (at least FRAME_MAX_SIZE
+ * bytes). Returns the frame size.
+ */
+size_t encodeSessionFrame(uint8_t *out, uint16_t seq, const SessionRecord &record);
+
+/**
+ * Size of a record frame (stats, perf, config or session: uint32 words) from its
+ * first FRAME_HEADER_SIZE bytes.
+ */
+size_t recordFrameSize(const uint8_t *header);
+
+/** Format a "STATS:..." line (at most STATS_LINE_MAX bytes). Returns its length. */
+size_t formatStatsLine(char *out, const LinkStats &stats);
+
+/**
+ * Encode a FRAME_TYPE_STATS frame into out (at least FRAME_MAX_SIZE
+ * bytes). Returns the frame size.
+ */
+size_t encodeStatsFrame(uint8_t *out, uint16_t seq, const LinkStats &stats);
+
+/**
+ * Encode a FRAME_TYPE_FEATURES frame into out (at least FRAME_MAX_SIZE
+ * bytes); timeUs is written when flags has FRAME_FLAG_TIMESTAMP. Returns
+ * the frame size.
+ */
+size_t encodeFeatureFrame(uint8_t *out, uint16_t seq, uint16_t dtUs, uint32_t index,
+                          const float *features, uint8_t count, uint8_t flags = 0,
+                          uint64_t timeUs = 0);
+
+/** CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF). */
+uint16_t crc16(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF);
+
+/**
+ * Builds one sample frame in place. Usage: begin(), add() per sample,
+ * finish(), then write data()/size() to the transport.
+ */
+class SampleFrameEncoder {
+public:
+  /** timeUs (first sample) is written when flags has FRAME_FLAG_TIMESTAMP. */
+  void begin(uint8_t flags, uint16_t seq, uint16_t dtUs, uint8_t channels = 1,
+             uint64_t timeUs = 0);
+
+  /** Append one sample. Returns false when the payload is full. */
+  bool add(float value);
+
+  /** Sample sets that fit before the payload is full. */
+  uint8_t capacity() const;
+
+  uint8_t count() const { return sets; }
+
+  /** No further sample set fits. */
+  bool full() const { return sets >= capacity(); }
+
+  /** OR flags into the header (FRAME_FLAG_ARTIFACT); before finish(). */
+  void addFlags(uint8_t flags) { buf[3] |= flags; }
+
+  /** Seal the frame (count + CRC). Returns the frame size in bytes. */
+  size_t finish();
+
+  const uint8_t *data() const { return buf; }
+  size_t size() const { return len; }
+
+private:
+  uint8_t buf[FRAME_MAX_SIZE];
+  size_t len = 0;
+  uint8_t sampleBytes = 2;
+  uint8_t chans = 1;
+  uint8_t inSet = 0;
+  uint8_t sets = 0;
+};
+
+/**
+ * Builds one FRAME_TYPE_COMPRESSED frame in place; same usage as
+ * SampleFrameEncoder. Residuals are coded as they are added, so full()
+ * is exact: it turns true once a worst-case set might no longer fit.
+ */
+class CompressedFrameEncoder {
+public:
+  /** Forget the adapted Rice parameters (start of a stream). */
+  void reset();
+
+  /**
+   * order is 1 or 2 (predictor); flags may include FRAME_FLAG_INT24 and
+   * FRAME_FLAG_TIMESTAMP (with timeUs, as for SampleFrameEncoder).
+   */
+  void begin(uint8_t flags, uint16_t seq, uint16_t dtUs, uint8_t channels, uint8_t order,
+             uint64_t timeUs = 0);
+
+  /** Append one sample. Returns false when the frame is full. */
+  bool add(float value);
+
+  uint8_t count() const { return sets; }
+  bool full() const;
+
+  /** Same as SampleFrameEncoder::addFlags(). */
+  void addFlags(uint8_t flags) { buf[3] |= flags; }
+
+  size_t finish();
+
+  const uint8_t *data() const { return buf; }
+  size_t size() const { return len; }
+
+private:
+  void putBits(uint32_t value, uint8_t bits);
+  void putResidual(int32_t residual, uint8_t k);
+
+  uint8_t buf[FRAME_MAX_SIZE];
+  size_t len = 0;              // Whole bytes written
+  size_t payloadStart = FRAME_HEADER_SIZE;
+  uint32_t bitAcc = 0;         // Pending bits, right-aligned
+  uint8_t bitCount = 0;
+  uint8_t sampleBytes = 2;
+  uint8_t chans = 1;
+  uint8_t predictor = 1;
+  uint8_t inSet = 0;
+  uint8_t sets = 0;
+
+  int32_t prev1[EEG_MAX_CHANNELS];   // x[n-1]
+  int32_t prev2[EEG_MAX_CHANNELS];   // x[n-2]
+  uint8_t riceK[EEG_MAX_CHANNELS];
+  uint64_t sumU[EEG_MAX_CHANNELS];   // This frame's residual magnitudes, for the next k
+  uint16_t residuals = 0;            // Residuals per channel in this frame
+};
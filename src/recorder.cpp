@@ -0,0 +1,240 @@
+/*
+ * CortexKey firmware - on-device session recorder
+ */
+#include "recorder.h"
+
+#include <Preferences.h>
+
+// Flash ring position, saved after every session
+struct RecordState {
+  uint32_t size;                    // Ring size it belongs to (another partition: start over)
+  uint32_t sessions;
+  uint64_t head;
+  uint64_t tail;
+};
+
+bool SessionRecorder::begin() {
+  if (psramFound()) {
+    psram = (uint8_t *)ps_malloc(RECORD_PSRAM_BYTES);
+    if (psram) {
+      store = RECORD_PSRAM;
+      size = RECORD_PSRAM_BYTES;
+      clear();
+      return true;
+    }
+  }
+
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                       RECORD_PARTITION);
+  if (!partition || partition->size < 2 * RECORD_SECTOR_BYTES) {
+    store = RECORD_NONE;
+    return false;
+  }
+  store = RECORD_FLASH;
+  size = partition->size / RECORD_SECTOR_BYTES * RECORD_SECTOR_BYTES;
+
+  RecordState state;
+  Preferences prefs;
+  bool ok = false;
+  if (prefs.begin(RECORD_NVS_NAMESPACE, true)) {
+    ok = prefs.getBytes("ring", &state, sizeof(state)) == sizeof(state) && state.size == size &&
+         state.tail <= state.head && state.head - state.tail <= size;
+    prefs.end();
+  }
+  if (!ok) {
+    clear();
+    return true;
+  }
+  // A reset mid-session may have written past the saved head: keep that
+  // sector as it is (the host drops a cut frame) and go on after it.
+  head = ready = (state.head + RECORD_SECTOR_BYTES - 1) / RECORD_SECTOR_BYTES * RECORD_SECTOR_BYTES;
+  tail = head - state.tail > size ? head - size : state.tail;
+  sessionCount = state.sessions;
+  return true;
+}
+
+const char *SessionRecorder::mediumName() const {
+  switch (store) {
+    case RECORD_PSRAM: return "PSRAM";
+    case RECORD_FLASH: return "FLASH";
+    default: return "NONE";
+  }
+}
+
+void SessionRecorder::startSession(SessionRecord record, uint32_t sampleBytes, uint32_t seconds) {
+  if (store == RECORD_NONE) {
+    return;
+  }
+  endSession();
+  dumpAbort();
+
+  // Frame header, stamp and CRC add 20 bytes per 240 of int24 samples
+  uint64_t expected = (uint64_t)sampleBytes * seconds * 13 / 12 + FRAME_MAX_SIZE + RECORD_PAGE_BYTES;
+  uint64_t limit = head + size - RECORD_SECTOR_BYTES;
+  prepare(head + expected < limit ? head + expected : limit);
+
+  uint8_t buf[FRAME_MAX_SIZE];
+  record.session = ++sessionCount;
+  append(buf, encodeSessionFrame(buf, 0, record));
+  frameFlags = FRAME_FLAG_INT24 | FRAME_FLAG_TIMESTAMP | (record.filtered ? FRAME_FLAG_FILTERED : 0);
+  frameSeq = 1;
+  frameOpen = false;
+  active = true;
+}
+
+void SessionRecorder::add(const Sample &sample) {
+  if (!active) {
+    return;
+  }
+  if (!frameOpen) {
+    uint32_t dtUs = 0;
+    if (frameSeq > 1) {
+      dtUs = (sample.index - frameLastIndex) * samplerPeriodUs();
+      if (dtUs > 0xFFFF) dtUs = 0xFFFF;
+    }
+    frame.begin(frameFlags, frameSeq++, dtUs, sample.channels, samplerTimeUs(sample.index));
+    frameLastIndex = sample.index;
+    frameOpen = true;
+  }
+  for (uint8_t ch = 0; ch < sample.channels; ch++) {
+    frame.add(sample.value[ch]);
+  }
+  if (sample.artifact) {
+    frame.addFlags(FRAME_FLAG_ARTIFACT);
+  }
+  if (frame.full()) {
+    append(frame.data(), frame.finish());
+    frameOpen = false;
+  }
+}
+
+void SessionRecorder::endSession() {
+  if (!active) {
+    return;
+  }
+  if (frameOpen) {
+    append(frame.data(), frame.finish());
+    frameOpen = false;
+  }
+  flushPage();
+  active = false;
+  saveState();
+}
+
+void SessionRecorder::clear() {
+  active = false;
+  head = tail = ready = 0;
+  fill = 0;
+  sessionCount = 0;
+  dumpPos = dumpEnd = 0;
+  saveState();
+}
+
+uint32_t SessionRecorder::dumpBegin() {
+  flushPage();
+  dumpPos = tail;
+  dumpEnd = head;
+  return (uint32_t)(dumpEnd - dumpPos);
+}
+
+size_t SessionRecorder::dumpRead(uint8_t *buf, size_t len) {
+  if (dumpPos + len > dumpEnd) {
+    len = (size_t)(dumpEnd - dumpPos);
+  }
+  readStore(dumpPos, buf, len);
+  dumpPos += len;
+  return len;
+}
+
+// ============================================================
+// STORAGE
+// ============================================================
+
+void SessionRecorder::append(const uint8_t *data, size_t len) {
+  while (len) {
+    size_t n = RECORD_PAGE_BYTES - fill;
+    if (n > len) n = len;
+    memcpy(page + fill, data, n);
+    fill += n;
+    data += n;
+    len -= n;
+    if (fill == RECORD_PAGE_BYTES) {
+      flushPage();
+    }
+  }
+}
+
+void SessionRecorder::flushPage() {
+  if (!fill) {
+    return;
+  }
+  prepare(head + fill);
+  writeStore(head, page, fill);
+  head += fill;
+  fill = 0;
+}
+
+/**
+ * Make the log writable up to position end, overwriting the oldest data.
+ * Flash erases whole sectors, in one call per contiguous run so the
+ * driver can use 64 KB block erases.
+ */
+void SessionRecorder::prepare(uint64_t end) {
+  if (store == RECORD_FLASH) {
+    end = (end + RECORD_SECTOR_BYTES - 1) / RECORD_SECTOR_BYTES * RECORD_SECTOR_BYTES;
+    while (ready < end) {
+      uint32_t offset = ready % size;
+      uint64_t n = end - ready;
+      if (n > size - offset) n = size - offset;
+      esp_partition_erase_range(partition, offset, n);
+      ready += n;
+    }
+  } else if (end > ready) {
+    ready = end;
+  }
+  if (ready > tail + size) {
+    tail = ready - size;
+  }
+}
+
+void SessionRecorder::writeStore(uint64_t pos, const uint8_t *data, size_t len) {
+  while (len) {
+    uint32_t offset = pos % size;
+    size_t n = size - offset < len ? size - offset : len;
+    if (store == RECORD_PSRAM) {
+      memcpy(psram + offset, data, n);
+    } else {
+      esp_partition_write(partition, offset, data, n);
+    }
+    pos += n;
+    data += n;
+    len -= n;
+  }
+}
+
+void SessionRecorder::readStore(uint64_t pos, uint8_t *data, size_t len) {
+  while (len) {
+    uint32_t offset = pos % size;
+    size_t n = size - offset < len ? size - offset : len;
+    if (store == RECORD_PSRAM) {
+      memcpy(data, psram + offset, n);
+    } else {
+      esp_partition_read(partition, offset, data, n);
+    }
+    pos += n;
+    data += n;
+    len -= n;
+  }
+}
+
+void SessionRecorder::saveState() {
+  if (store != RECORD_FLASH) {
+    return;
+  }
+  RecordState state = {size, sessionCount, head, tail};
+  Preferences prefs;
+  if (prefs.begin(RECORD_NVS_NAMESPACE, false)) {
+    prefs.putBytes("ring", &state, sizeof(state));
+    prefs.end();
+  }
+}
@@ -0,0 +1,115 @@
+/*
+ * CortexKey firmware - on-device session recorder
+ *
+ * Keeps every sample of the MODE_AUTH_* sessions (button tests and AUTH)
+ * in local storage, so a slow or dropped link loses nothing: the host
+ * pulls the log later with DUMP at the full UART rate, e.g. as training
+ * data for backend/train_model.py.
+ *
+ * The log is a byte ring of ordinary frames (protocol.h): per session a
+ * FRAME_TYPE_SESSION record, then int24 sample frames of every enabled
+ * channel stamped with device time (FRAME_FLAG_TIMESTAMP). When it is
+ * full the oldest data is overwritten; a session whose record was
+ * overwritten is dropped by the host. Storage is
+ *
+ *   PSRAM   RECORD_PSRAM_BYTES, on modules that have it; lost at reset
+ *   FLASH   the RECORD_PARTITION data partition as raw sectors, kept
+ *           across resets (the ring position is saved in NVS after every
+ *           session). The firmware mounts no filesystem, so the default
+ *           partition table's spiffs partition is free for this.
+ *
+ * Flash sectors for a whole AUTO_STOP_SEC session are erased before the
+ * sampler starts, so sampling only ever sees page writes (under 1 ms of
+ * stalled flash cache per RECORD_PAGE_BYTES); the sampler ring absorbs
+ * them.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+#include "protocol.h"
+#include "sampler.h"
+
+#define RECORD_NVS_NAMESPACE  "ckrec"
+
+enum RecordMedium {
+  RECORD_NONE,
+  RECORD_PSRAM,
+  RECORD_FLASH
+};
+
+class SessionRecorder {
+public:
+  /** Pick the storage (PSRAM, else the flash partition) and restore the flash log. */
+  bool begin();
+
+  RecordMedium medium() const { return store; }
+  const char *mediumName() const;
+
+  /** Log bytes held and the ring size. */
+  uint32_t bytes() const { return (uint32_t)(head + fill - tail); }
+  uint32_t capacity() const { return size; }
+  uint32_t sessions() const { return sessionCount; }
+  bool recording() const { return active; }
+
+  /**
+   * Open a session: its SessionRecord (session number filled in here),
+   * and for flash the sectors of a session of `seconds` at `sampleBytes`
+   * per second erased ahead. Call before the sampler starts.
+   */
+  void startSession(SessionRecord record, uint32_t sampleBytes, uint32_t seconds);
+
+  /** Log one sample set (int24, 0.001 uV steps). */
+  void add(const Sample &sample);
+
+  /** Close the session: last frame out, ring position saved (flash). */
+  void endSession();
+
+  /** Forget every session (RECORD CLEAR). */
+  void clear();
+
+  /**
+   * DUMP: start reading the log from its oldest byte. Returns the bytes
+   * dumpRead() will deliver.
+   */
+  uint32_t dumpBegin();
+
+  /** Next chunk of the dump into buf (at most len bytes); 0 once done. */
+  size_t dumpRead(uint8_t *buf, size_t len);
+
+  bool dumping() const { return dumpPos < dumpEnd; }
+  void dumpAbort() { dumpEnd = dumpPos; }
+
+private:
+  void append(const uint8_t *data, size_t len);
+  void flushPage();
+  void prepare(uint64_t end);
+  void writeStore(uint64_t pos, const uint8_t *data, size_t len);
+  void readStore(uint64_t pos, uint8_t *data, size_t len);
+  void saveState();
+
+  RecordMedium store = RECORD_NONE;
+  uint8_t *psram = nullptr;
+  const esp_partition_t *partition = nullptr;
+  uint32_t size = 0;
+
+  // Byte positions in the log since RECORD CLEAR; storage offset = pos % size
+  uint64_t head = 0;                 // Next byte to store
+  uint64_t tail = 0;                 // Oldest byte still held
+  uint64_t ready = 0;                // Bytes below this are writable (flash: erased)
+  uint32_t sessionCount = 0;
+
+  uint8_t page[RECORD_PAGE_BYTES];   // Bytes after head not yet stored
+  size_t fill = 0;
+
+  bool active = false;
+  uint8_t frameFlags = 0;
+  SampleFrameEncoder frame;
+  bool frameOpen = false;
+  uint16_t frameSeq = 0;
+  uint32_t frameLastIndex = 0;
+
+  uint64_t dumpPos = 0;
+  uint64_t dumpEnd = 0;
+};
@@ -0,0 +1,59 @@
+/*
+ * CortexKey firmware - lock-free single-producer / single-consumer ring
+ *
+ * One context calls push(), one other context calls pop(). No locks, no
+ * heap: head is only written by the producer, tail only by the consumer,
+ * and acquire/release ordering publishes the slot contents between cores.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, size_t N>
+class RingBuffer {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+
+public:
+  /** Producer side. Returns false (and drops the item) when full. */
+  bool push(const T &item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N) {
+      return false;
+    }
+    slots[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Consumer side. Returns false when empty. */
+  bool pop(T &item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = slots[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /** Number of queued items (approximate when called from a third context). */
+  size_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+
+  static constexpr size_t capacity() { return N; }
+
+  /** Consumer side: discard everything currently queued. */
+  void clear() {
+    tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+private:
+  T slots[N];
+  std::atomic<uint32_t> head{0};
+  std::atomic<uint32_t> tail{0};
+};
@@ -0,0 +1,217 @@
+/*
+ * CortexKey firmware - hardware-timed sampling engine
+ */
+#include "sampler.h"
+
+#include <atomic>
+
+#include <esp_timer.h>
+
+#include "config.h"
+#include "ring_buffer.h"
+
+// ============================================================
+// STATE
+// ============================================================
+static hw_timer_t *sampleTimer = nullptr;
+static TaskHandle_t acqTaskHandle = nullptr;
+static TaskHandle_t consumerTask = nullptr;
+static SampleSource sampleSource = nullptr;
+
+static RingBuffer<Sample, SAMPLE_RING_SIZE> sampleRing;
+
+static std::atomic<bool> acqRunning{false};
+static std::atomic<bool> acqBusy{false};
+static uint32_t nextIndex = 0;           // Owned by the acquisition task while running
+static uint32_t sampleRate = SAMPLE_RATE;
+static uint32_t periodUs = 1000000 / SAMPLE_RATE;
+static uint8_t oversampling = 1;
+static int64_t startTimeUs = 0;          // esp_timer time of the timer's count 0
+static std::atomic<uint32_t> overruns{0};
+static uint32_t backlogPeak = 0;         // Consumer side only
+static uint32_t perfBacklogPeak = 0;     // Consumer side only, cleared by PERF RESET too
+
+static SamplerPerf perf;
+static std::atomic<bool> perfResetPending{false};
+static std::atomic<bool> wakeResync{true};   // Next wake-up has no previous one to compare with
+static uint32_t lastWakeCycles = 0;
+
+// ============================================================
+// TIMER ISR + ACQUISITION TASK
+// ============================================================
+
+/**
+ * Timer ISR: only wakes the acquisition task. analogRead() takes driver
+ * locks and is not ISR-safe, so the ADC access itself happens in the task.
+ */
+static void IRAM_ATTR onSampleTimer() {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(acqTaskHandle, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+static void acquisitionTask(void *) {
+  for (;;) {
+    // Returns the number of timer ticks since the last wake-up. Normally 1;
+    // if the task was ever held off we still emit one sample per tick so the
+    // index (and therefore the timeline) never slips.
+    uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint32_t wake = perfCycles();
+
+    acqBusy.store(true);
+    if (perfResetPending.exchange(false)) {
+      perf.jitter.reset();
+      perf.work.reset();
+    }
+    if (acqRunning.load()) {
+      if (!wakeResync.exchange(false)) {
+        // Wake-up interval against ticks x tick period
+        int32_t interval = perfCyclesToUs(wake - lastWakeCycles);
+        int32_t expected = ticks * (periodUs / oversampling);
+        perf.jitter.add(abs(interval - expected));
+      }
+      bool pushed = false;
+      while (ticks--) {
+        Sample s;
+        s.artifact = 0;
+        s.channels = sampleSource(nextIndex, s.value, s.artifact);
+        if (s.channels == 0) {
+          continue;                     // Decimator still accumulating
+        }
+        s.index = nextIndex++;
+        if (!sampleRing.push(s)) {
+          overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        pushed = true;
+      }
+      if (pushed && consumerTask) {
+        xTaskNotifyGive(consumerTask);
+      }
+      uint32_t workUs = perfElapsedUs(wake);
+      perf.work.add(workUs);
+      perf.busyUs.fetch_add(workUs, std::memory_order_relaxed);
+    }
+    lastWakeCycles = wake;
+    acqBusy.store(false);
+  }
+}
+
+// ============================================================
+// PUBLIC API
+// ============================================================
+
+void samplerBegin(SampleSource source) {
+  sampleSource = source;
+
+  xTaskCreatePinnedToCore(acquisitionTask, "acq", SAMPLER_TASK_STACK, nullptr,
+                          configMAX_PRIORITIES - 1, &acqTaskHandle, SAMPLER_CORE);
+
+  sampleTimer = timerBegin(SAMPLER_TIMER, SAMPLER_TIMER_DIV, true);
+  timerAttachInterrupt(sampleTimer, &onSampleTimer, true);
+  timerAlarmWrite(sampleTimer, periodUs, true);
+}
+
+/** Rate x osr is a valid timer tick. */
+static bool tickValid(uint32_t hz, uint8_t osr) {
+  uint32_t tick = hz * osr;
+  return tick != 0 && tick <= SAMPLER_TICK_MAX && 1000000 % tick == 0;
+}
+
+bool samplerSetRate(uint32_t hz) {
+  if (hz == 0 || hz > SAMPLE_RATE_MAX || !tickValid(hz, oversampling) || acqRunning.load()) {
+    return false;
+  }
+  sampleRate = hz;
+  periodUs = 1000000 / hz;
+  timerAlarmWrite(sampleTimer, periodUs / oversampling, true);
+  return true;
+}
+
+bool samplerSetOversampling(uint8_t osr) {
+  if (!tickValid(sampleRate, osr) || acqRunning.load()) {
+    return false;
+  }
+  oversampling = osr;
+  timerAlarmWrite(sampleTimer, periodUs / oversampling, true);
+  return true;
+}
+
+uint8_t samplerOversampling() {
+  return oversampling;
+}
+
+uint32_t samplerRate() {
+  return sampleRate;
+}
+
+uint32_t samplerPeriodUs() {
+  return periodUs;
+}
+
+int64_t samplerTimeUs(uint32_t index) {
+  return startTimeUs + (int64_t)(index + 1) * periodUs;
+}
+
+void samplerSetConsumer(TaskHandle_t consumer) {
+  consumerTask = consumer;
+}
+
+void samplerStart() {
+  samplerStop();
+
+  sampleRing.clear();
+  nextIndex = 0;
+  overruns.store(0);
+  backlogPeak = 0;
+  perfBacklogPeak = 0;
+  wakeResync.store(true);
+
+  timerWrite(sampleTimer, 0);
+  startTimeUs = esp_timer_get_time();
+  acqRunning.store(true);
+  timerAlarmEnable(sampleTimer);
+}
+
+void samplerStop() {
+  timerAlarmDisable(sampleTimer);
+  acqRunning.store(false);
+  // The task sets acqBusy before checking acqRunning, so once it reads
+  // false here no further sample can be pushed for this run.
+  while (acqBusy.load()) { }
+}
+
+bool samplerRunning() {
+  return acqRunning.load();
+}
+
+bool samplerRead(Sample &out) {
+  uint32_t queued = sampleRing.size();
+  if (queued > backlogPeak) {
+    backlogPeak = queued;
+  }
+  if (queued > perfBacklogPeak) {
+    perfBacklogPeak = queued;
+  }
+  return sampleRing.pop(out);
+}
+
+uint32_t samplerOverruns() {
+  return overruns.load(std::memory_order_relaxed);
+}
+
+uint32_t samplerBacklogPeak() {
+  return backlogPeak;
+}
+
+uint32_t samplerPerfBacklogPeak() {
+  return perfBacklogPeak;
+}
+
+const SamplerPerf &samplerPerf() {
+  return perf;
+}
+
+void samplerPerfReset() {
+  perfBacklogPeak = 0;
+  perfResetPending.store(true);
+}
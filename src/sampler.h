@@ -0,0 +1,109 @@
+/*
+ * CortexKey firmware - hardware-timed sampling engine
+ *
+ * A hardware timer fires once per sample period (1 MHz tick, so the period
+ * is 1000000 / rate microseconds) and wakes a
+ * high-priority acquisition task, which takes one sample from the source
+ * callback and pushes it into a lock-free ring. With oversampling the
+ * timer runs n times faster and the source returns a sample only on every
+ * n-th tick (decimator.h). The consumer drains it at
+ * its own pace, so slow serial writes or command handling no longer move
+ * the sampling grid - they only add latency.
+ *
+ * The acquisition task is pinned to SAMPLER_CORE; its consumer (the
+ * comms task) normally runs on the other core.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "config.h"
+#include "perf.h"
+
+/** One sample set: every enabled channel taken in the same timer tick. */
+struct Sample {
+  uint32_t index;                   // Sample number since samplerStart() (index * period = time)
+  uint8_t channels;                 // Valid entries in value[]
+  float value[EEG_MAX_CHANNELS];    // Microvolts, channel order
+  uint8_t artifact;                 // ARTIFACT_* bits of any channel (artifact.h), 0 = clean
+};
+
+/**
+ * Fills values[] (and artifact, preset to 0) for a given index and
+ * returns the channel count, or 0 when this tick produced no output
+ * sample (oversampling); the same index is then offered again on the
+ * next tick. Runs in the acquisition task.
+ */
+typedef uint8_t (*SampleSource)(uint32_t index, float *values, uint8_t &artifact);
+
+/** Create the timer and acquisition task. Call once from setup(). */
+void samplerBegin(SampleSource source);
+
+/**
+ * Change the sample rate. Only while stopped; the next samplerStart() runs
+ * at the new rate. Returns false for 0, rates above SAMPLE_RATE_MAX or
+ * rates whose tick (with the current oversampling) is not a whole number
+ * of microseconds.
+ */
+bool samplerSetRate(uint32_t hz);
+
+uint32_t samplerRate();
+
+/** Sample period in microseconds (sample time = index * period). */
+uint32_t samplerPeriodUs();
+
+/**
+ * Device time (esp_timer, microseconds since boot) of a sample: the timer
+ * tick that completed it. Exact to the 1 MHz sampling timer, unlike
+ * millis() since START.
+ */
+int64_t samplerTimeUs(uint32_t index);
+
+/**
+ * Timer ticks per output sample (1 = no oversampling). Only while
+ * stopped; rate x osr must stay within SAMPLER_TICK_MAX and give a whole
+ * number of microseconds per tick.
+ */
+bool samplerSetOversampling(uint8_t osr);
+
+uint8_t samplerOversampling();
+
+/** Task to notify after every sample pushed (the ring's consumer). */
+void samplerSetConsumer(TaskHandle_t consumer);
+
+/** Reset the sample index, discard queued samples and start the timer. */
+void samplerStart();
+
+/** Stop the timer. Returns once no sample is in flight. */
+void samplerStop();
+
+bool samplerRunning();
+
+/** Pop the oldest queued sample. Returns false when none is pending. */
+bool samplerRead(Sample &out);
+
+/** Samples dropped because the ring was full since samplerStart(). */
+uint32_t samplerOverruns();
+
+/** Most samples queued at once since samplerStart() (ring high-water mark). */
+uint32_t samplerBacklogPeak();
+
+/** The same high-water mark since samplerStart() or samplerPerfReset(), for PERF. */
+uint32_t samplerPerfBacklogPeak();
+
+/** Acquisition-task timing (perf.h); written by that task only. */
+struct SamplerPerf {
+  PerfHistogram jitter;              // |wake-up interval - tick period|, us
+  PerfHistogram work;                // Time per wake-up spent in the task, us
+  std::atomic<uint32_t> busyUs{0};   // Running total of work (wraps; use deltas)
+};
+
+const SamplerPerf &samplerPerf();
+
+/**
+ * Clear the jitter and work histograms (done by the task on its next
+ * wake-up) and the PERF backlog peak. Call from the consumer task.
+ */
+void samplerPerfReset();
@@ -0,0 +1,115 @@
+/*
+ * CortexKey firmware - templated SVM inference
+ *
+ * Evaluates an sklearn SVC exported by tools/export_model.py into
+ * model_generated.h. Feature count, support-vector count and kernel are
+ * template parameters, so each model compiles to its own code: loop
+ * bounds are constants the compiler unrolls, and the kernel is picked at
+ * compile time rather than per support vector. The model only refers to
+ * the generated constexpr arrays, and their sizes are part of its type,
+ * so a header that no longer matches fails to build.
+ *
+ *   decision()    = sklearn decision_function (positive = class 1)
+ *   probability() = predict_proba()[:, 1], Platt: 1 / (1 + exp(A f - B))
+ */
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+
+enum SvmKernelType {
+  SVM_LINEAR,     // <sv, x>
+  SVM_POLY,       // (gamma <sv, x> + coef0) ^ degree
+  SVM_RBF,        // exp(-gamma |sv - x|^2)
+  SVM_SIGMOID     // tanh(gamma <sv, x> + coef0)
+};
+
+template <size_t F>
+inline float svmDot(const float (&a)[F], const float *b) {
+  float sum = 0.0f;
+  for (size_t i = 0; i < F; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+/** K(sv, x) for one kernel; params are the model's gamma / coef0 / degree. */
+template <SvmKernelType K>
+struct SvmKernel;
+
+template <>
+struct SvmKernel<SVM_LINEAR> {
+  template <size_t F>
+  static inline float eval(const float (&sv)[F], const float *x, float, float, float) {
+    return svmDot(sv, x);
+  }
+};
+
+template <>
+struct SvmKernel<SVM_POLY> {
+  template <size_t F>
+  static inline float eval(const float (&sv)[F], const float *x, float gamma, float coef0, float degree) {
+    return powf(gamma * svmDot(sv, x) + coef0, degree);
+  }
+};
+
+template <>
+struct SvmKernel<SVM_RBF> {
+  template <size_t F>
+  static inline float eval(const float (&sv)[F], const float *x, float gamma, float, float) {
+    float dist = 0.0f;
+    for (size_t i = 0; i < F; i++) {
+      float d = sv[i] - x[i];
+      dist += d * d;
+    }
+    return expf(-gamma * dist);
+  }
+};
+
+template <>
+struct SvmKernel<SVM_SIGMOID> {
+  template <size_t F>
+  static inline float eval(const float (&sv)[F], const float *x, float gamma, float coef0, float) {
+    return tanhf(gamma * svmDot(sv, x) + coef0);
+  }
+};
+
+/**
+ * A StandardScaler + binary SVC. Aggregate of references to the generated
+ * tables, so a constexpr instance costs no RAM.
+ */
+template <size_t F, size_t V, SvmKernelType K>
+struct SvmModel {
+  static const size_t FEATURES = F;
+  static const size_t VECTORS = V;
+  static const SvmKernelType KERNEL = K;
+
+  const float (&mean)[F];
+  const float (&scale)[F];
+  const float (&support)[V][F];
+  const float (&dual)[V];
+  float intercept;
+  float gamma;
+  float coef0;
+  float degree;
+  float probA;
+  float probB;
+
+  /** decision_function of one unscaled feature vector. */
+  float decision(const float *features) const {
+    float x[F];
+    for (size_t i = 0; i < F; i++) {
+      x[i] = (features[i] - mean[i]) / scale[i];
+    }
+    float f = intercept;
+    for (size_t s = 0; s < V; s++) {
+      f += dual[s] * SvmKernel<K>::eval(support[s], x, gamma, coef0, degree);
+    }
+    return f;
+  }
+
+  /** P(class 1) of one unscaled feature vector. */
+  float probability(const float *features) const {
+    return 1.0f / (1.0f + expf(probA * decision(features) - probB));
+  }
+};
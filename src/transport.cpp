@@ -0,0 +1,47 @@
+/*
+ * CortexKey firmware - sample stream transports
+ */
+#include "transport.h"
+
+void SerialTransport::setBaud(uint32_t baud) {
+  port.flush();               // Whatever was queued still goes out at the old rate
+  port.updateBaudRate(baud);
+  rate = baud;
+}
+
+#if WIFI_ENABLED
+void UdpTransport::begin() {
+  device = (uint32_t)ESP.getEfuseMac();
+  WiFi.mode(WIFI_STA);
+  WiFi.setSleep(false);           // Modem sleep adds 100 ms+ of jitter per datagram
+  WiFi.setAutoReconnect(true);
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+}
+
+bool UdpTransport::ready() const {
+  return WiFi.status() == WL_CONNECTED;
+}
+
+size_t UdpTransport::sendBlock(const uint8_t *data, size_t len) {
+  if (!ready()) {
+    errors++;
+    return 0;
+  }
+  uint8_t header[UDP_HEADER_SIZE] = {'C', 'K', UDP_VERSION, 0};
+  memcpy(header + 4, &device, sizeof(device));    // Xtensa is little-endian
+  memcpy(header + 8, &seq, sizeof(seq));
+  seq++;
+
+  if (!udp.beginPacket(IPAddress(UDP_GROUP), UDP_PORT)) {
+    errors++;
+    return 0;
+  }
+  udp.write(header, sizeof(header));
+  udp.write(data, len);
+  if (!udp.endPacket()) {
+    errors++;
+    return 0;
+  }
+  return len;
+}
+#endif
@@ -0,0 +1,87 @@
+/*
+ * CortexKey firmware - sample stream transports
+ *
+ * The TX ring hands every sealed block to one Transport. A block only
+ * ever holds whole frames or lines, so a packet link can send each one as
+ * a single datagram and the host decoder never sees a split frame.
+ * Commands and STATUS text always stay on Serial.
+ *
+ * UDP datagram layout (UdpTransport, all fields little-endian):
+ *
+ *   off  size  field
+ *   0    2     magic      'C' 'K'
+ *   2    1     version    UDP_VERSION
+ *   3    1     reserved   0
+ *   4    4     device     low 32 bits of the eFuse MAC
+ *   8    4     seq        datagram number since boot (gaps = loss)
+ *   12   ...   block      one TX block: whole frames (protocol.h) or lines
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "config.h"
+
+#if WIFI_ENABLED
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#endif
+
+#define UDP_HEADER_SIZE  12
+#define UDP_VERSION      1
+
+class Transport {
+public:
+  virtual ~Transport() {}
+
+  virtual const char *name() const = 0;
+
+  /** Send one sealed TX block. Returns the bytes accepted. */
+  virtual size_t sendBlock(const uint8_t *data, size_t len) = 0;
+
+  /** Largest block the link takes in one send (0 = no limit). */
+  virtual size_t maxBlockBytes() const { return 0; }
+};
+
+/** The USB UART: blocks go out with one write() each. */
+class SerialTransport : public Transport {
+public:
+  explicit SerialTransport(HardwareSerial &port) : port(port) {}
+
+  const char *name() const override { return "SERIAL"; }
+  size_t sendBlock(const uint8_t *data, size_t len) override { return port.write(data, len); }
+
+  /** Wait for the TX FIFO to empty, then switch the UART to baud. */
+  void setBaud(uint32_t baud);
+  uint32_t baud() const { return rate; }
+
+private:
+  HardwareSerial &port;
+  uint32_t rate = SERIAL_BAUD;
+};
+
+#if WIFI_ENABLED
+/** One datagram per TX block to UDP_GROUP:UDP_PORT over Wi-Fi STA. */
+class UdpTransport : public Transport {
+public:
+  /** Start joining WIFI_SSID; returns at once, connection happens in the background. */
+  void begin();
+
+  /** Wi-Fi is associated and has an address. */
+  bool ready() const;
+
+  const char *name() const override { return "UDP"; }
+  size_t sendBlock(const uint8_t *data, size_t len) override;
+  size_t maxBlockBytes() const override { return UDP_MAX_BLOCK; }
+
+  uint32_t deviceId() const { return device; }
+  uint32_t datagrams() const { return seq; }
+  uint32_t sendErrors() const { return errors; }
+
+private:
+  WiFiUDP udp;
+  uint32_t device = 0;
+  uint32_t seq = 0;
+  uint32_t errors = 0;
+};
+#endif
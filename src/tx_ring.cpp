@@ -0,0 +1,89 @@
+/*
+ * CortexKey firmware - block-batched transmit ring
+ */
+#include "tx_ring.h"
+
+void TxRing::setBlockSamples(uint16_t samples) {
+  if (samples < 1) samples = 1;
+  if (samples > TX_BLOCK_MAX) samples = TX_BLOCK_MAX;
+  seal();
+  perBlock = samples;
+}
+
+void TxRing::setBlockBytes(size_t bytes) {
+  seal();
+  maxBytes = (bytes == 0 || bytes > TX_BLOCK_BYTES) ? TX_BLOCK_BYTES : bytes;
+}
+
+uint8_t *TxRing::reserve(size_t len) {
+  Block &b = blocks[head % TX_BLOCK_COUNT];
+  if (b.len + len > maxBytes) {
+    dropped++;
+    return nullptr;
+  }
+  return b.data + b.len;
+}
+
+void TxRing::commit(size_t len) {
+  blocks[head % TX_BLOCK_COUNT].len += len;
+}
+
+bool TxRing::write(const uint8_t *data, size_t len) {
+  uint8_t *dst = reserve(len);
+  if (!dst) {
+    return false;
+  }
+  memcpy(dst, data, len);
+  commit(len);
+  return true;
+}
+
+bool TxRing::sampleDone() {
+  Block &b = blocks[head % TX_BLOCK_COUNT];
+  if (++b.samples < perBlock) {
+    return false;
+  }
+  return seal();
+}
+
+bool TxRing::seal() {
+  Block &b = blocks[head % TX_BLOCK_COUNT];
+  if (b.len == 0) {
+    return false;
+  }
+  // All other blocks still waiting to be sent: keep filling this one.
+  if (head - tail >= TX_BLOCK_COUNT - 1) {
+    return false;
+  }
+  if (b.len > peakLen) {
+    peakLen = b.len;
+  }
+  head++;
+  Block &next = blocks[head % TX_BLOCK_COUNT];
+  next.len = 0;
+  next.samples = 0;
+  return true;
+}
+
+size_t TxRing::drainTo(Transport &out) {
+  size_t sent = 0;
+  while (tail != head) {
+    Block &b = blocks[tail % TX_BLOCK_COUNT];
+    sent += out.sendBlock(b.data, b.len);
+    b.len = 0;
+    b.samples = 0;
+    tail++;
+  }
+  sentBytes += sent;
+  return sent;
+}
+
+void TxRing::reset() {
+  for (Block &b : blocks) {
+    b.len = 0;
+    b.samples = 0;
+  }
+  head = 0;
+  tail = 0;
+  dropped = 0;
+}
@@ -0,0 +1,89 @@
+/*
+ * CortexKey firmware - block-batched transmit ring
+ *
+ * Encoded samples are appended to the current fill block. Once it holds
+ * the configured number of samples it is sealed and the next block starts
+ * filling while the sealed one is sent with a single write(). This turns
+ * 250 small UART writes per second into a few large ones.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "transport.h"
+
+#define TX_BLOCK_COUNT     2       // Double buffered
+#define TX_BLOCK_BYTES     4096    // TX_BLOCK_MAX single-channel ASCII lines; wider blocks are sent early
+#define TX_BLOCK_DEFAULT   25      // Samples per block (100 ms @ 250 Hz)
+#define TX_BLOCK_MAX       100     // Samples per block upper bound
+
+class TxRing {
+public:
+  /** Samples per block, clamped to [1, TX_BLOCK_MAX]. Seals the open block. */
+  void setBlockSamples(uint16_t samples);
+  uint16_t blockSamples() const { return perBlock; }
+
+  /**
+   * Byte limit per block, for packet links (0 or anything above
+   * TX_BLOCK_BYTES = the full block). Seals the open block.
+   */
+  void setBlockBytes(size_t bytes);
+  size_t blockBytes() const { return maxBytes; }
+
+  /** Samples already in the fill block. */
+  uint16_t samplesInBlock() const { return blocks[head % TX_BLOCK_COUNT].samples; }
+
+  /** Bytes still free in the fill block. */
+  size_t room() const {
+    size_t used = blocks[head % TX_BLOCK_COUNT].len;
+    return used < maxBytes ? maxBytes - used : 0;
+  }
+
+  /**
+   * Space for len bytes in the fill block, or nullptr when it would not
+   * fit (the caller drops the data; see overflows()).
+   */
+  uint8_t *reserve(size_t len);
+  void commit(size_t len);
+
+  /** reserve() + memcpy() + commit(). */
+  bool write(const uint8_t *data, size_t len);
+
+  /** Count one sample into the fill block; seals it when full. Returns true if sealed. */
+  bool sampleDone();
+
+  /** Seal the fill block even if it is only partially filled. Returns true if sealed. */
+  bool seal();
+
+  /** Hand every sealed block to out, one sendBlock() each. Returns bytes sent. */
+  size_t drainTo(Transport &out);
+
+  /** Discard all blocks and the overflow count (start of stream). */
+  void reset();
+
+  /** Writes dropped because the fill block was out of space since reset(). */
+  uint32_t overflows() const { return dropped; }
+
+  /** Bytes handed to transports since boot (wraps; use deltas). */
+  uint32_t bytesSent() const { return sentBytes; }
+
+  /** Largest block sealed since clearPeak(). */
+  size_t peakBytes() const { return peakLen; }
+  void clearPeak() { peakLen = 0; }
+
+private:
+  struct Block {
+    uint8_t data[TX_BLOCK_BYTES];
+    size_t len;
+    uint16_t samples;
+  };
+
+  Block blocks[TX_BLOCK_COUNT] = {};
+  uint32_t head = 0;      // Fill block
+  uint32_t tail = 0;      // Oldest sealed block
+  uint16_t perBlock = TX_BLOCK_DEFAULT;
+  size_t maxBytes = TX_BLOCK_BYTES;
+  uint32_t dropped = 0;
+  uint32_t sentBytes = 0;
+  size_t peakLen = 0;
+};
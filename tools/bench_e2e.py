@@ -0,0 +1,346 @@
+#!/usr/bin/env python3
+"""
+CortexKey — End-to-end stream benchmark
+=======================================
+Drives the firmware (a real ESP32, or the native build on a pty) through
+a matrix of stream configurations and measures the whole path an
+authentication decision takes:
+
+    sampler → TX path → link → SerialReader → IncrementalPipeline → predict
+
+For each stream (format x rate x channel count) it reports
+  - samples/s received against the configured rate, and loss: frames or
+    lines that never arrived, gaps, device overruns and TX drops
+    (SerialReader.link_stats())
+  - link latency p50/p99: age of a frame's newest sample on arrival,
+    from the host-clock stamps SYNC gives binary frames
+  - end-to-end latency p50/p99: age of a window's newest sample when its
+    decision is out. As app.py's _push_loop, every --hop the samples
+    since the last pass go into an IncrementalPipeline, and each pass
+    that completes a Welch segment gives a decision
+  - host CPU of the stream, split into the reader thread and the
+    pipeline (percent of one core)
+
+ASCII lines carry no host time stamp, so their latency fields are null.
+A stream is "sustained" when nothing was lost; the summary gives the
+highest sustained rate per format and channel count.
+
+Results go to stdout and, with --json, to a file that a later run can
+compare against (--baseline): a stream that got slower, lost samples or
+used more CPU than the tolerance allows is a regression (exit status 1).
+
+Usage:
+    python tools/bench_e2e.py --port /dev/ttyUSB0
+    python tools/bench_e2e.py --native .pio/build/native/program \\
+        --formats binary,compressed --rates 250,1000,2000 --channels 1,8 \\
+        --json bench.json
+    python tools/bench_e2e.py --port /dev/ttyUSB0 --json new.json --baseline bench.json
+"""
+
+import os
+import sys
+import json
+import time
+import socket
+import argparse
+import platform
+import subprocess
+
+import numpy as np
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "backend"))
+
+from eeg_pipeline import IncrementalPipeline                  # noqa: E402
+from ml_model import ensure_model, predict                    # noqa: E402
+from serial_reader import SerialReader, host_time_us, LINK_BAUD  # noqa: E402
+
+RESULT_VERSION = 1
+FORMAT_COMMANDS = {
+    "ascii": "ASCII",
+    "binary": "BINARY",
+    "binary24": "BINARY24",
+    "compressed": "COMPRESSED",
+}
+SETTLE_S = 0.3             # after STOP / config commands, before the next step
+FINAL_STATS_S = 0.5        # after STOP: the device's last STATS record comes in
+NATIVE_START_S = 5.0       # wait for the native build to open its pty
+# Changes below these never count as regressions (timer and scheduler noise)
+LATENCY_SLACK_MS = 2.0
+CPU_SLACK_PERCENT = 1.0
+
+
+# ── Device ─────────────────────────────────────────────────────────────────
+
+def launch_native(program: str):
+    """Start the native firmware on a pty in real time; returns (process, pty path)."""
+    proc = subprocess.Popen([program, "--pty", "--speed", "1"],
+                            stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                            text=True)
+    deadline = time.time() + NATIVE_START_S
+    while time.time() < deadline:
+        line = proc.stderr.readline()
+        if not line:
+            break
+        if line.startswith("[native] Serial on "):
+            return proc, line.split(" on ", 1)[1].strip()
+    proc.kill()
+    raise RuntimeError(f"{program} did not report its pty")
+
+
+def git_describe() -> str:
+    try:
+        return subprocess.check_output(
+            ["git", "describe", "--always", "--dirty"], text=True,
+            cwd=os.path.dirname(os.path.abspath(__file__)),
+            stderr=subprocess.DEVNULL).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+# ── Measurement ────────────────────────────────────────────────────────────
+
+def percentiles(values) -> dict:
+    """p50 / p99 / max in ms, or None without samples."""
+    if not len(values):
+        return None
+    p50, p99 = np.percentile(values, [50, 99])
+    return {"p50": round(float(p50), 2), "p99": round(float(p99), 2),
+            "max": round(float(np.max(values)), 2)}
+
+
+def configure(reader: SerialReader, fmt: str, rate: int, channels: int):
+    """Idle the device and set up the stream (commands are ignored while streaming)."""
+    reader.send_command("STOP")
+    time.sleep(SETTLE_S)
+    reader.send_command(FORMAT_COMMANDS[fmt])
+    reader.set_rate(rate)
+    reader.send_command(f"CHANNELS {(1 << channels) - 1}")
+    time.sleep(SETTLE_S)
+
+
+def run_stream(reader: SerialReader, fmt: str, rate: int, channels: int,
+               seconds: float, hop: float) -> dict:
+    """One stream: START, a pipeline pass per hop for `seconds`, STOP; the result record."""
+    configure(reader, fmt, rate, channels)
+    if reader.device_rate != rate:
+        print(f"[bench] Device refused RATE {rate} (at {reader.device_rate} Hz) — skipped")
+        return None
+
+    reader.reset_link_stats()
+    pipeline = IncrementalPipeline()
+    position = None
+    pipeline_ms, e2e_ms = [], []
+    pipeline_cpu = 0.0
+    cpu0 = time.process_time()
+    wall0 = time.time()
+    reader.send_command("START")
+    next_hop = wall0 + hop
+    while time.time() - wall0 < seconds:
+        time.sleep(max(0.0, next_hop - time.time()))
+        next_hop += hop
+        newest_us = reader.newest_sample_us()
+        samples, position, contiguous = reader.read_since(position)
+        t0 = time.thread_time()
+        w0 = time.perf_counter()
+        if not contiguous:
+            pipeline.reset()
+            samples = samples[-pipeline.window:]
+        segments = pipeline.push(samples, prefiltered=reader.prefiltered)
+        decided = bool(segments) and pipeline.ready()
+        if decided:
+            predict(pipeline.result()["features"])
+        done_us = host_time_us()
+        pipeline_cpu += time.thread_time() - t0
+        if not decided:
+            continue
+        pipeline_ms.append((time.perf_counter() - w0) * 1000.0)
+        if newest_us is not None:
+            e2e_ms.append((done_us - newest_us) / 1000.0)
+    reader.send_command("STOP")
+    wall = time.time() - wall0
+    time.sleep(FINAL_STATS_S)
+    cpu = time.process_time() - cpu0
+
+    stats = reader.link_stats()
+    # Gaps in the stream and the device's counts see the same losses two ways
+    lost = max(stats["link_lost"] + stats["overruns"], stats["gap_samples"])
+    total = stats["received"] + lost
+    stamped = fmt != "ascii"
+    return {
+        "format": fmt,
+        "rate": rate,
+        "channels": channels,
+        "seconds": round(wall, 2),
+        "samples": stats["received"],
+        "samples_per_s": round(stats["received"] / wall, 1),
+        "channel_samples_per_s": round(stats["received"] * channels / wall, 1),
+        "lost": lost,
+        "loss": round(lost / total, 6) if total else 0.0,
+        "lost_frames": stats["lost_frames"],
+        "crc_errors": stats["crc_errors"],
+        "malformed": stats["malformed"],
+        "overruns": stats["overruns"],
+        "tx_drops": stats["tx_drops"],
+        "sustained": lost == 0 and stats["lost_frames"] == 0 and stats["crc_errors"] == 0 and
+                     stats["received"] > 0,
+        "link_latency_ms": percentiles(reader.frame_latencies()) if stamped else None,
+        "e2e_latency_ms": percentiles(e2e_ms) if stamped else None,
+        "pipeline_ms": percentiles(pipeline_ms),
+        "decisions": len(pipeline_ms),
+        "cpu_percent": {
+            "total": round(cpu / wall * 100.0, 1),
+            "reader": round(max(0.0, cpu - pipeline_cpu) / wall * 100.0, 1),
+            "pipeline": round(pipeline_cpu / wall * 100.0, 1),
+        },
+    }
+
+
+def max_sustained(streams: list) -> dict:
+    """Highest sustained rate per "format/Nch"."""
+    out = {}
+    for s in streams:
+        key = f"{s['format']}/{s['channels']}ch"
+        best = out.get(key, 0)
+        if s["sustained"] and s["rate"] > best:
+            best = s["rate"]
+        out[key] = best
+    return out
+
+
+# ── Reporting ──────────────────────────────────────────────────────────────
+
+def _ms(field, key="p99"):
+    return "-" if field is None else f"{field[key]:.1f}"
+
+
+def print_stream(s: dict):
+    print(f"[bench] {s['format']:<10} {s['rate']:>5} Hz {s['channels']} ch: "
+          f"{s['samples_per_s']:>8.1f} S/s, loss {s['loss'] * 100:.3f}%, "
+          f"link p50/p99 {_ms(s['link_latency_ms'], 'p50')}/{_ms(s['link_latency_ms'])} ms, "
+          f"e2e p50/p99 {_ms(s['e2e_latency_ms'], 'p50')}/{_ms(s['e2e_latency_ms'])} ms, "
+          f"CPU {s['cpu_percent']['total']:.1f}% "
+          f"(reader {s['cpu_percent']['reader']:.1f}%)"
+          f"{'' if s['sustained'] else ', NOT SUSTAINED'}")
+
+
+def compare(results: dict, baseline: dict, tolerance: float) -> list:
+    """Regressions of results against baseline, as printable strings."""
+    old = {(s["format"], s["rate"], s["channels"]): s for s in baseline.get("streams", [])}
+    found = []
+    for s in results["streams"]:
+        key = (s["format"], s["rate"], s["channels"])
+        b = old.get(key)
+        if b is None:
+            continue
+        name = f"{s['format']} {s['rate']} Hz {s['channels']} ch"
+        if b["sustained"] and not s["sustained"]:
+            found.append(f"{name}: no longer sustained (loss {s['loss'] * 100:.3f}%)")
+        if s["samples_per_s"] < b["samples_per_s"] * (1 - tolerance):
+            found.append(f"{name}: {s['samples_per_s']} S/s, was {b['samples_per_s']}")
+        for field in ("e2e_latency_ms", "link_latency_ms"):
+            if (s[field] and b[field] and
+                    s[field]["p99"] > b[field]["p99"] * (1 + tolerance) + LATENCY_SLACK_MS):
+                found.append(f"{name}: {field} p99 {s[field]['p99']}, was {b[field]['p99']}")
+        if (s["cpu_percent"]["total"] >
+                b["cpu_percent"]["total"] * (1 + tolerance) + CPU_SLACK_PERCENT):
+            found.append(f"{name}: CPU {s['cpu_percent']['total']}%, "
+                         f"was {b['cpu_percent']['total']}%")
+    return found
+
+
+# ── Main ───────────────────────────────────────────────────────────────────
+
+def _int_list(text: str) -> list:
+    return [int(v) for v in text.split(",") if v]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="CortexKey end-to-end stream benchmark")
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument("--port", help="serial port of an ESP32")
+    target.add_argument("--native", metavar="PROGRAM",
+                        help="native firmware build to launch on a pty (pio run -e native)")
+    parser.add_argument("--formats", default="ascii,binary,binary24,compressed",
+                        help="comma-separated: " + ",".join(FORMAT_COMMANDS))
+    parser.add_argument("--rates", type=_int_list, default=[250, 500, 1000, 2000])
+    parser.add_argument("--channels", type=_int_list, default=[1])
+    parser.add_argument("--seconds", type=float, default=10.0, help="per stream")
+    parser.add_argument("--hop", type=float, default=0.2,
+                        help="seconds between pipeline passes (app.py's _push_loop: 0.2)")
+    parser.add_argument("--baud", type=int, default=LINK_BAUD, help="link rate to negotiate")
+    parser.add_argument("--json", metavar="PATH", help="write machine-readable results")
+    parser.add_argument("--baseline", metavar="PATH", help="earlier --json results to compare with")
+    parser.add_argument("--tolerance", type=float, default=0.2,
+                        help="relative slack before a change counts as a regression")
+    args = parser.parse_args()
+
+    formats = [f for f in args.formats.split(",") if f]
+    unknown = set(formats) - set(FORMAT_COMMANDS)
+    if unknown:
+        parser.error(f"unknown formats: {sorted(unknown)}")
+
+    ensure_model()
+    native = None
+    port = args.port
+    if args.native:
+        native, port = launch_native(args.native)
+        print(f"[bench] Native firmware on {port}")
+
+    reader = SerialReader()
+    try:
+        reader.connect(port)
+        if not reader.hardware_mode:
+            print(f"[bench] No device on {port}")
+            return 2
+        if args.baud != LINK_BAUD:
+            reader.negotiate_baud(args.baud)
+        reader.start()
+
+        streams = []
+        for fmt in formats:
+            for channels in args.channels:
+                for rate in args.rates:
+                    s = run_stream(reader, fmt, rate, channels, args.seconds, args.hop)
+                    if s is not None:
+                        print_stream(s)
+                        streams.append(s)
+        reader.send_command("STOP")
+    finally:
+        reader.stop()
+        if native:
+            native.terminate()
+            native.wait(timeout=5)
+
+    results = {
+        "version": RESULT_VERSION,
+        "time": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+        "git": git_describe(),
+        "host": {"name": socket.gethostname(), "platform": platform.platform(),
+                 "python": platform.python_version()},
+        "device": {"port": port, "native": bool(args.native), "baud": args.baud,
+                   "model": reader.device_model_version},
+        "seconds": args.seconds,
+        "hop": args.hop,
+        "streams": streams,
+        "max_sustained_rate": max_sustained(streams),
+    }
+    for key, rate in results["max_sustained_rate"].items():
+        print(f"[bench] Max sustained {key}: {rate or 'none'}{' Hz' if rate else ''}")
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+        print(f"[bench] Results → {args.json}")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            regressions = compare(results, json.load(f), args.tolerance)
+        for r in regressions:
+            print(f"[bench] REGRESSION {r}")
+        if regressions:
+            return 1
+        print(f"[bench] No regressions against {args.baseline}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
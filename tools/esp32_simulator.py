@@ -13,6 +13,10 @@ Usage:
 
 The simulator prints the PTY slave path so you can paste it into
 POST /api/serial/connect  or set it as CORTEXKEY_PORT env var.
+
+To run the real firmware code instead (binary formats, STATS, PERF and
+faster-than-real-time streams), build the host port and use its pty:
+    pio run -e native && .pio/build/native/program --pty --speed 100
 """
 
 import os
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""
+CortexKey — Firmware model exporter
+===================================
+Writes the classifier trained by backend/train_model.py (svm_model.pkl +
+scaler.pkl) to src/model_generated.h as constexpr tables plus an
+SvmModel (src/svm.h) specialized on their feature count, support-vector
+count and kernel, so the firmware's on-device authentication session
+(src/auth_session.h) scores the same feature vectors the backend would:
+
+    x' = (x - mean) / scale                      StandardScaler
+    f  = sum_i dual_i * K(sv_i, x') + intercept
+    P(authenticated) = 1 / (1 + exp(probA * f - probB))
+
+f is sklearn's decision_function (positive = class 1, authenticated);
+probA / probB are the Platt parameters behind predict_proba. Any SVC
+kernel (linear, poly, rbf, sigmoid) exports.
+
+Running train_model.py as a script runs this after training, so the
+header matches the pickles; MODEL_VERSION (hash of both) shows in STATUS.
+The backend's auto-train (ml_model.ensure_model()) leaves the header alone.
+
+Usage:
+    python tools/export_model.py            # rewrite src/model_generated.h
+    python tools/export_model.py --check    # print the model summary only
+"""
+
+import os
+import sys
+import hashlib
+import argparse
+
+import joblib
+
+MODEL_DIR = os.path.join(os.path.dirname(__file__), "..", "backend", "models")
+MODEL_PATH = os.path.join(MODEL_DIR, "svm_model.pkl")
+SCALER_PATH = os.path.join(MODEL_DIR, "scaler.pkl")
+OUT_PATH = os.path.join(os.path.dirname(__file__), "..", "src", "model_generated.h")
+
+# Order of extract_features() in backend/eeg_pipeline.py (FeatureIndex)
+FEATURE_NAMES = ("theta", "alpha", "beta", "alpha/theta", "alpha/beta", "total")
+SAMPLE_RATE = 250           # eeg_pipeline.FS: rate of the training windows
+
+# sklearn kernel name -> SvmKernelType
+KERNELS = {"linear": "SVM_LINEAR", "poly": "SVM_POLY", "rbf": "SVM_RBF", "sigmoid": "SVM_SIGMOID"}
+
+
+# ── Model ───────────────────────────────────────────────────────────────────
+
+def load():
+    """Model and scaler as plain Python lists, checked against the firmware."""
+    model = joblib.load(MODEL_PATH)
+    scaler = joblib.load(SCALER_PATH)
+    if model.kernel not in KERNELS:
+        raise ValueError(f"kernel {model.kernel!r}: the firmware has no SvmKernel for it")
+    if list(model.classes_.tolist()) != [0, 1]:
+        raise ValueError("expected classes [0 = impostor, 1 = authenticated]")
+    if not model.probability:
+        raise ValueError("train with probability=True (Platt parameters)")
+    n = int(model.n_features_in_)
+    if n != len(FEATURE_NAMES):
+        raise ValueError(f"{n} features, firmware extracts {len(FEATURE_NAMES)}")
+    return {
+        "version": model_version(),
+        "kernel": model.kernel,
+        "mean": scaler.mean_.tolist(),
+        "scale": scaler.scale_.tolist(),
+        "support": model.support_vectors_.tolist(),
+        "dual": model.dual_coef_.tolist()[0],
+        "intercept": float(model.intercept_.tolist()[0]),
+        "gamma": float(model._gamma),          # resolved value of gamma="scale"
+        "coef0": float(model.coef0),
+        "degree": float(model.degree),
+        "prob_a": float(model.probA_.tolist()[0]),
+        "prob_b": float(model.probB_.tolist()[0]),
+    }
+
+
+def model_version(paths=(MODEL_PATH, SCALER_PATH)) -> str:
+    """First 8 hex digits of SHA-256 over both pickles (ml_model.model_version())."""
+    digest = hashlib.sha256()
+    for path in paths:
+        with open(path, "rb") as f:
+            digest.update(f.read())
+    return digest.hexdigest()[:8]
+
+
+# ── Output ──────────────────────────────────────────────────────────────────
+
+def f32(x: float) -> str:
+    """float literal that round-trips a float32."""
+    text = f"{x:.9g}"
+    return text + ("f" if "." in text or "e" in text else ".0f")
+
+
+def fmt_row(values) -> str:
+    return "{ " + ", ".join(f"{f32(v):>16}" for v in values) + " }"
+
+
+def render(m) -> str:
+    n_sv = len(m["support"])
+    lines = [
+        "/*",
+        " * CortexKey firmware - authentication model tables",
+        " *",
+        " * GENERATED by tools/export_model.py from backend/models/svm_model.pkl",
+        " * and scaler.pkl - do not edit by hand; train_model.py re-runs it.",
+        f" * {m['kernel'].upper()} SVM, {n_sv} support vectors, gamma = {m['gamma']:.9g}.",
+        " * Features: " + ", ".join(FEATURE_NAMES) + ".",
+        " */",
+        "#pragma once",
+        "",
+        '#include "svm.h"',
+        "",
+        f'#define MODEL_VERSION          "{m["version"]}"',
+        f"#define MODEL_SAMPLE_RATE      {SAMPLE_RATE}",
+        f"#define MODEL_FEATURES         {len(FEATURE_NAMES)}",
+        f"#define MODEL_SUPPORT_VECTORS  {n_sv}",
+        f"#define MODEL_KERNEL           {KERNELS[m['kernel']]}",
+        "",
+        "// StandardScaler",
+        "constexpr float MODEL_SCALER_MEAN[MODEL_FEATURES] = {",
+    ]
+    lines += [f"  {f32(v) + ',':18s}// {name}" for v, name in zip(m["mean"], FEATURE_NAMES)]
+    lines += [
+        "};",
+        "constexpr float MODEL_SCALER_SCALE[MODEL_FEATURES] = {",
+    ]
+    lines += [f"  {f32(v) + ',':18s}// {name}" for v, name in zip(m["scale"], FEATURE_NAMES)]
+    lines += [
+        "};",
+        "",
+        "// SVC decision_function: positive = authenticated",
+        "constexpr float MODEL_DUAL_COEF[MODEL_SUPPORT_VECTORS] = {",
+    ]
+    lines += [f"  {f32(v)}," for v in m["dual"]]
+    lines += [
+        "};",
+        "constexpr float MODEL_SUPPORT[MODEL_SUPPORT_VECTORS][MODEL_FEATURES] = {",
+    ]
+    lines += [f"  {fmt_row(sv)}," for sv in m["support"]]
+    lines += [
+        "};",
+        "",
+        "// Inference specialized on this model (svm.h)",
+        "typedef SvmModel<MODEL_FEATURES, MODEL_SUPPORT_VECTORS, MODEL_KERNEL> AuthModel;",
+        "",
+        "constexpr AuthModel AUTH_MODEL = {",
+        "  MODEL_SCALER_MEAN,",
+        "  MODEL_SCALER_SCALE,",
+        "  MODEL_SUPPORT,",
+        "  MODEL_DUAL_COEF,",
+        f"  {f32(m['intercept']) + ',':18s}// intercept",
+        f"  {f32(m['gamma']) + ',':18s}// gamma",
+        f"  {f32(m['coef0']) + ',':18s}// coef0",
+        f"  {f32(m['degree']) + ',':18s}// degree",
+        f"  {f32(m['prob_a']) + ',':18s}// Platt A",
+        f"  {f32(m['prob_b']) + ',':18s}// Platt B",
+        "};",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def export(out_path: str = OUT_PATH) -> str:
+    """Write the header for the pickles on disk; returns its path."""
+    with open(out_path, "w") as f:
+        f.write(render(load()))
+    return os.path.normpath(out_path)
+
+
+def check(m):
+    print(f"version={m['version']}  kernel={m['kernel']}  "
+          f"support vectors={len(m['support'])}  gamma={m['gamma']:.6g}  "
+          f"intercept={m['intercept']:.6g}  probA={m['prob_a']:.6g}  probB={m['prob_b']:.6g}")
+    for name, mu, sd in zip(FEATURE_NAMES, m["mean"], m["scale"]):
+        print(f"  {name:12s} mean={mu:10.5g}  scale={sd:10.5g}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Export the SVM to a firmware header")
+    parser.add_argument("--check", action="store_true",
+                        help="print the model summary instead of writing")
+    args = parser.parse_args()
+    if args.check:
+        check(load())
+        sys.exit(0)
+    print(f"[export] wrote {export()}")
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""
+CortexKey — Firmware filter coefficient generator
+=================================================
+Designs the same filter chain as backend/eeg_pipeline.py
+(iirnotch Q=30 at 50/60 Hz + 4th-order Butterworth 5-30 Hz bandpass)
+for every sample rate the firmware supports, and writes them as Q30
+fixed-point biquad tables to src/filter_coeffs.h.
+
+Pure Python (same bilinear-transform formulas as scipy.signal.butter /
+iirnotch) so it runs anywhere the firmware is built.
+
+Usage:
+    python tools/gen_filter_coeffs.py            # rewrite src/filter_coeffs.h
+    python tools/gen_filter_coeffs.py --check    # print response sanity checks
+"""
+
+import os
+import sys
+import cmath
+import math
+import argparse
+
+# ── Must match backend/eeg_pipeline.py ─────────────────────────────────────
+NOTCH_FREQS = (50.0, 60.0)
+NOTCH_Q = 30.0
+BANDPASS = (5.0, 30.0)
+BANDPASS_ORDER = 4
+
+# Sample rates accepted by the firmware RATE command
+RATES = (250, 500, 1000, 2000)
+
+Q = 30                      # Coefficient format: Q2.30
+OUT_PATH = os.path.join(os.path.dirname(__file__), "..", "src", "filter_coeffs.h")
+
+
+# ── Design ──────────────────────────────────────────────────────────────────
+
+def design_notch(f0: float, q: float, fs: float):
+    """Biquad (b, a) identical to scipy.signal.iirnotch(f0, q, fs)."""
+    w0 = 2.0 * math.pi * f0 / fs
+    bw = w0 / q
+    beta = math.tan(bw / 2.0)
+    gain = 1.0 / (1.0 + beta)
+    b = [gain, -2.0 * gain * math.cos(w0), gain]
+    a = [1.0, -2.0 * gain * math.cos(w0), 2.0 * gain - 1.0]
+    return b, a
+
+
+def design_bandpass(f1: float, f2: float, order: int, fs: float):
+    """
+    Butterworth bandpass as second-order sections, matching
+    scipy.signal.butter(order, [f1, f2], btype="band", fs=fs).
+    Each section has zeros at z=+1 and z=-1; the gain is split evenly.
+    """
+    # Analog prototype poles on the unit circle
+    proto = [cmath.exp(1j * math.pi * (2 * k + order + 1) / (2 * order))
+             for k in range(order)]
+
+    # Pre-warped band edges
+    w1 = 2.0 * fs * math.tan(math.pi * f1 / fs)
+    w2 = 2.0 * fs * math.tan(math.pi * f2 / fs)
+    bw = w2 - w1
+    w0 = math.sqrt(w1 * w2)
+
+    # Lowpass → bandpass: each pole splits into two
+    poles = []
+    for p in proto:
+        half = p * bw / 2.0
+        root = cmath.sqrt(half * half - w0 * w0)
+        poles += [half + root, half - root]
+    gain = bw ** order            # `order` zeros at s = 0
+
+    # Bilinear transform
+    fs2 = 2.0 * fs
+    zpoles = [(fs2 + p) / (fs2 - p) for p in poles]
+    kz = gain * (fs2 ** order) / _prod(fs2 - p for p in poles)
+    kz = kz.real
+
+    # One conjugate pole pair per section
+    upper = sorted((p for p in zpoles if p.imag > 0), key=lambda p: abs(p))
+    sections = []
+    g = abs(kz) ** (1.0 / len(upper))
+    for i, p in enumerate(upper):
+        sg = g if (i > 0 or kz >= 0) else -g
+        b = [sg, 0.0, -sg]
+        a = [1.0, -2.0 * p.real, abs(p) ** 2]
+        sections.append((b, a))
+    return sections
+
+
+def _prod(values):
+    out = 1.0 + 0j
+    for v in values:
+        out *= v
+    return out
+
+
+def response(sections, f: float, fs: float) -> float:
+    """|H(e^jw)| of a biquad cascade at frequency f."""
+    z = cmath.exp(-1j * 2.0 * math.pi * f / fs)
+    h = 1.0 + 0j
+    for b, a in sections:
+        h *= (b[0] + b[1] * z + b[2] * z * z) / (a[0] + a[1] * z + a[2] * z * z)
+    return abs(h)
+
+
+# ── Output ──────────────────────────────────────────────────────────────────
+
+def q30(x: float) -> int:
+    v = int(round(x * (1 << Q)))
+    if not -(1 << 31) <= v < (1 << 31):
+        raise ValueError(f"coefficient {x} does not fit Q2.{Q}")
+    return v
+
+
+def fmt_biquad(b, a) -> str:
+    vals = [q30(b[0]), q30(b[1]), q30(b[2]), q30(a[1]), q30(a[2])]
+    return "{ " + ", ".join(f"{v:11d}" for v in vals) + " }"
+
+
+def render() -> str:
+    lines = [
+        "/*",
+        " * CortexKey firmware - filter coefficient tables",
+        " *",
+        " * GENERATED by tools/gen_filter_coeffs.py - do not edit by hand.",
+        f" * Notch: iirnotch Q={NOTCH_Q:g} at {', '.join(f'{f:g}' for f in NOTCH_FREQS)} Hz.",
+        f" * Bandpass: Butterworth order {BANDPASS_ORDER}, {BANDPASS[0]:g}-{BANDPASS[1]:g} Hz.",
+        f" * Coefficients are Q2.{Q}: {{ b0, b1, b2, a1, a2 }}, a0 = 1.",
+        " */",
+        "#pragma once",
+        "",
+        '#include "biquad.h"',
+        "",
+        f"#define FILTER_BANDPASS_SECTIONS  {BANDPASS_ORDER}",
+        "",
+        "struct FilterDesign {",
+        "  uint32_t rate;",
+        "  BiquadCoeffs notch50;",
+        "  BiquadCoeffs notch60;",
+        "  BiquadCoeffs bandpass[FILTER_BANDPASS_SECTIONS];",
+        "};",
+        "",
+        "constexpr FilterDesign FILTER_DESIGNS[] = {",
+    ]
+    for fs in RATES:
+        n50 = design_notch(NOTCH_FREQS[0], NOTCH_Q, fs)
+        n60 = design_notch(NOTCH_FREQS[1], NOTCH_Q, fs)
+        bp = design_bandpass(BANDPASS[0], BANDPASS[1], BANDPASS_ORDER, fs)
+        lines.append(f"  {{ {fs},")
+        lines.append(f"    {fmt_biquad(*n50)},")
+        lines.append(f"    {fmt_biquad(*n60)},")
+        lines.append("    {")
+        for b, a in bp:
+            lines.append(f"      {fmt_biquad(b, a)},")
+        lines.append("    } },")
+    lines += [
+        "};",
+        "",
+        "constexpr size_t FILTER_DESIGN_COUNT = sizeof(FILTER_DESIGNS) / sizeof(FILTER_DESIGNS[0]);",
+        "",
+        "/** True when a sample rate has a tabulated design. */",
+        "constexpr bool hasFilterDesign(uint32_t rate, size_t i = 0) {",
+        "  return i < FILTER_DESIGN_COUNT && (FILTER_DESIGNS[i].rate == rate || hasFilterDesign(rate, i + 1));",
+        "}",
+        "",
+        "/** Design for a sample rate, or nullptr when the rate is not tabulated. */",
+        "constexpr const FilterDesign *filterDesignFor(uint32_t rate, size_t i = 0) {",
+        "  return i >= FILTER_DESIGN_COUNT ? nullptr",
+        "       : FILTER_DESIGNS[i].rate == rate ? &FILTER_DESIGNS[i]",
+        "       : filterDesignFor(rate, i + 1);",
+        "}",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def check():
+    for fs in RATES:
+        bp = design_bandpass(BANDPASS[0], BANDPASS[1], BANDPASS_ORDER, fs)
+        n50 = design_notch(50.0, NOTCH_Q, fs)
+        db = lambda h: 20 * math.log10(max(h, 1e-12))
+        print(f"fs={fs:5d}  |H| 15Hz={db(response(bp, 15.0, fs)):6.2f} dB  "
+              f"5Hz={db(response(bp, 5.0, fs)):6.2f} dB  30Hz={db(response(bp, 30.0, fs)):6.2f} dB  "
+              f"1Hz={db(response(bp, 1.0, fs)):7.2f} dB  "
+              f"notch50={db(response([n50], 50.0, fs)):7.1f} dB  "
+              f"max pole radius={max(math.sqrt(a[2]) for _, a in bp):.6f}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Generate firmware filter tables")
+    parser.add_argument("--check", action="store_true",
+                        help="print frequency-response checks instead of writing")
+    args = parser.parse_args()
+    if args.check:
+        check()
+        sys.exit(0)
+    with open(OUT_PATH, "w") as f:
+        f.write(render())
+    print(f"[gen] wrote {os.path.normpath(OUT_PATH)}")